@@ -0,0 +1,18 @@
+#version 330 core
+// One density grid cell per texel, one team per channel (see DensityGrid)
+in vec2 World;
+out vec4 color;
+
+uniform sampler2D density;
+uniform vec2 gridSize;    // world size covered by the texture
+uniform mat4 teamColors;  // column t is the color of team t
+
+void main()
+{
+    vec2 uv = World / gridSize;
+    if (any(lessThan(uv, vec2(0.0))) || any(greaterThan(uv, vec2(1.0)))) {
+        discard;
+    }
+    vec3 heat = (teamColors * texture(density, uv)).rgb;
+    color = vec4(min(heat, vec3(1.0)), 1.0);
+}
@@ -0,0 +1,12 @@
+#version 330 core
+// Full-screen quad generated from gl_VertexID (drawn as a 4 vertex strip, no vertex buffer)
+out vec2 World;
+
+uniform vec4 view; // <vec2 min, vec2 max> of the world rectangle on screen
+
+void main()
+{
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    World = mix(view.xy, view.zw, corner);
+    gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -1,13 +1,8 @@
 #version 330 core
-in vec2 TexCoords;
+in vec4 SpriteColor;
 out vec4 color;
 
-uniform sampler2D image;
-uniform vec3 spriteColor;
-
 void main()
 {
-    // A uniform color vector allows us to easily change the color of our sprite from outside the shader.
-    // We calculate the final color by multiplying the texture by the sprite color vector.
-    color = vec4(spriteColor, 1.0) * texture(image, TexCoords);
+    color = SpriteColor;
 }
\ No newline at end of file
@@ -1,14 +1,19 @@
 #version 330 core
-// Both position and texture coordinates contain two floats, so we combine them into a single vertex attribute
-layout (location = 0) in vec4 vertex; // <vec2 position, vec2 texCoords>
+// One instance per sprite: the mesh is scaled by size and turned so its +y axis points along heading
+layout (location = 0) in vec2 aPos;
+layout (location = 1) in vec4 placement; // <vec2 position, vec2 size>
+layout (location = 2) in vec2 heading;
+layout (location = 3) in vec4 spriteColor;
 
-out vec2 TexCoords;
+out vec4 SpriteColor;
 
-uniform mat4 model;
 uniform mat4 projection;
 
 void main()
 {
-    TexCoords = vertex.zw;
-    gl_Position = projection * model * vec4(vertex.xy, 0.0, 1.0);
+    vec2 right = vec2(heading.y, -heading.x);
+    vec2 local = aPos * placement.zw;
+    vec2 world = placement.xy + right * local.x + heading * local.y;
+    SpriteColor = spriteColor;
+    gl_Position = projection * vec4(world, 0.0, 1.0);
 }
\ No newline at end of file
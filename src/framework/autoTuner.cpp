@@ -0,0 +1,254 @@
+#include "autoTuner.h"
+#include "memoryTracker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+/// @brief Host name and hardware thread count, so a cache shared between machines keeps their choices apart
+static string machineName() {
+    string name;
+#ifdef _WIN32
+    const char *host = std::getenv("COMPUTERNAME");
+    name = host ? host : "";
+#else
+    char host[256] = {};
+    if (gethostname(host, sizeof(host) - 1) == 0) {
+        name = host;
+    }
+#endif
+    if (name.empty()) {
+        name = "unknown";
+    }
+    return name + "/" + std::to_string(std::thread::hardware_concurrency());
+}
+
+/// @brief Bucket of a positive value, one per factor of two
+static int log2Bucket(float value) {
+    return value > 0 ? (int) std::lround(std::log2(value)) : -1;
+}
+
+bool AutoTuner::Key::operator==(const Key &other) const {
+    return population == other.population && density == other.density && mode == other.mode;
+}
+
+AutoTuner::AutoTuner(Flock &flock, ThreadPool &threads, const string &cachePath)
+    : flock(flock), threads(threads), cachePath(cachePath), machine(machineName()) {
+    settings.cellSize = flock.getGridCellSize();
+    settings.block = flock.getStepBlock();
+    settings.threads = threads.getThreadLimit();
+    load();
+}
+
+AutoTuner::Key AutoTuner::currentKey() const {
+    Key key;
+    const BoidPool &boids = flock.getBoids();
+    if (boids.size() == 0) {
+        return key;
+    }
+    // Density: boids per 100 x 100 px of the box around them
+    vec2 low = boids[0].pos, high = boids[0].pos;
+    for (const Boid &boid : boids) {
+        low = glm::min(low, boid.pos);
+        high = glm::max(high, boid.pos);
+    }
+    vec2 size = glm::max(high - low, vec2(100, 100));
+    key.population = log2Bucket((float) boids.size());
+    key.density = log2Bucket((float) boids.size() * 10000 / (size.x * size.y));
+
+    const bool synchronous = flock.getUpdateMode() == UpdateMode::SYNCHRONOUS || flock.isDeterministic();
+    if (synchronous) {
+        key.mode |= USES_THREADS | USES_GRID;
+    }
+    if (flock.getNeighborMode() == NeighborMode::TOPOLOGICAL || flock.getSteeringInterval() > 1) {
+        key.mode |= USES_GRID;
+    }
+    if (!synchronous && flock.getCollisionMode() == CollisionMode::COLORED) {
+        key.mode |= USES_THREADS | USES_GRID;
+    }
+    return key;
+}
+
+void AutoTuner::apply(const Settings &settings) {
+    flock.setGridCellSize(settings.cellSize);
+    flock.setStepBlock(settings.block);
+    threads.setThreadLimit(settings.threads);
+    // Grids and scratch lists grow to fit the new sizes, and the trials record their times
+    MemoryTracker::resetSteadyState();
+}
+
+void AutoTuner::beginStep() {
+    if (phase != Phase::IDLE) {
+        if (candidateSteps == 0) {
+            apply(candidates[candidate]);
+        }
+        return;
+    }
+    if (++stepsSinceCheck < CHECK_INTERVAL) {
+        return;
+    }
+    stepsSinceCheck = 0;
+
+    Key next = currentKey();
+    if (next == key) {
+        return;
+    }
+    key = next;
+    if (key.mode == 0) {
+        // Nothing the update uses can be tuned
+        return;
+    }
+    for (const Entry &entry : cache) {
+        if (entry.machine == machine && entry.key == key) {
+            settings = entry.settings;
+            milliseconds = entry.milliseconds;
+            fromCache = true;
+            apply(settings);
+            report(std::cout);
+            return;
+        }
+    }
+
+    best = settings;
+    bestTime = 0;
+    phase = Phase::IDLE;
+    nextPhase();
+    if (phase != Phase::IDLE) {
+        apply(candidates[candidate]);
+    }
+}
+
+void AutoTuner::endStep(float milliseconds) {
+    if (phase == Phase::IDLE) {
+        return;
+    }
+    // The first step of a candidate pays for the change (grids and lists sized for the old settings)
+    if (candidateSteps++ > 0) {
+        candidateTime += milliseconds;
+    }
+    if (candidateSteps < STEPS_PER_CANDIDATE) {
+        return;
+    }
+
+    float mean = candidateTime / (STEPS_PER_CANDIDATE - 1);
+    if (bestTime == 0 || mean < bestTime) {
+        best = candidates[candidate];
+        bestTime = mean;
+    }
+    candidateSteps = 0;
+    candidateTime = 0;
+    if (++candidate == candidates.size()) {
+        nextPhase();
+    }
+}
+
+void AutoTuner::nextPhase() {
+    candidates.clear();
+    candidate = 0;
+    while (candidates.empty()) {
+        switch (phase) {
+            case Phase::IDLE:
+                phase = Phase::THREADS;
+                if (key.mode & USES_THREADS) {
+                    // Powers of two, and every thread
+                    unsigned int total = threads.getThreadCount();
+                    for (unsigned int count = 1; count < total; count *= 2) {
+                        candidates.push_back(best);
+                        candidates.back().threads = count;
+                    }
+                    candidates.push_back(best);
+                    candidates.back().threads = total;
+                }
+                break;
+            case Phase::THREADS:
+                phase = Phase::CELL_SIZE;
+                if (key.mode & USES_GRID) {
+                    for (float cellSize : {20.0f, 40.0f, 80.0f, 120.0f, 200.0f}) {
+                        candidates.push_back(best);
+                        candidates.back().cellSize = cellSize;
+                    }
+                }
+                break;
+            case Phase::CELL_SIZE:
+                phase = Phase::BLOCK;
+                if (key.mode & USES_THREADS) {
+                    for (size_t block : {64, 128, 256, 512, 1024}) {
+                        candidates.push_back(best);
+                        candidates.back().block = block;
+                    }
+                }
+                break;
+            case Phase::BLOCK:
+                finish();
+                return;
+        }
+    }
+}
+
+void AutoTuner::finish() {
+    phase = Phase::IDLE;
+    settings = best;
+    milliseconds = bestTime;
+    fromCache = false;
+    apply(settings);
+
+    auto same = [this](const Entry &entry) { return entry.machine == machine && entry.key == key; };
+    cache.erase(std::remove_if(cache.begin(), cache.end(), same), cache.end());
+    cache.push_back({machine, key, settings, milliseconds});
+    save();
+    report(std::cout);
+}
+
+void AutoTuner::load() {
+    std::ifstream file(cachePath);
+    string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::istringstream fields(line);
+        Entry entry;
+        if (fields >> entry.machine >> entry.key.population >> entry.key.density >> entry.key.mode
+                   >> entry.settings.cellSize >> entry.settings.block >> entry.settings.threads >> entry.milliseconds) {
+            cache.push_back(entry);
+        }
+    }
+}
+
+void AutoTuner::save() const {
+    std::ofstream file(cachePath);
+    if (!file) {
+        std::cout << "| ERROR::AUTOTUNER: Failed to write the cache " << cachePath << std::endl;
+        return;
+    }
+    file << "# machine population density mode cellSize block threads milliseconds" << std::endl;
+    for (const Entry &entry : cache) {
+        file << entry.machine << ' ' << entry.key.population << ' ' << entry.key.density << ' ' << entry.key.mode
+             << ' ' << entry.settings.cellSize << ' ' << entry.settings.block << ' ' << entry.settings.threads << ' '
+             << entry.milliseconds << '\n';
+    }
+}
+
+void AutoTuner::report(std::ostream &out) const {
+    out << "Autotune (" << flock.getBoids().size() << " boids): ";
+    if (phase != Phase::IDLE) {
+        out << "trying " << candidate + 1 << " of " << candidates.size() << " candidates" << std::endl;
+        return;
+    }
+    out << "cell " << settings.cellSize << " px, blocks of " << settings.block << " boids, " << settings.threads
+        << " threads";
+    if (milliseconds > 0) {
+        out << ", " << milliseconds << " ms per step" << (fromCache ? " (cached)" : "");
+    }
+    out << std::endl;
+}
+
+bool AutoTuner::isTuning() const                        { return phase != Phase::IDLE; }
+const AutoTuner::Settings &AutoTuner::getSettings() const { return settings; }
@@ -0,0 +1,100 @@
+#ifndef GRAPHICS_AUTOTUNER_H
+#define GRAPHICS_AUTOTUNER_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include "threadPool.h"
+#include "../simulation/flock.h"
+
+using std::string, std::vector;
+
+/**
+ * @brief Picks the grid cell size, SYNCHRONOUS block size and thread count that step the flock fastest.
+ * @details Tuning runs on the real steps: each candidate is applied for a few updates and timed, so the
+ * simulation never stops for it. Thread counts are tried first, then cell sizes with the fastest thread count,
+ * then block sizes. Only the settings the current update mode uses are tuned, and none of them changes the
+ * result of a SYNCHRONOUS step.
+ * @details The flock is tuned again once its population or density has moved by about a factor of two. The
+ * choice for each population, density and mode is kept in a cache file under the name of the machine, so a
+ * known case is applied right away on the next run.
+ */
+class AutoTuner {
+public:
+    /// @brief The tuned settings
+    struct Settings {
+        float cellSize = Flock::GRID_CELL_SIZE;
+        size_t block = Flock::STEP_BLOCK;
+        unsigned int threads = 1;
+    };
+
+    /// @brief Updates per candidate; the first one is not timed, it pays for the change
+    static const int STEPS_PER_CANDIDATE = 4;
+    /// @brief Updates between two checks of the population and density
+    static const int CHECK_INTERVAL = 60;
+
+    /// @param cachePath File the choices are read from and written to
+    AutoTuner(Flock &flock, ThreadPool &threads, const string &cachePath);
+
+    /// @brief Call before Flock::update(): applies the next candidate, or checks if the flock needs tuning again
+    void beginStep();
+    /// @brief Call after Flock::update() with the time it took
+    void endStep(float milliseconds);
+
+    bool isTuning() const;
+    const Settings &getSettings() const;
+    /// @brief Prints the settings in use and where they came from
+    void report(std::ostream &out) const;
+
+private:
+    /// @brief What a choice was made for: log2 buckets of the population and density, and which settings matter
+    struct Key {
+        int population = -1, density = -1, mode = 0;
+        bool operator==(const Key &other) const;
+    };
+
+    /// @brief One line of the cache file
+    struct Entry {
+        string machine;
+        Key key;
+        Settings settings;
+        float milliseconds = 0;
+    };
+
+    enum class Phase { IDLE, THREADS, CELL_SIZE, BLOCK };
+
+    /// @brief Bit of Key::mode set when the update uses the thread pool and blocks, and when it uses a grid
+    static const int USES_THREADS = 1, USES_GRID = 2;
+
+    Key currentKey() const;
+    void apply(const Settings &settings);
+    /// @brief Starts the next phase that matters for the key being tuned, or finishes
+    void nextPhase();
+    void finish();
+
+    void load();
+    void save() const;
+
+    Flock &flock;
+    ThreadPool &threads;
+    string cachePath;
+    string machine;
+    vector<Entry> cache;
+
+    Settings settings;
+    Key key;
+    float milliseconds = 0;
+    bool fromCache = false;
+    int stepsSinceCheck = CHECK_INTERVAL;
+
+    // The trial in progress
+    Phase phase = Phase::IDLE;
+    vector<Settings> candidates;
+    size_t candidate = 0;
+    int candidateSteps = 0;
+    float candidateTime = 0;
+    Settings best;
+    float bestTime = 0;
+};
+
+#endif //GRAPHICS_AUTOTUNER_H
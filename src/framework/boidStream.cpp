@@ -0,0 +1,491 @@
+#include "boidStream.h"
+#include "memoryTracker.h"
+#include "../simulation/flock.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#define STREAM_POSIX
+#endif
+
+#ifdef MSG_NOSIGNAL
+static const int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+static const int SEND_FLAGS = 0;
+#endif
+
+static const uint8_t TEAM_MASK = 0x3, LEADER_BIT = 0x4;
+
+/// @brief World pixels per position unit along an axis of the given size
+static float positionScale(float size) {
+    return (size + 2 * StreamBoid::MARGIN) / 65535.0f;
+}
+
+static int8_t quantizeVelocity(float v) {
+    return (int8_t) std::clamp(std::lround(v / StreamBoid::VELOCITY_SCALE), -127L, 127L);
+}
+
+StreamBoid StreamBoid::encode(const Boid &boid, float width, float height) {
+    StreamBoid quantized;
+    quantized.x = (uint16_t) std::clamp(std::lround((boid.pos.x + MARGIN) / positionScale(width)), 0L, 65535L);
+    quantized.y = (uint16_t) std::clamp(std::lround((boid.pos.y + MARGIN) / positionScale(height)), 0L, 65535L);
+    quantized.vx = quantizeVelocity(boid.velocity.x);
+    quantized.vy = quantizeVelocity(boid.velocity.y);
+    quantized.tag = (uint8_t) ((boid.team & TEAM_MASK) | (boid.leader ? LEADER_BIT : 0));
+    return quantized;
+}
+
+Boid StreamBoid::decode(float width, float height) const {
+    Boid boid;
+    boid.pos = vec2(x * positionScale(width) - MARGIN, y * positionScale(height) - MARGIN);
+    boid.velocity = vec2(vx, vy) * VELOCITY_SCALE;
+    boid.team = tag & TEAM_MASK;
+    boid.leader = (tag & LEADER_BIT) != 0;
+    boid.radius = boid.leader ? Flock::LEADER_RADIUS : Flock::RADIUS;
+    return boid;
+}
+
+static void putVarint(vector<uint8_t> &out, uint32_t value) {
+    while (value >= 0x80) {
+        out.push_back((uint8_t) (value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((uint8_t) value);
+}
+
+/// @return false if the varint runs past end
+static bool getVarint(const uint8_t *&p, const uint8_t *end, uint32_t &value) {
+    value = 0;
+    for (int shift = 0; shift < 35 && p < end; shift += 7) {
+        uint8_t byte = *p++;
+        value |= (uint32_t) (byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/// @brief Largest message a frame with the given number of ids can encode to
+/// @details An entry is at most a 1-byte code and 7 bytes of FULL; a longer code skips as many ids as it has bytes.
+static size_t messageCapacity(size_t ids) {
+    return sizeof(StreamHeader) + 8 * ids;
+}
+
+// -----------------------------------
+// StreamServer
+// -----------------------------------
+
+StreamServer::~StreamServer() {
+    stop();
+}
+
+bool StreamServer::start(const string &path, float worldWidth, float worldHeight) {
+    stop();
+#ifdef STREAM_POSIX
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        std::cout << "| ERROR::STREAM: Socket path too long: " << path << std::endl;
+        return false;
+    }
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    // A socket file left behind by an earlier run would make bind() fail
+    unlink(path.c_str());
+    if (listenFd < 0 || bind(listenFd, (sockaddr *) &address, sizeof(address)) != 0 || listen(listenFd, 8) != 0 ||
+        fcntl(listenFd, F_SETFL, O_NONBLOCK) != 0) {
+        std::cout << "| ERROR::STREAM: Failed to listen on " << path << std::endl;
+        if (listenFd >= 0) {
+            close(listenFd);
+            listenFd = -1;
+        }
+        return false;
+    }
+    this->path = path;
+    width = worldWidth;
+    height = worldHeight;
+    return true;
+#else
+    std::cout << "| ERROR::STREAM: Streaming is only supported on POSIX systems" << std::endl;
+    return false;
+#endif
+}
+
+void StreamServer::stop() {
+#ifdef STREAM_POSIX
+    for (Viewer &viewer : viewers) {
+        close(viewer.fd);
+    }
+    viewers.clear();
+    if (listenFd >= 0) {
+        close(listenFd);
+        unlink(path.c_str());
+        listenFd = -1;
+    }
+#endif
+}
+
+void StreamServer::beginFrame() {
+    std::fill(currentAlive.begin(), currentAlive.end(), 0);
+    count = 0;
+}
+
+void StreamServer::add(uint32_t id, const Boid &boid) {
+    if (id >= current.size()) {
+        // Before growing: strict mode aborts inside the allocation
+        MemoryTracker::resetSteadyState();
+        // Both frames keep the same size, so ids can be compared one to one
+        current.resize(id + 1);
+        previous.resize(id + 1);
+        currentAlive.resize(id + 1, 0);
+        previousAlive.resize(id + 1, 0);
+        // Messages are encoded and copied every frame; sized for the worst case here, they never grow there
+        size_t capacity = messageCapacity(id + 1);
+        delta.reserve(capacity);
+        keyframe.reserve(capacity);
+        for (Viewer &viewer : viewers) {
+            viewer.pending.reserve(capacity);
+        }
+    }
+    current[id] = StreamBoid::encode(boid, width, height);
+    currentAlive[id] = 1;
+    ++count;
+}
+
+void StreamServer::endFrame() {
+#ifdef STREAM_POSIX
+    if (listenFd < 0) {
+        return;
+    }
+    acceptViewers();
+
+    // Push out the frames still in flight; a viewer that finished is ready for this one
+    bool needDelta = false, needKey = false;
+    for (Viewer &viewer : viewers) {
+        if (viewer.fd >= 0 && !flush(viewer)) {
+            close(viewer.fd);
+            viewer.fd = -1;
+        }
+        if (viewer.fd >= 0 && viewer.sent == viewer.pending.size()) {
+            (viewer.needsKey ? needKey : needDelta) = true;
+        }
+    }
+    if (needDelta) {
+        encode(false, delta);
+    }
+    if (needKey) {
+        encode(true, keyframe);
+    }
+
+    for (Viewer &viewer : viewers) {
+        if (viewer.fd < 0) {
+            continue;
+        }
+        if (viewer.sent < viewer.pending.size()) {
+            // Too slow: skip this frame, and resync with a keyframe since the next delta builds on it
+            viewer.needsKey = true;
+            ++dropped;
+            continue;
+        }
+        viewer.pending = viewer.needsKey ? keyframe : delta;
+        viewer.sent = 0;
+        viewer.needsKey = false;
+        if (!flush(viewer)) {
+            close(viewer.fd);
+            viewer.fd = -1;
+        }
+    }
+    viewers.erase(std::remove_if(viewers.begin(), viewers.end(), [](const Viewer &viewer) { return viewer.fd < 0; }),
+                  viewers.end());
+#endif
+    // This frame is what the next delta builds on
+    current.swap(previous);
+    currentAlive.swap(previousAlive);
+    current.resize(previous.size());
+    currentAlive.resize(previousAlive.size(), 0);
+    ++frame;
+}
+
+void StreamServer::acceptViewers() {
+#ifdef STREAM_POSIX
+    while (true) {
+        int fd = accept(listenFd, nullptr, nullptr);
+        if (fd < 0) {
+            return;
+        }
+        if (fcntl(fd, F_SETFL, O_NONBLOCK) != 0) {
+            close(fd);
+            continue;
+        }
+#ifdef SO_NOSIGPIPE
+        // No MSG_NOSIGNAL on macOS: a viewer closing must not kill the simulation with SIGPIPE
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+        // Before the viewer's buffers are allocated: strict mode aborts inside the allocation
+        MemoryTracker::resetSteadyState();
+        Viewer viewer;
+        viewer.fd = fd;
+        viewer.pending.reserve(messageCapacity(current.size()));
+        viewers.push_back(std::move(viewer));
+        std::cout << "Stream: viewer connected (" << viewers.size() << " watching)" << std::endl;
+    }
+#endif
+}
+
+bool StreamServer::flush(Viewer &viewer) {
+#ifdef STREAM_POSIX
+    while (viewer.sent < viewer.pending.size()) {
+        ssize_t n = send(viewer.fd, viewer.pending.data() + viewer.sent, viewer.pending.size() - viewer.sent,
+                         SEND_FLAGS | MSG_DONTWAIT);
+        if (n < 0) {
+            // A full socket buffer just means the viewer is behind
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        }
+        viewer.sent += n;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+void StreamServer::encode(bool keyframe, vector<uint8_t> &message) const {
+    message.resize(sizeof(StreamHeader));
+    uint32_t next = 0;
+    auto entry = [&](uint32_t id, StreamEntry kind) {
+        putVarint(message, (id - next) << 2 | (uint32_t) kind);
+        next = id + 1;
+    };
+    for (uint32_t id = 0; id < (uint32_t) current.size(); ++id) {
+        const StreamBoid &boid = current[id];
+        if (!currentAlive[id]) {
+            if (!keyframe && previousAlive[id]) {
+                entry(id, StreamEntry::REMOVE);
+            }
+            continue;
+        }
+        if (!keyframe && previousAlive[id]) {
+            const StreamBoid &last = previous[id];
+            int dx = (int) boid.x - last.x, dy = (int) boid.y - last.y;
+            if (dx == 0 && dy == 0 && boid.vx == last.vx && boid.vy == last.vy && boid.tag == last.tag) {
+                continue;
+            }
+            if (boid.tag == last.tag && dx >= -128 && dx <= 127 && dy >= -128 && dy <= 127) {
+                entry(id, StreamEntry::MOVE);
+                message.insert(message.end(), {(uint8_t) (int8_t) dx, (uint8_t) (int8_t) dy, (uint8_t) boid.vx,
+                                               (uint8_t) boid.vy});
+                continue;
+            }
+        }
+        entry(id, StreamEntry::FULL);
+        message.insert(message.end(), {(uint8_t) boid.x, (uint8_t) (boid.x >> 8), (uint8_t) boid.y,
+                                       (uint8_t) (boid.y >> 8), (uint8_t) boid.vx, (uint8_t) boid.vy, boid.tag});
+    }
+
+    StreamHeader header;
+    header.keyframe = keyframe;
+    header.frame = frame;
+    header.count = count;
+    header.bytes = (uint32_t) (message.size() - sizeof(StreamHeader));
+    header.worldWidth = width;
+    header.worldHeight = height;
+    std::memcpy(message.data(), &header, sizeof(header));
+}
+
+bool StreamServer::isRunning() const                 { return listenFd >= 0; }
+int StreamServer::getViewerCount() const             { return (int) viewers.size(); }
+unsigned long StreamServer::getDroppedFrames() const { return dropped; }
+
+size_t StreamServer::getDeltaBytes() const {
+    return delta.empty() ? 0 : delta.size() - sizeof(StreamHeader);
+}
+
+size_t StreamServer::getKeyframeBytes() const {
+    return keyframe.empty() ? 0 : keyframe.size() - sizeof(StreamHeader);
+}
+
+// -----------------------------------
+// StreamClient
+// -----------------------------------
+
+StreamClient::StreamClient(size_t capacity) : boids(capacity) {}
+
+StreamClient::~StreamClient() {
+#ifdef STREAM_POSIX
+    if (fd >= 0) {
+        close(fd);
+    }
+#endif
+}
+
+bool StreamClient::connect(const string &path) {
+#ifdef STREAM_POSIX
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || ::connect(fd, (sockaddr *) &address, sizeof(address)) != 0) {
+        std::cout << "| ERROR::STREAM: Nothing is streaming on " << path << std::endl;
+        if (fd >= 0) {
+            close(fd);
+            fd = -1;
+        }
+        return false;
+    }
+    return true;
+#else
+    std::cout << "| ERROR::STREAM: Streaming is only supported on POSIX systems" << std::endl;
+    return false;
+#endif
+}
+
+bool StreamClient::receive() {
+#ifdef STREAM_POSIX
+    if (fd < 0) {
+        return false;
+    }
+    // Take what the socket has, up to two of the largest frames; the rest waits for the next call
+    size_t limit = 2 * messageCapacity(boids.capacity());
+    while (received < limit) {
+        if (incoming.size() - received < 65536) {
+            incoming.resize(received + 65536);
+        }
+        ssize_t n = recv(fd, incoming.data() + received, incoming.size() - received, MSG_DONTWAIT);
+        if (n > 0) {
+            received += n;
+            continue;
+        }
+        if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+            close(fd);
+            fd = -1;
+        }
+        break;
+    }
+
+    // Apply the complete frames in order
+    size_t offset = 0;
+    bool changed = false;
+    StreamHeader header;
+    while (received - offset >= sizeof(StreamHeader)) {
+        std::memcpy(&header, incoming.data() + offset, sizeof(header));
+        if (header.magic != StreamHeader::MAGIC || header.version != StreamHeader::VERSION) {
+            std::cout << "| ERROR::STREAM: Not a boid stream (or another version)" << std::endl;
+            close(fd);
+            fd = -1;
+            return false;
+        }
+        if (header.bytes > messageCapacity(boids.capacity()) - sizeof(StreamHeader)) {
+            std::cout << "| ERROR::STREAM: Frame of " << header.bytes << " bytes is too large for "
+                      << boids.capacity() << " boids" << std::endl;
+            close(fd);
+            fd = -1;
+            return false;
+        }
+        if (received - offset < sizeof(StreamHeader) + header.bytes) {
+            break;
+        }
+        if (!apply(header, incoming.data() + offset + sizeof(StreamHeader))) {
+            // The server never sends a malformed frame: whatever is on the other end, stop listening to it
+            std::cout << "| ERROR::STREAM: Malformed frame " << header.frame << std::endl;
+            close(fd);
+            fd = -1;
+            return false;
+        }
+        changed = true;
+        offset += sizeof(StreamHeader) + header.bytes;
+    }
+    std::memmove(incoming.data(), incoming.data() + offset, received - offset);
+    received -= offset;
+
+    if (changed && synced) {
+        publish();
+    }
+#endif
+    return fd >= 0;
+}
+
+bool StreamClient::apply(const StreamHeader &header, const uint8_t *body) {
+    if (header.keyframe) {
+        std::fill(alive.begin(), alive.end(), 0);
+        width = header.worldWidth;
+        height = header.worldHeight;
+        synced = true;
+    } else if (!synced) {
+        return true;
+    }
+
+    const uint8_t *p = body, *end = body + header.bytes;
+    uint32_t next = 0;
+    while (p < end) {
+        uint32_t code;
+        if (!getVarint(p, end, code)) {
+            return false;
+        }
+        // Checked before adding, so a huge skip cannot wrap around either
+        if ((code >> 2) >= boids.capacity() - next) {
+            return false;
+        }
+        uint32_t id = next + (code >> 2);
+        next = id + 1;
+        if (id >= state.size()) {
+            state.resize(id + 1);
+            alive.resize(id + 1, 0);
+        }
+        StreamBoid &boid = state[id];
+        switch ((StreamEntry) (code & 3)) {
+            case StreamEntry::MOVE:
+                if (end - p < 4 || !alive[id]) {
+                    return false;
+                }
+                boid.x = (uint16_t) (boid.x + (int8_t) p[0]);
+                boid.y = (uint16_t) (boid.y + (int8_t) p[1]);
+                boid.vx = (int8_t) p[2];
+                boid.vy = (int8_t) p[3];
+                p += 4;
+                break;
+            case StreamEntry::FULL:
+                if (end - p < 7) {
+                    return false;
+                }
+                boid.x = (uint16_t) (p[0] | p[1] << 8);
+                boid.y = (uint16_t) (p[2] | p[3] << 8);
+                boid.vx = (int8_t) p[4];
+                boid.vy = (int8_t) p[5];
+                boid.tag = p[6];
+                alive[id] = 1;
+                p += 7;
+                break;
+            case StreamEntry::REMOVE:
+                alive[id] = 0;
+                break;
+            default:
+                return false;
+        }
+    }
+    frame = header.frame;
+    return true;
+}
+
+void StreamClient::publish() {
+    boids.clear();
+    for (size_t id = 0; id < state.size() && !boids.full(); ++id) {
+        if (alive[id]) {
+            boids.spawn(state[id].decode(width, height));
+        }
+    }
+}
+
+bool StreamClient::isConnected() const          { return fd >= 0; }
+const BoidPool &StreamClient::getBoids() const  { return boids; }
+uint32_t StreamClient::getFrame() const         { return frame; }
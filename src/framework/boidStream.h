@@ -0,0 +1,174 @@
+#ifndef GRAPHICS_BOIDSTREAM_H
+#define GRAPHICS_BOIDSTREAM_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "../simulation/boidPool.h"
+
+using std::string, std::vector;
+
+/// @brief Default path of the stream socket
+#define STREAM_SOCKET_PATH "/tmp/boids.sock"
+
+/// @brief Header of every frame on the stream, followed by bytes of encoded boids
+/// @details The body is a run of entries in increasing id order. Each starts with a varint of
+/// (ids skipped since the last entry) << 2 | kind, where kind is one of StreamEntry:
+/// - MOVE: int8 dx, dy (in position units), int8 vx, vy
+/// - FULL: uint16 x, y, int8 vx, vy, uint8 tag (team | leader << 2)
+/// - REMOVE: nothing
+/// @details A keyframe replaces every boid the viewer has; a delta only lists the boids that changed since the
+/// frame before it.
+struct StreamHeader {
+    static const uint32_t MAGIC = 0x52545342; // "BSTR"
+    static const uint16_t VERSION = 1;
+
+    uint32_t magic = MAGIC;
+    uint16_t version = VERSION;
+    uint16_t keyframe = 0;
+    uint32_t frame = 0;
+    /// @brief Boids alive once the frame is applied
+    uint32_t count = 0;
+    uint32_t bytes = 0;
+    float worldWidth = 0, worldHeight = 0;
+};
+
+enum class StreamEntry : uint8_t { MOVE, FULL, REMOVE };
+
+/// @brief A boid as quantized for the stream (7 bytes on the wire)
+struct StreamBoid {
+    /// @brief Pixels past the edges of the world that positions still cover
+    static constexpr float MARGIN = 256;
+    /// @brief Pixels per second per unit of velocity: covers about +-500, plenty to orient the boid
+    static constexpr float VELOCITY_SCALE = 4;
+
+    uint16_t x = 0, y = 0;
+    int8_t vx = 0, vy = 0;
+    uint8_t tag = 0;
+
+    /// @brief Quantizes boid in a world of the given size
+    static StreamBoid encode(const Boid &boid, float width, float height);
+    Boid decode(float width, float height) const;
+};
+
+/**
+ * @brief Streams the boids of every frame to viewer processes over a UNIX domain socket.
+ * @details Each frame is encoded once as a delta against the frame before it, and once as a keyframe if a viewer
+ * needs one. Boids that moved less than 128 position units (about 4 px) take 5 bytes, unchanged boids nothing.
+ * @details Sockets are non-blocking and every viewer holds at most one frame in flight. A viewer that is still
+ * receiving the last frame skips the new one, and gets a keyframe once it caught up, so a slow viewer never
+ * holds up the step or the other viewers.
+ * @details Only available on POSIX systems; start() fails elsewhere.
+ */
+class StreamServer {
+public:
+    StreamServer() = default;
+    ~StreamServer();
+
+    StreamServer(const StreamServer &) = delete;
+    StreamServer &operator=(const StreamServer &) = delete;
+
+    /// @brief Listens on path (replacing a stale socket file)
+    /// @return false if the socket could not be created
+    bool start(const string &path, float worldWidth, float worldHeight);
+
+    /// @brief Disconnects every viewer and removes the socket file
+    void stop();
+
+    /// @brief Starts a frame; add every live boid, then call endFrame()
+    void beginFrame();
+    /// @brief Adds a boid under a stable id (ids need not be dense)
+    void add(uint32_t id, const Boid &boid);
+    /// @brief Accepts new viewers and sends the frame to every viewer that is ready for it
+    void endFrame();
+
+    // -----------------------------------
+    // Getters
+    // -----------------------------------
+    bool isRunning() const;
+    int getViewerCount() const;
+    /// @brief Frames skipped by slow viewers so far
+    unsigned long getDroppedFrames() const;
+    /// @brief Size of the last delta and keyframe bodies
+    size_t getDeltaBytes() const;
+    size_t getKeyframeBytes() const;
+
+private:
+    struct Viewer {
+        int fd = -1;
+        /// @brief The frame in flight and how much of it was sent
+        vector<uint8_t> pending;
+        size_t sent = 0;
+        /// @brief Missed a frame (or just connected): the next frame it gets must be a keyframe
+        bool needsKey = true;
+    };
+
+    void acceptViewers();
+    /// @brief Sends what the socket takes of the viewer's frame
+    /// @return false if the viewer is gone
+    bool flush(Viewer &viewer);
+    /// @brief Encodes the frame into message, as a keyframe or as a delta against previous
+    void encode(bool keyframe, vector<uint8_t> &message) const;
+
+    int listenFd = -1;
+    string path;
+    float width = 0, height = 0;
+    vector<Viewer> viewers;
+
+    uint32_t frame = 0;
+    /// @brief Quantized boids by id in this frame and the last one, and which ids are alive
+    vector<StreamBoid> current, previous;
+    vector<uint8_t> currentAlive, previousAlive;
+    uint32_t count = 0;
+    vector<uint8_t> delta, keyframe;
+
+    unsigned long dropped = 0;
+};
+
+/**
+ * @brief The viewer end of a StreamServer.
+ * @details receive() applies every frame that arrived without blocking, and getBoids() holds the boids of the
+ * last one, ready for Renderer::drawBoids().
+ */
+class StreamClient {
+public:
+    /// @param capacity Most boids the viewer can show
+    explicit StreamClient(size_t capacity);
+    ~StreamClient();
+
+    StreamClient(const StreamClient &) = delete;
+    StreamClient &operator=(const StreamClient &) = delete;
+
+    /// @return false if nothing listens on path
+    bool connect(const string &path);
+
+    /// @brief Applies every complete frame received since the last call
+    /// @return false once the server has gone away, or was dropped for sending a malformed frame
+    bool receive();
+
+    bool isConnected() const;
+    const BoidPool &getBoids() const;
+    /// @brief Number of the last frame applied
+    uint32_t getFrame() const;
+
+private:
+    /// @brief Applies one frame to the boids by id
+    /// @return false if the frame is malformed or names an id past the capacity
+    bool apply(const StreamHeader &header, const uint8_t *body);
+    /// @brief Rebuilds boids from the boids by id
+    void publish();
+
+    int fd = -1;
+    vector<uint8_t> incoming;
+    size_t received = 0;
+
+    float width = 0, height = 0;
+    uint32_t frame = 0;
+    /// @brief Deltas are ignored until the first keyframe
+    bool synced = false;
+    vector<StreamBoid> state;
+    vector<uint8_t> alive;
+    BoidPool boids;
+};
+
+#endif //GRAPHICS_BOIDSTREAM_H
@@ -0,0 +1,160 @@
+#include "commandQueue.h"
+#include "../simulation/boid.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+bool parseCommand(const string &line, Command &command) {
+    std::istringstream in(line.substr(0, line.find('#')));
+    string name;
+    if (!(in >> name)) {
+        return false;
+    }
+
+    command = Command();
+    if (name == "spawn" && in >> command.pos.x >> command.pos.y) {
+        command.type = Command::Type::SPAWN;
+        command.count = 1000;
+        in >> command.count >> command.team;
+        return command.count > 0 && command.team >= 0 && command.team < MAX_TEAMS;
+    }
+    if (name == "despawn" && in >> command.pos.x >> command.pos.y) {
+        command.type = Command::Type::DESPAWN;
+        command.radius = 75;
+        in >> command.radius;
+        return true;
+    }
+    string argument;
+    if (name == "set" && in >> argument >> command.value) {
+        command.type = Command::Type::SET_RULE;
+        command.field = simConfigField(argument);
+        return command.field != nullptr;
+    }
+    if (name == "preset" && in >> argument) {
+        command.type = Command::Type::PRESET;
+        return parsePreset(argument, command.preset);
+    }
+    if (name == "snapshot" && in >> argument && argument.size() < sizeof(command.path)) {
+        command.type = Command::Type::SNAPSHOT;
+        std::strcpy(command.path, argument.c_str());
+        return true;
+    }
+    if (name == "pause" || name == "resume" || name == "toggle-pause") {
+        command.type = name == "pause" ? Command::Type::PAUSE
+                     : name == "resume" ? Command::Type::RESUME : Command::Type::TOGGLE_PAUSE;
+        return true;
+    }
+    return false;
+}
+
+CommandQueue::CommandQueue() : slots(new Slot[CAPACITY]) {
+    static_assert((CAPACITY & (CAPACITY - 1)) == 0, "the capacity must be a power of two");
+    // Slot i is free for the write at position i
+    for (size_t i = 0; i < CAPACITY; ++i) {
+        slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+bool CommandQueue::push(const Command &command) {
+    size_t pos = writePos.load(std::memory_order_relaxed);
+    Slot *slot;
+    for (;;) {
+        slot = &slots[pos & (CAPACITY - 1)];
+        size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        intptr_t lag = (intptr_t) sequence - (intptr_t) pos;
+        if (lag == 0) {
+            // Free for this position: claim it, unless another producer got there first
+            if (writePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (lag < 0) {
+            // Still holds the command from one lap ago: full
+            fullCount.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        } else {
+            pos = writePos.load(std::memory_order_relaxed);
+        }
+    }
+    slot->command = command;
+    // Publishes the command to the consumer
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+bool CommandQueue::pop(Command &command) {
+    Slot &slot = slots[readPos & (CAPACITY - 1)];
+    if (slot.sequence.load(std::memory_order_acquire) != readPos + 1) {
+        return false;
+    }
+    command = slot.command;
+    // Hands the slot back to the producers for the next lap
+    slot.sequence.store(readPos + CAPACITY, std::memory_order_release);
+    ++readPos;
+    return true;
+}
+
+size_t CommandQueue::getFullCount() const { return fullCount.load(std::memory_order_relaxed); }
+size_t CommandQueue::memoryUsage() const  { return CAPACITY * sizeof(Slot); }
+
+CommandScript::CommandScript(shared_ptr<CommandQueue> queue, const string &path)
+    : state(std::make_shared<State>()) {
+    // The thread owns its own references, so it may outlive this object (see ~CommandScript())
+    thread = std::thread([queue, state = state, path]() {
+        std::ifstream file;
+        if (path != "-") {
+            file.open(path);
+            if (!file) {
+                std::cout << "| ERROR::COMMANDS: Failed to open " << path << std::endl;
+                state->done = true;
+                return;
+            }
+        }
+        std::istream &in = path == "-" ? std::cin : file;
+
+        string line;
+        int number = 0;
+        while (!state->stop && std::getline(in, line)) {
+            ++number;
+            std::istringstream words(line);
+            string first;
+            float seconds;
+            if (!(words >> first) || first[0] == '#') {
+                continue;
+            }
+            if (first == "wait" && words >> seconds) {
+                // Sleep in short slices so stopping is not delayed by a long wait
+                auto until = std::chrono::steady_clock::now() + std::chrono::duration<float>(seconds);
+                while (!state->stop && std::chrono::steady_clock::now() < until) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                }
+                continue;
+            }
+
+            Command command;
+            if (!parseCommand(line, command)) {
+                std::cout << "| ERROR::COMMANDS: " << path << ":" << number << ": bad command '" << line << "'"
+                          << std::endl;
+                continue;
+            }
+            // A script should not lose commands: wait for the simulation to drain the queue
+            while (!state->stop && !queue->push(command)) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+        state->done = true;
+    });
+}
+
+CommandScript::~CommandScript() {
+    state->stop = true;
+    // A thread blocked reading stdin cannot be interrupted; let it finish on its own
+    if (state->done) {
+        thread.join();
+    } else {
+        thread.detach();
+    }
+}
@@ -0,0 +1,114 @@
+#ifndef GRAPHICS_COMMANDQUEUE_H
+#define GRAPHICS_COMMANDQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <thread>
+#include <glm/glm.hpp>
+
+#include "../simulation/simConfig.h"
+
+using std::string, std::shared_ptr, glm::vec2;
+
+/// @brief A change to the simulation, applied by the Engine between two steps
+struct Command {
+    enum class Type {
+        /// @brief count boids of team around pos
+        SPAWN,
+        /// @brief Every boid within radius of pos
+        DESPAWN,
+        /// @brief Sets field of the rule constants to value (see Flock::setConfig())
+        SET_RULE,
+        PRESET,
+        PAUSE,
+        RESUME,
+        TOGGLE_PAUSE,
+        /// @brief Writes every boid to path
+        SNAPSHOT
+    } type = Type::PAUSE;
+
+    vec2 pos = vec2(0, 0);
+    int count = 0;
+    int team = 0;
+    float radius = 0;
+    SimConfigField field = nullptr;
+    float value = 0;
+    Preset preset = Preset::CLASSIC;
+    /// @brief Fixed size, so posting never allocates
+    char path[128] = {};
+};
+
+/// @brief Parses one line of a command script
+/// @details "spawn X Y [COUNT] [TEAM]", "despawn X Y [RADIUS]", "set NAME VALUE" (names as in SimConfig),
+/// "preset NAME", "pause", "resume", "toggle-pause" or "snapshot PATH".
+/// @return false if the line is not a command
+bool parseCommand(const string &line, Command &command);
+
+/**
+ * @brief Bounded lock-free queue from any number of threads to the simulation thread.
+ * @details A ring of slots that each carry a sequence number (Vyukov's bounded queue). Producers claim a slot
+ * with one compare-and-swap on the write position and publish it by bumping its sequence; the single consumer
+ * reads slots in order without any atomic read-modify-write. Nobody ever waits on a lock, and a full queue makes
+ * push() fail instead of blocking.
+ * @details All slots are allocated up front, so neither side allocates while running.
+ */
+class CommandQueue {
+public:
+    /// @brief Number of slots (a power of two)
+    static const size_t CAPACITY = 1024;
+
+    CommandQueue();
+
+    CommandQueue(const CommandQueue &) = delete;
+    CommandQueue &operator=(const CommandQueue &) = delete;
+
+    /// @brief Posts a command; safe from any thread
+    /// @return false if the queue was full; the command was not posted
+    bool push(const Command &command);
+
+    /// @brief Takes the oldest command; only one thread may pop
+    /// @return false if the queue is empty
+    bool pop(Command &command);
+
+    /// @brief Number of push() calls that found the queue full
+    size_t getFullCount() const;
+
+    size_t memoryUsage() const;
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        Command command;
+    };
+    std::unique_ptr<Slot[]> slots;
+
+    /// @brief On their own cache lines: producers contend on the first, the consumer owns the second
+    alignas(64) std::atomic<size_t> writePos{0};
+    alignas(64) size_t readPos = 0;
+    std::atomic<size_t> fullCount{0};
+};
+
+/**
+ * @brief Reads a command script on its own thread and posts every command to a queue.
+ * @details One command per line (see parseCommand()), # starts a comment, and "wait SECONDS" delays the rest of
+ * the script. "-" reads from stdin, so commands can be piped in while the engine runs.
+ */
+class CommandScript {
+public:
+    CommandScript(shared_ptr<CommandQueue> queue, const string &path);
+
+    /// @brief Stops reading; a thread still blocked on input is left to finish on its own
+    ~CommandScript();
+
+private:
+    struct State {
+        std::atomic<bool> stop{false};
+        std::atomic<bool> done{false};
+    };
+    shared_ptr<State> state;
+    std::thread thread;
+};
+
+#endif //GRAPHICS_COMMANDQUEUE_H
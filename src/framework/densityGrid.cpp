@@ -0,0 +1,82 @@
+#include "densityGrid.h"
+
+#include <algorithm>
+#include <cmath>
+
+void DensityGrid::resize(float worldWidth, float worldHeight, float cellSize) {
+    this->cellSize = cellSize;
+    columns = std::max(1, (int) std::ceil(worldWidth / cellSize));
+    rows = std::max(1, (int) std::ceil(worldHeight / cellSize));
+    counts.assign((size_t) columns * rows * MAX_TEAMS, 0);
+    intensity.assign(counts.size(), 0.0f);
+}
+
+int DensityGrid::cellOf(vec2 pos) const {
+    int x = std::clamp((int) (pos.x / cellSize), 0, columns - 1);
+    int y = std::clamp((int) (pos.y / cellSize), 0, rows - 1);
+    return y * columns + x;
+}
+
+void DensityGrid::build(const Boid *boids, size_t count, ThreadPool *threads) {
+    const size_t cells = counts.size();
+    const size_t blocks = threads ? threads->getThreadCount() : 1;
+    if (blocks == 1) {
+        clear();
+        for (size_t i = 0; i < count; ++i) {
+            add(boids[i].pos, boids[i].team);
+        }
+        finish();
+        return;
+    }
+
+    // Every block counts its boids into its own grid
+    const size_t blockSize = (count + blocks - 1) / blocks;
+    partials.resize(blocks * cells);
+    threads->parallelFor(blocks, 1, [&](size_t begin, size_t end) {
+        for (size_t block = begin; block < end; ++block) {
+            uint32_t *grid = &partials[block * cells];
+            std::fill(grid, grid + cells, 0);
+            for (size_t i = block * blockSize; i < std::min(count, (block + 1) * blockSize); ++i) {
+                ++grid[cellOf(boids[i].pos) * MAX_TEAMS + boids[i].team];
+            }
+        }
+    });
+
+    // Sum the grids, one range of cells per chunk
+    threads->parallelFor(cells, 4096, [&](size_t begin, size_t end) {
+        for (size_t cell = begin; cell < end; ++cell) {
+            uint32_t sum = 0;
+            for (size_t block = 0; block < blocks; ++block) {
+                sum += partials[block * cells + cell];
+            }
+            counts[cell] = sum;
+        }
+    });
+    finish();
+}
+
+void DensityGrid::clear() {
+    std::fill(counts.begin(), counts.end(), 0);
+}
+
+void DensityGrid::add(vec2 pos, int team) {
+    ++counts[cellOf(pos) * MAX_TEAMS + team];
+}
+
+void DensityGrid::finish() {
+    uint32_t maxCount = *std::max_element(counts.begin(), counts.end());
+    const float scale = 1.0f / std::log1p((float) std::max(maxCount, 1u));
+    for (size_t i = 0; i < counts.size(); ++i) {
+        intensity[i] = counts[i] ? std::log1p((float) counts[i]) * scale : 0.0f;
+    }
+}
+
+int DensityGrid::getColumns() const             { return columns; }
+int DensityGrid::getRows() const                { return rows; }
+float DensityGrid::getCellSize() const          { return cellSize; }
+const uint32_t *DensityGrid::getCounts() const  { return counts.data(); }
+const float *DensityGrid::getIntensity() const  { return intensity.data(); }
+
+size_t DensityGrid::memoryUsage() const {
+    return (counts.capacity() + partials.capacity()) * sizeof(uint32_t) + intensity.capacity() * sizeof(float);
+}
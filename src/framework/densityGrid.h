@@ -0,0 +1,54 @@
+#ifndef GRAPHICS_DENSITYGRID_H
+#define GRAPHICS_DENSITYGRID_H
+
+#include <cstdint>
+#include <vector>
+#include "threadPool.h"
+#include "../simulation/boid.h"
+
+using std::vector;
+
+/**
+ * @brief Coarse per-team boid counts over the world, drawn instead of the boids when zoomed out.
+ * @details One cell covers a few screen pixels, so the grid (and drawing it) scales with the screen
+ * rather than with the number of boids. Each team is one channel of getIntensity(), which fits the four
+ * channels of an RGBA texture (MAX_TEAMS is 4).
+ * @details The histogram is built in parallel: every thread counts a block of boids into its own copy
+ * of the grid, then the copies are summed cell by cell.
+ */
+class DensityGrid {
+public:
+    /// @brief Covers a world of the given size with cells of cellSize world pixels
+    void resize(float worldWidth, float worldHeight, float cellSize);
+
+    /// @brief Counts count boids into the grid, on threads if given
+    void build(const Boid *boids, size_t count, ThreadPool *threads);
+
+    /// @brief Empties the grid, for filling it with add() and finish()
+    void clear();
+    /// @brief Counts a single boid
+    void add(vec2 pos, int team);
+    /// @brief Computes getIntensity() after add()
+    void finish();
+
+    int getColumns() const;
+    int getRows() const;
+    float getCellSize() const;
+    /// @brief Boids of every team in every cell, MAX_TEAMS values per cell, row by row from the bottom
+    const uint32_t *getCounts() const;
+    /// @brief getCounts() mapped to [0, 1] on a log scale, so sparse regions stay visible next to dense ones
+    const float *getIntensity() const;
+    size_t memoryUsage() const;
+
+private:
+    int cellOf(vec2 pos) const;
+
+    int columns = 0, rows = 0;
+    float cellSize = 1;
+    vector<uint32_t> counts;
+    /// @brief One grid per thread while building
+    vector<uint32_t> partials;
+    vector<float> intensity;
+};
+
+#endif //GRAPHICS_DENSITYGRID_H
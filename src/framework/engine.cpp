@@ -1,19 +1,55 @@
 #include "engine.h"
+#include "glRenderer.h"
+#include "softwareRenderer.h"
+#include "nullRenderer.h"
+#include <algorithm>
 #include <cmath>
+#include <chrono>
+#include <fstream>
+
+using std::chrono::steady_clock;
 
 const color WHITE(1, 1, 1);
 const color BLACK(0, 0, 0);
 const color BLUE(0, 0, 1);
 const color YELLOW(1, 1, 0);
 const color RED(1, 0, 0);
-
-Engine::Engine() {
-    this->initWindow();
-    this->initShaders();
+const color GREEN(0, 1, 0);
+
+/// @brief Color used to draw each team, indexed by Boid::team
+const color TEAM_COLORS[MAX_TEAMS] = {RED, BLUE, YELLOW, GREEN};
+
+Engine::Engine(RenderBackend backend, const string &outputDir, unsigned long frameLimit,
+               FrameCapture::Format captureFormat)
+    : backend(backend), frameLimit(frameLimit) {
+    if (backend == RenderBackend::SOFTWARE) {
+        renderer = make_unique<SoftwareRenderer>(WIDTH, HEIGHT, outputDir, &threads);
+    } else if (backend == RenderBackend::NONE) {
+        renderer = make_unique<NullRenderer>();
+    } else {
+        this->initWindow();
+        this->initShaders();
+        auto glRenderer = make_unique<GLRenderer>(window, shapeShader, obstacleShader, spriteShader, heatmapShader);
+        if (!outputDir.empty()) {
+            capture = make_unique<FrameCapture>(WIDTH, HEIGHT, outputDir, captureFormat);
+            glRenderer->setCapture(capture.get());
+        }
+        renderer = std::move(glRenderer);
+    }
     this->initShapes();
+    this->initObstacles();
 }
 
-Engine::~Engine() {}
+/// @brief Milliseconds elapsed since start (steady_clock is read through the vDSO, no syscall)
+static float millisecondsSince(steady_clock::time_point start) {
+    return std::chrono::duration<float, std::milli>(steady_clock::now() - start).count();
+}
+
+Engine::~Engine() {
+    if (capture) {
+        capture->finish();
+    }
+}
 
 unsigned int Engine::initWindow(bool debug) {
     // glfw: initialize and configure
@@ -53,71 +89,178 @@ void Engine::initShaders() {
                                                   nullptr, "circle");
     shapeShader.use();
     shapeShader.setMatrix4("projection", this->PROJECTION);
+
+    obstacleShader = this->shaderManager->loadShader("../res/shaders/shape.vert",
+                                                     "../res/shaders/shape.frag",
+                                                     nullptr, "shape");
+    obstacleShader.use();
+    obstacleShader.setMatrix4("projection", this->PROJECTION);
+
+    spriteShader = this->shaderManager->loadShader("../res/shaders/sprite.vert",
+                                                   "../res/shaders/sprite.frag",
+                                                   nullptr, "sprite");
+    spriteShader.use();
+    spriteShader.setMatrix4("projection", this->PROJECTION);
+
+    heatmapShader = this->shaderManager->loadShader("../res/shaders/heatmap.vert",
+                                                    "../res/shaders/heatmap.frag",
+                                                    nullptr, "heatmap");
 }
 
 void Engine::initShapes() {
-    int numberOfBoids = 75;
-    int numberOfLeaders = numberOfBoids / 10;
-
-    float radius = 5;
-    float leaderRadius = 8;
-    float maxSpeed = 100;
-    float leaderMaxSpeed = maxSpeed * 0.60;
-
-    // init red normals
-    for (int i = 0; i < numberOfBoids; ++i) {
-        float x = rand() % WIDTH;
-        float y = rand() % HEIGHT;
-        vec2 position(x, y);
-        vec2 velocity(rand() % int(maxSpeed), rand() % int(maxSpeed));
-        vec4 red(RED.red, RED.green, RED.blue, 1);
-        unique_ptr<Circle> boid = make_unique<Circle>(shapeShader, position, radius, velocity, red);
-
-        boid->setVelocity(velocity);
-        boids.push_back(std::move(boid));
-    }
-    // init red leaders
-    for (int i = 0; i < numberOfLeaders; ++i) {
-        float x = rand() % WIDTH;
-        float y = rand() % HEIGHT;
-        vec2 position(x, y);
-        vec2 velocity(rand() % int(leaderMaxSpeed), rand() % int(leaderMaxSpeed));
-        vec4 red(RED.red, RED.green, RED.blue, 1);
-        unique_ptr<Circle> boid = make_unique<Circle>(shapeShader, position, leaderRadius, velocity, red);
-
-        boid->setVelocity(velocity);
-        boids.push_back(std::move(boid));
-    }
-
-    // init blue normals
-    for (int i = 0; i < numberOfBoids; ++i) {
-        float x = rand() % WIDTH;
-        float y = rand() % HEIGHT;
-        vec2 position(x, y);
-        vec2 velocity(rand() % int(maxSpeed), rand() % int(maxSpeed));
-        // get 3 random floats between 0 and 1 for RGB
-        vec4 blue(BLUE.red, BLUE.green, BLUE.blue, 1);
-        unique_ptr<Circle> boid = make_unique<Circle>(shapeShader, position, radius, velocity, blue);
-
-        boid->setVelocity(velocity);
-        boids.push_back(std::move(boid));
-    }
-    // init blue leaders
-    for (int i = 0; i < numberOfLeaders; ++i) {
-        float x = rand() % WIDTH;
-        float y = rand() % HEIGHT;
-        vec2 position(x, y);
-        vec2 velocity(rand() % int(leaderMaxSpeed), rand() % int(leaderMaxSpeed));
-        // get 3 random floats between 0 and 1 for RGB
-        vec4 blue(BLUE.red, BLUE.green, BLUE.blue, 1);
-        unique_ptr<Circle> boid = make_unique<Circle>(shapeShader, position, leaderRadius, velocity, blue);
-
-        boid->setVelocity(velocity);
-        boids.push_back(std::move(boid));
+    flock = make_unique<Flock>(WIDTH, HEIGHT, std::max(MAX_BOIDS, population));
+    flock->setThreadPool(&threads);
+    flock->setSortInterval(SORT_INTERVAL);
+
+    // Red and blue teams spread over the window, so the first steps have no pile-ups to resolve
+    flock->scatter(vec2(0, 0), vec2(WIDTH, HEIGHT), population, 2, (uint32_t) rand());
+}
+
+void Engine::initObstacles() {
+    ObstacleField &field = flock->getObstacles();
+    const color GREY(0.35, 0.35, 0.35);
+
+    // Two pillars
+    vec2 pillars[] = {vec2(WIDTH * 0.25f, HEIGHT * 0.5f), vec2(WIDTH * 0.75f, HEIGHT * 0.5f)};
+    for (vec2 pos : pillars) {
+        field.addCircle(pos, 60);
+        obstacles.push_back({Obstacle::CIRCLE, pos, vec2(60, 60), GREY});
+    }
+
+    // A wall across the middle
+    vec2 wallPos(WIDTH * 0.5f, HEIGHT * 0.5f), wallSize(40, HEIGHT * 0.4f);
+    field.addRect(wallPos, wallSize);
+    obstacles.push_back({Obstacle::RECT, wallPos, wallSize, GREY});
+
+    // Two wedges near the top and bottom edges
+    vec2 wedgeSize(160, 120);
+    vec2 wedges[] = {vec2(WIDTH * 0.5f, HEIGHT * 0.12f), vec2(WIDTH * 0.5f, HEIGHT * 0.88f)};
+    for (vec2 pos : wedges) {
+        field.addTriangle(pos, wedgeSize);
+        obstacles.push_back({Obstacle::TRIANGLE, pos, wedgeSize, GREY});
+    }
+
+    flock->bakeObstacles();
+}
+
+int Engine::decompose(int processes) {
+    if (flock->getSteeringInterval() > 1) {
+        cout << "| ERROR::ENGINE: Staggered steering does not run in worker processes, every boid steers every step"
+             << endl;
+        flock->setSteeringInterval(1);
+    }
+    flock->setUpdateMode(UpdateMode::SYNCHRONOUS);
+    domain = make_unique<DomainDecomposition>(*flock);
+    int started = domain->start(processes);
+    if (started) {
+        cout << "Running the flock in " << started << " worker processes" << endl;
+    } else {
+        domain.reset();
+    }
+    MemoryTracker::resetSteadyState();
+    return started;
+}
+
+void Engine::setPopulation(size_t count) {
+    population = count;
+    // The pool is sized when the flock is made: start over with one that fits
+    obstacles.clear();
+    initShapes();
+    initObstacles();
+    MemoryTracker::resetSteadyState();
+}
+
+void Engine::setSortInterval(int steps) {
+    flock->setSortInterval(steps);
+}
+
+void Engine::setSteeringInterval(int steps) {
+    flock->setSteeringInterval(steps);
+}
+
+void Engine::setCollisionMode(CollisionMode mode) {
+    flock->setCollisionMode(mode);
+}
+
+void Engine::setNeighborSkin(float skin) {
+    flock->setNeighborSkin(skin);
+}
+
+void Engine::setDeterministic(bool deterministic) {
+    this->deterministic = deterministic;
+    flock->setDeterministic(deterministic);
+}
+
+void Engine::enableAutotune(const string &cachePath) {
+    tuner = make_unique<AutoTuner>(*flock, threads, cachePath);
+}
+
+void Engine::setConfig(const SimConfig &config) {
+    flock->setConfig(config);
+}
+
+void Engine::setZoom(float zoom) {
+    this->zoom = std::clamp(zoom, MIN_ZOOM, MAX_ZOOM);
+}
+
+void Engine::setLodZoom(float lodZoom) {
+    this->lodZoom = lodZoom;
+}
+
+vec2 Engine::viewMin() const {
+    return viewCenter - vec2(WIDTH, HEIGHT) * (0.5f / zoom);
+}
+
+vec2 Engine::viewMax() const {
+    return viewCenter + vec2(WIDTH, HEIGHT) * (0.5f / zoom);
+}
+
+vec2 Engine::toWorld(vec2 screen) const {
+    return viewMin() + screen / zoom;
+}
+
+void Engine::useCompactStorage() {
+    if (domain) {
+        cout << "| ERROR::ENGINE: Compact storage does not run in worker processes" << endl;
+        return;
+    }
+    compact = make_unique<CompactFlock>(*flock);
+    compact->load(flock->getBoids());
+    // The pool is no longer drawn or updated
+    flock->getBoids().clear();
+    MemoryTracker::resetSteadyState();
+}
+
+bool Engine::startStream(const string &path) {
+    stream = make_unique<StreamServer>();
+    if (!stream->start(path, WIDTH, HEIGHT)) {
+        stream.reset();
+        return false;
     }
+    cout << "Streaming the boids on " << path << endl;
+    return true;
+}
+
+bool Engine::watchStream(const string &path) {
+    viewer = make_unique<StreamClient>(flock->getBoids().capacity());
+    if (!viewer->connect(path)) {
+        viewer.reset();
+        return false;
+    }
+    // The stream brings the boids; the flock only keeps the obstacles
+    flock->getBoids().clear();
+    MemoryTracker::resetSteadyState();
+    return true;
 }
 
 void Engine::processInput() {
+    MemoryTracker::Scope phase(MemoryTracker::Phase::INPUT);
+    steady_clock::time_point start = steady_clock::now();
+    // The software backend has no window to take input from
+    if (!window) {
+        telemetryFrame.inputTime = 0;
+        return;
+    }
     glfwPollEvents();
 
     // Close window if escape key is pressed
@@ -128,288 +271,456 @@ void Engine::processInput() {
     // Mouse position saved to check for collisions
     glfwGetCursorPos(window, &mouseX, &mouseY);
     mouseY = HEIGHT - mouseY; // make sure mouse y-axis isn't flipped
-}
 
-void Engine::checkBounds(unique_ptr<Circle> &boid1) const {
-    vec2 position = boid1->getPos();
-    vec2 velocity = boid1->getVelocity();
-    const int rotation = 5;
-    vec2 newVelocity;
-    newVelocity.x = boid1->getVelocity().x;
-    newVelocity.y = boid1->getVelocity().y;
-
-    position += velocity * deltaTime;
+    // = and - zoom, keeping the world under the cursor in place
+    bool zoomIn = keyPressed(GLFW_KEY_EQUAL), zoomOut = keyPressed(GLFW_KEY_MINUS);
+    if (zoomIn || zoomOut) {
+        vec2 anchor = toWorld(vec2(mouseX, mouseY));
+        setZoom(zoomIn ? zoom * ZOOM_STEP : zoom / ZOOM_STEP);
+        viewCenter += anchor - toWorld(vec2(mouseX, mouseY));
+    }
+    // From here on the cursor is in world coordinates
+    vec2 cursor = toWorld(vec2(mouseX, mouseY));
+    mouseX = cursor.x;
+    mouseY = cursor.y;
+
+    if (keyPressed(GLFW_KEY_SPACE)) {
+        Command command;
+        command.type = Command::Type::TOGGLE_PAUSE;
+        commands->push(command);
+    }
 
-    if (boid1->getPosX() < 125) {
-        newVelocity.x += rotation;
-        boid1->setVelocity(newVelocity);
-        if (boid1->getPosX() - boid1->getRadius() < 0) {
-            boid1->setPosX(boid1->getRadius());
+    // The workers, the compact copy or the streaming engine own the boids; edits to the flock would be lost
+    if (domain || compact || viewer) {
+        if (keyPressed(GLFW_KEY_M)) {
+            reportMemory();
         }
+        telemetryFrame.inputTime = millisecondsSince(start);
+        return;
+    }
+
+    // Left click spawns a new flock at the cursor, cycling through the teams
+    bool left = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS;
+    if (left && !leftPressed) {
+        Command command;
+        command.type = Command::Type::SPAWN;
+        command.pos = vec2(mouseX, mouseY);
+        command.count = SPAWN_COUNT;
+        command.team = spawnTeam;
+        commands->push(command);
+        spawnTeam = (spawnTeam + 1) % MAX_TEAMS;
+    }
+    leftPressed = left;
+
+    // Right click despawns every boid near the cursor
+    bool right = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS;
+    if (right && !rightPressed) {
+        Command command;
+        command.type = Command::Type::DESPAWN;
+        command.pos = vec2(mouseX, mouseY);
+        command.radius = DESPAWN_RADIUS;
+        commands->push(command);
     }
-    if (boid1->getPosX() > WIDTH - 125) {
-        newVelocity.x -= rotation;
-        boid1->setVelocity(newVelocity);
-        if (boid1->getPosX() - boid1->getRadius() > WIDTH) {
-            boid1->setPosX(boid1->getRadius());
+    rightPressed = right;
+
+    // Hold A to attract the boids to the cursor, R to push them away
+    bool attract = glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS;
+    bool repel = glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS;
+    FlowField &flowField = flock->getFlowField();
+    if (attract || repel) {
+        FlowField::Influence influence;
+        influence.type = attract ? FlowField::Type::ATTRACT : FlowField::Type::REPEL;
+        influence.pos = vec2(mouseX, mouseY);
+        influence.radius = 250;
+        influence.strength = 400;
+
+        // Only touch the field when the cursor moved or the key changed
+        if (mouseInfluenceId < 0) {
+            mouseInfluenceId = flowField.addInfluence(influence);
+        } else if (influence.pos != mouseInfluence.pos || influence.type != mouseInfluence.type) {
+            flowField.updateInfluence(mouseInfluenceId, influence);
         }
+        mouseInfluence = influence;
+    } else if (mouseInfluenceId >= 0) {
+        flowField.removeInfluence(mouseInfluenceId);
+        mouseInfluenceId = -1;
+    }
+
+    if (keyPressed(GLFW_KEY_Q)) {
+        bool quadTree = flock->getCohesionMode() == CohesionMode::QUADTREE;
+        flock->setCohesionMode(quadTree ? CohesionMode::DIRECT : CohesionMode::QUADTREE);
+        MemoryTracker::resetSteadyState();
+    }
+    if (keyPressed(GLFW_KEY_K)) {
+        bool topological = flock->getNeighborMode() == NeighborMode::TOPOLOGICAL;
+        flock->setNeighborMode(topological ? NeighborMode::METRIC : NeighborMode::TOPOLOGICAL);
+        MemoryTracker::resetSteadyState();
     }
-    if (boid1->getPosY() < 75) {
-        newVelocity.y += rotation;
-        boid1->setVelocity(newVelocity);
-        if (boid1->getPosY() - boid1->getRadius() < 0) {
-            boid1->setPosY(boid1->getRadius());
+    if (keyPressed(GLFW_KEY_S)) {
+        if (deterministic) {
+            cout << "| ERROR::ENGINE: Deterministic runs always update synchronously" << endl;
+        } else {
+            bool synchronous = flock->getUpdateMode() == UpdateMode::SYNCHRONOUS;
+            flock->setUpdateMode(synchronous ? UpdateMode::SEQUENTIAL : UpdateMode::SYNCHRONOUS);
+            cout << "Update: " << (synchronous ? "sequential" : "synchronous") << endl;
+            MemoryTracker::resetSteadyState();
         }
     }
-    if (boid1->getPosY() > HEIGHT - 75) {
-        newVelocity.y -= rotation;
-        boid1->setVelocity(newVelocity);
-        if (boid1->getPosY() - boid1->getRadius() > HEIGHT) {
-            boid1->setPosY(boid1->getRadius());
+    if (keyPressed(GLFW_KEY_C)) {
+        bool colored = flock->getCollisionMode() == CollisionMode::COLORED;
+        flock->setCollisionMode(colored ? CollisionMode::INLINE : CollisionMode::COLORED);
+        cout << "Collisions: " << (colored ? "inline" : "colored") << endl;
+        MemoryTracker::resetSteadyState();
+    }
+    if (keyPressed(GLFW_KEY_P)) {
+        // Rules read with --config are dropped once cycled past
+        Preset next = Preset::CLASSIC;
+        switch (flock->getPreset()) {
+            case Preset::CLASSIC:
+                next = Preset::SCHOOL;
+                break;
+            case Preset::SCHOOL:
+                next = Preset::SWARM;
+                break;
+            default:
+                break;
         }
+        Command command;
+        command.type = Command::Type::PRESET;
+        command.preset = next;
+        commands->push(command);
+    }
+    if (keyPressed(GLFW_KEY_M)) {
+        reportMemory();
     }
 
-    boid1->setPos(position);
-    boid1->setVelocity(newVelocity);
+    telemetryFrame.inputTime = millisecondsSince(start);
 }
 
-void Engine::update() {
-
-    // Calculate delta time
-    float currentFrame = glfwGetTime();
-    double distance;
-    deltaTime = currentFrame - lastFrame;
-    lastFrame = currentFrame;
-
-
-
-    for (unique_ptr<Circle> &boid1: boids) {
-
-        vec2 position = boid1->getPos();
-        vec2 velocity = boid1->getVelocity();
-        position += velocity * deltaTime;
-        boid1->setPos(position);
+bool Engine::keyPressed(int key) {
+    bool down = glfwGetKey(window, key) == GLFW_PRESS;
+    bool pressed = down && !keysDown[key];
+    keysDown[key] = down;
+    return pressed;
+}
 
+CommandQueue &Engine::getCommandQueue() {
+    return *commands;
+}
 
-        for (unique_ptr<Circle> &boid2: boids) {
-            // centroid boid vector
-            center(boid1, boid2);
-            // boid spacing
-            avoid(boid1, boid2);
-        }
+void Engine::runCommandScript(const string &path) {
+    script = make_unique<CommandScript>(commands, path);
+}
 
-        matchVelocity(boid1);
+void Engine::applyCommands() {
+    // Bounded, so a producer that never stops cannot hold up the step
+    Command command;
+    for (size_t i = 0; i < CommandQueue::CAPACITY && commands->pop(command); ++i) {
+        apply(command);
+    }
+}
 
-        // Check for collisions
-        for (unique_ptr<Circle> &other: boids) {
-            if (boid1 != other && boid1->isOverlapping(*other)) {
-                boid1->bounce(*other);
+void Engine::apply(const Command &command) {
+    switch (command.type) {
+        case Command::Type::PAUSE:
+            paused = true;
+            return;
+        case Command::Type::RESUME:
+            paused = false;
+            return;
+        case Command::Type::TOGGLE_PAUSE:
+            paused = !paused;
+            return;
+        case Command::Type::SNAPSHOT:
+            writeSnapshot(command.path);
+            return;
+        default:
+            break;
+    }
 
-                // change the color of regular boids hit by leader boids of opposing color
-                if (boid1->getRadius() == 8 && other->getRadius() != 8 && boid1->getColor4() != other->getColor4()) {
-                    other->setColor(boid1->getColor4());
-                }
+    // The workers or the compact copy own the boids, and the workers keep the rules they were started with
+    if (domain || compact || viewer) {
+        cout << "| ERROR::ENGINE: Commands that change the flock are ignored while "
+             << (domain ? "worker processes run it" : compact ? "it is stored compact" : "watching a stream") << endl;
+        return;
+    }
+    switch (command.type) {
+        case Command::Type::SPAWN:
+            // Scripts are checked when parsed, but any thread can post to the queue
+            if (command.team < 0 || command.team >= MAX_TEAMS) {
+                cout << "| ERROR::ENGINE: Ignored a spawn for team " << command.team << ", there are only "
+                     << MAX_TEAMS << " teams" << endl;
+                break;
             }
+            flock->spawnFlock(command.pos, command.count, command.team);
+            // The spatial indexes grow to fit the new boids
+            MemoryTracker::resetSteadyState();
+            break;
+        case Command::Type::DESPAWN:
+            flock->despawnNear(command.pos, command.radius);
+            MemoryTracker::resetSteadyState();
+            break;
+        case Command::Type::SET_RULE: {
+            SimConfig config = flock->getConfig();
+            config.*command.field = command.value;
+            flock->setConfig(config);
+            break;
         }
-
-        // Prevent boids from moving off screen
-        checkBounds(boid1);
-
-
-        // ensure no boid goes above the speed cap and flies off the screen
-        speedLimit(boid1);
+        case Command::Type::PRESET:
+            flock->setPreset(command.preset);
+            cout << "Rules: " << presetName(command.preset) << endl;
+            break;
+        default:
+            break;
     }
 }
 
-float distance(unique_ptr<Circle>& boid1, unique_ptr<Circle>& boid2) {
-    return sqrt(
-            (boid2->getPosX() - boid1->getPosX()) * (boid2->getPosX() - boid1->getPosX()) +
-            (boid2->getPosY() - boid1->getPosY()) * (boid2->getPosY() - boid1->getPosY())
-            );
+void Engine::writeSnapshot(const char *path) const {
+    // The stream allocates its buffers inside update(); snapshots are rare, so restart the warm-up
+    MemoryTracker::resetSteadyState();
+    std::ofstream file(path);
+    if (!file) {
+        cout << "| ERROR::ENGINE: Failed to write the snapshot " << path << endl;
+        return;
+    }
+    file << "# x y vx vy team leader" << endl;
+    auto write = [&file](const Boid &boid) {
+        file << boid.pos.x << ' ' << boid.pos.y << ' ' << boid.velocity.x << ' ' << boid.velocity.y << ' '
+             << boid.team << ' ' << boid.leader << '\n';
+    };
+    if (compact) {
+        compact->forEach(write);
+    } else {
+        for (const Boid &boid : flock->getBoids()) {
+            write(boid);
+        }
+    }
 }
 
-void Engine::center(unique_ptr<Circle> &boid1, unique_ptr<Circle> &boid2) {
-    const float centerCoefficient = 0.00001;
-    float centerX;
-    float centerY;
-    int numBoidsNear = 0;
-    vec2 newVelocity;
-    int dist = 200;
-    int minDist = 20;
-    // swarm leader
-    if (boid1->getRadius() == 8) {
-        if (boid1 != boid2 && boid1->getColor4() != boid2->getColor4()) {
-            if (distance(boid1, boid2) < dist && distance(boid1, boid2) > minDist
-                && boid1->getColor4() == boid2->getColor4()) {
-                centerX += boid2->getPosX();
-                centerY += boid2->getPosY();
-                ++numBoidsNear;
-            }
-        }
-        if (numBoidsNear) {
-            centerX /= (float) numBoidsNear;
-            centerY /= (float) numBoidsNear;
+void Engine::update() {
+    MemoryTracker::Scope phase(MemoryTracker::Phase::UPDATE);
+    steady_clock::time_point start = steady_clock::now();
+
+    // Step boundary: nothing else touches the flock now
+    applyCommands();
+
+    // Calculate delta time
+    float currentFrame = window && !deterministic ? glfwGetTime() : lastFrame + 1.0f / 60.0f;
+    deltaTime = currentFrame - lastFrame;
+    lastFrame = currentFrame;
 
-            newVelocity.x = boid1->getVelocity().x + ((centerX - boid1->getVelocity().x) * centerCoefficient);
-            newVelocity.y = boid1->getVelocity().y + ((centerY - boid1->getVelocity().y) * centerCoefficient);
+    if (viewer) {
+        // Nothing is stepped here: take the frames that arrived
+        viewer->receive();
+    }
+    if (paused || viewer) {
+        telemetryFrame.frameTime = deltaTime * 1000;
+        telemetryFrame.time = currentFrame;
+        telemetryFrame.updateTime = millisecondsSince(start);
+        return;
+    }
 
-            boid1->setVelocity(newVelocity);
+    if (domain && !domain->step(deltaTime)) {
+        // Carry on in this process from the last merged state
+        domain.reset();
+    }
+    if (compact) {
+        compact->update(deltaTime);
+    } else if (!domain) {
+        // Zoomed in, only the boids off screen take turns steering
+        if (zoom > 1) {
+            flock->setSteeringFocus(viewMin(), viewMax());
+        } else {
+            flock->setSteeringFocus(vec2(1, 1), vec2(0, 0));
         }
-    } else {
+        if (tuner) {
+            tuner->beginStep();
+            steady_clock::time_point stepStart = steady_clock::now();
+            flock->update(deltaTime);
+            tuner->endStep(millisecondsSince(stepStart));
+        } else {
+            flock->update(deltaTime);
+        }
+    }
 
-        if (boid1 != boid2 && boid1->getColor4() == boid2->getColor4()) {
-            if (distance(boid1, boid2) < dist && distance(boid1, boid2) > minDist
-                && boid1->getColor4() == boid2->getColor4()) {
-                centerX += boid2->getPosX();
-                centerY += boid2->getPosY();
-                ++numBoidsNear;
-            }
-            if (numBoidsNear) {
-                centerX /= (float) numBoidsNear;
-                centerY /= (float) numBoidsNear;
+    telemetryFrame.frameTime = deltaTime * 1000;
+    telemetryFrame.time = currentFrame;
+    telemetryFrame.updateTime = millisecondsSince(start);
+}
 
-                newVelocity.x = boid1->getVelocity().x + ((centerX - boid1->getVelocity().x) * centerCoefficient);
-                newVelocity.y = boid1->getVelocity().y + ((centerY - boid1->getVelocity().y) * centerCoefficient);
+void Engine::render() {
+    MemoryTracker::Scope phase(MemoryTracker::Phase::RENDER);
+    steady_clock::time_point start = steady_clock::now();
+
+    renderer->beginFrame(BLACK);
+    renderer->setView(viewMin(), viewMax());
+
+    for (const Obstacle &obstacle : obstacles) {
+        switch (obstacle.type) {
+            case Obstacle::CIRCLE:
+                renderer->drawCircle(obstacle.pos, obstacle.size.x, obstacle.fill);
+                break;
+            case Obstacle::RECT:
+                renderer->drawRect(obstacle.pos, obstacle.size, obstacle.fill);
+                break;
+            case Obstacle::TRIANGLE:
+                renderer->drawTriangle(obstacle.pos, obstacle.size, obstacle.fill);
+                break;
+        }
+    }
 
-                boid1->setVelocity(newVelocity);
-            }
+    if (zoom < lodZoom) {
+        // Cells stay DENSITY_CELL_PIXELS wide on screen, so the grid only changes size with the zoom
+        if (densityZoom != zoom) {
+            // Before resizing: strict mode aborts inside the allocation
+            MemoryTracker::resetSteadyState();
+            density.resize(WIDTH, HEIGHT, DENSITY_CELL_PIXELS / zoom);
+            densityZoom = zoom;
         }
-        numBoidsNear = 0;
-    }
-}
-
-void Engine::avoid(unique_ptr<Circle> &boid1, unique_ptr<Circle> &boid2) {
-    const int minDist = 20;
-    const float avoidCoeff = 0.05;
-    int moveX = 0;
-    int moveY = 0;
-    vec2 newVelocity;
-    // if swarm leader
-    if (boid1->getRadius() == 8) {
-        if (boid1 != boid2) {
-            if (distance(boid1, boid2) < minDist * 2 && boid1->getColor4() != boid2->getColor4()) {
-                // chase after boids of other colors
-                moveX += boid1->getPosX() - boid2->getPosX();
-                moveY += boid1->getPosY() - boid2->getPosY();
-                newVelocity.x = boid1->getVelocity().x + moveX;
-                newVelocity.y = boid1->getVelocity().y + moveY;
-                boid1->setVelocity(newVelocity);
-            } else if (distance(boid1, boid2) < minDist && boid1->getColor4() == boid2->getColor4()) {
-                moveX += boid1->getPosX() - boid2->getPosX();
-                moveY += boid1->getPosY() - boid2->getPosY();
-                newVelocity.x = boid1->getVelocity().x + moveX * avoidCoeff;
-                newVelocity.y = boid1->getVelocity().y + moveY * avoidCoeff;
-                boid1->setVelocity(newVelocity);
-            }
+        if (compact) {
+            density.clear();
+            compact->forEach([this](const Boid &boid) {
+                density.add(boid.pos, boid.team);
+            });
+            density.finish();
+        } else {
+            const BoidPool &boids = viewer ? viewer->getBoids() : flock->getBoids();
+            density.build(boids.begin(), boids.size(), &threads);
         }
+        renderer->drawDensity(density, TEAM_COLORS);
+    } else if (compact) {
+        compact->forEach([this](const Boid &boid) {
+            renderer->drawBoid(boid, TEAM_COLORS[boid.team]);
+        });
     } else {
-        if (boid1 != boid2) {
-            // case where boids are the same color
-            if (distance(boid1, boid2) < minDist && boid1->getColor4() == boid2->getColor4()) {
-                moveX += boid2->getPosX() - boid1->getPosX();
-                moveY += boid2->getPosY() - boid1->getPosY();
-                newVelocity.x = boid1->getVelocity().x + moveX * avoidCoeff;
-                newVelocity.y = boid1->getVelocity().y + moveY * avoidCoeff;
-                boid1->setVelocity(newVelocity);
-            } else if (distance(boid1, boid2) < minDist * 4 && !(boid1->getColor4() == boid2->getColor4())) {
-                moveX += boid1->getPosX() - boid2->getPosX();
-                moveY += boid1->getPosY() - boid2->getPosY();
-                newVelocity.x = boid1->getVelocity().x + moveX * 0.5 * avoidCoeff;
-                newVelocity.y = boid1->getVelocity().y + moveY * 0.5 * avoidCoeff;
-                boid1->setVelocity(newVelocity);
-            }
+        renderer->drawBoids(viewer ? viewer->getBoids() : flock->getBoids(), TEAM_COLORS);
+    }
 
+    renderer->endFrame();
+    ++frameCount;
+    MemoryTracker::endFrame();
 
-        }
+    telemetryFrame.renderTime = millisecondsSince(start);
+    publishTelemetry();
+    if (stream) {
+        publishStream();
     }
 }
-void Engine::matchVelocity(unique_ptr<Circle> &boid1){
-    const float matchCoeff = 0.05;
-    float avgVelocityX;
-    float avgVelocityY;
-    const float dist = 55;
-    vec2 newVelocity;
-    int numBoidsNear;
 
-    for (unique_ptr<Circle> &boid2: boids) {
+static_assert(TELEMETRY_TEAMS == MAX_TEAMS, "telemetry frames must have one counter per team");
 
-        if (distance(boid1, boid2) < dist) {
-            avgVelocityX += boid2->getVelocity().x;
-            avgVelocityY += boid2->getVelocity().y;
-            ++numBoidsNear;
-        }
+void Engine::publishTelemetry() {
+    // A viewer would take over the segment of the engine it watches
+    if (!telemetryStarted && !viewer) {
+        telemetryStarted = true;
+        telemetry.create();
     }
-    if (numBoidsNear) {
-        avgVelocityX /= (float) numBoidsNear;
-        avgVelocityY /= (float) numBoidsNear;
-
-        newVelocity.x = boid1->getVelocity().x + (avgVelocityX - boid1->getVelocity().x) * matchCoeff;
-        newVelocity.y = boid1->getVelocity().y + (avgVelocityY - boid1->getVelocity().y) * matchCoeff;
-        boid1->setVelocity(newVelocity);
-    }
-}
-
-void Engine::speedLimit(unique_ptr<Circle> &boid1){
-    const float speedLimit = 80;
-    float speed;
-    vec2 newVelocity;
-    speed = sqrt(boid1->getVelocity().x * boid1->getVelocity().x +
-            boid1->getVelocity().y * boid1->getVelocity().y);
-    if (boid1->getRadius() == 8) {
-        if (speed > speedLimit * 1.1) {
-            newVelocity.x = (boid1->getVelocity().x / speed) * speedLimit * 1.1;
-            newVelocity.y = (boid1->getVelocity().y / speed) * speedLimit * 1.1;
-            boid1->setVelocity(newVelocity);
-        } else if (speed < speedLimit / 2) {
-            if (boid1->getVelocity().x > 0) {
-                newVelocity.x = (boid1->getVelocity().x + 5);
-            } else {
-                newVelocity.x = (boid1->getVelocity().x - 5);
-            }
-            if (boid1->getVelocity().y > 0) {
-                newVelocity.y = (boid1->getVelocity().y + 5);
-            } else {
-                newVelocity.y = (boid1->getVelocity().y - 5);
-            }
-            boid1->setVelocity(newVelocity);
-        }
+    TelemetrySegment *segment = telemetry.getSegment();
+    if (!segment) {
+        return;
+    }
+
+    ++telemetryFrame.frame;
+    telemetryFrame.boids = compact ? compact->size() : flock->getBoids().size();
+    for (int team = 0; team < TELEMETRY_TEAMS; ++team) {
+        telemetryFrame.teams[team] = compact ? compact->getTeamCount(team) : flock->getTeamCount(team);
+    }
+    if (compact) {
+        telemetryFrame.contacts = compact->getContactCount();
     } else {
-        if (speed > speedLimit) {
-            newVelocity.x = (boid1->getVelocity().x / speed) * speedLimit;
-            newVelocity.y = (boid1->getVelocity().y / speed) * speedLimit;
-            boid1->setVelocity(newVelocity);
-        } else if (speed < speedLimit / 2) {
-            if (boid1->getVelocity().x > 0) {
-                newVelocity.x = (boid1->getVelocity().x + 3);
-            } else {
-                newVelocity.x = (boid1->getVelocity().x - 3);
-            }
-            if (boid1->getVelocity().y > 0) {
-                newVelocity.y = (boid1->getVelocity().y + 3);
-            } else {
-                newVelocity.y = (boid1->getVelocity().y - 3);
-            }
-            boid1->setVelocity(newVelocity);
-        }
+        telemetryFrame.contacts = domain ? domain->getContactCount() : flock->getContactCount();
     }
+    segment->write(telemetryFrame);
 }
 
+void Engine::publishStream() {
+    stream->beginFrame();
+    if (compact) {
+        // The compact flock keeps no ids: boids are sent by their place in cell order
+        uint32_t id = 0;
+        compact->forEach([this, &id](const Boid &boid) {
+            stream->add(id++, boid);
+        });
+    } else {
+        const BoidPool &boids = flock->getBoids();
+        for (size_t i = 0; i < boids.size(); ++i) {
+            stream->add(boids.handleAt(i).id, boids[i]);
+        }
+    }
+    stream->endFrame();
+}
 
+void Engine::reportMemory() const {
+    cout << "Heap allocations last frame:" << endl;
+    for (MemoryTracker::Phase phase : {MemoryTracker::Phase::INPUT, MemoryTracker::Phase::UPDATE,
+                                       MemoryTracker::Phase::RENDER, MemoryTracker::Phase::OTHER}) {
+        MemoryTracker::Counters counters = MemoryTracker::lastFrame(phase);
+        cout << "  " << MemoryTracker::phaseName(phase) << ": " << counters.allocations << " allocations ("
+             << counters.bytesAllocated << " bytes), " << counters.frees << " frees" << endl;
+    }
 
-void Engine::render() {
-    glClearColor(BLACK.red, BLACK.green, BLACK.blue, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT);
-
-    shapeShader.use();
-
-    for (unique_ptr<Circle>& boid : boids) {
-        boid->setUniforms();
-        boid->draw();
+    Flock::MemoryUsage sim = flock->memoryUsage();
+    cout << "Simulation memory:" << endl
+         << "  boid pool:     " << sim.boids << " bytes (" << flock->getBoids().size() << " / "
+         << flock->getBoids().capacity() << " boids)" << endl
+         << "  quadtree:      " << sim.quadTree << " bytes" << endl
+         << "  spatial grid:  " << sim.grid << " bytes" << endl
+         << "  obstacle grid: " << sim.obstacles << " bytes" << endl
+         << "  flow field:    " << sim.flowField << " bytes" << endl
+         << "  morton sort:   " << sim.sort << " bytes (every " << flock->getSortInterval() << " steps)" << endl;
+    const VerletList::Stats &lists = flock->getNeighborListStats();
+    cout << "  neighbor lists: " << sim.neighborLists << " bytes (" << lists.pairs << " entries, skin "
+         << flock->getNeighborSkin() << " px), rebuilt " << lists.rebuilds << " of " << lists.steps
+         << " synchronous steps, last rebuild " << lists.lastBuildMilliseconds << " ms" << endl;
+    const ContactSolver::Stats &contactStats = flock->getContactStats();
+    cout << "  contact colors: " << sim.contacts << " bytes, last step " << contactStats.pairs << " pairs in "
+         << contactStats.colors << " colors, " << contactStats.bounces << " bounced"
+         << (flock->getCollisionMode() == CollisionMode::COLORED ? "" : " (inline collisions in use)") << endl;
+    if (tuner) {
+        cout << "  ";
+        tuner->report(cout);
+    }
+    if (domain) {
+        cout << "  (boids updated by " << domain->getWorkerCount() << " worker processes)" << endl;
+    }
+    if (stream) {
+        cout << "Stream: " << stream->getViewerCount() << " viewers, " << stream->getDroppedFrames()
+             << " frames dropped for slow viewers, last delta " << stream->getDeltaBytes() << " bytes, last keyframe "
+             << stream->getKeyframeBytes() << " bytes" << endl;
+    }
+    if (viewer) {
+        cout << "  (boids received from a stream, frame " << viewer->getFrame() << ", "
+             << viewer->getBoids().size() << " boids)" << endl;
+    }
+    if (compact) {
+        CompactFlock::MemoryUsage usage = compact->memoryUsage();
+        cout << "Compact storage (" << compact->size() << " boids):" << endl
+             << "  boids:  " << usage.boids << " bytes" << endl
+             << "  cells:  " << usage.cells << " bytes" << endl
+             << "  movers: " << usage.movers << " bytes" << endl;
     }
 
-    glfwSwapBuffers(window);
+    cout << "Density grid: " << density.memoryUsage() << " bytes (" << density.getColumns() << " x "
+         << density.getRows() << " cells, zoom " << zoom << ", heatmap below " << lodZoom << ")" << endl;
+
+    Renderer::MemoryUsage render = renderer->memoryUsage();
+    const char *backendName = backend == RenderBackend::SOFTWARE ? "software"
+                              : backend == RenderBackend::NONE ? "none"
+                                                                : "OpenGL";
+    cout << "Renderer (" << backendName << "):" << endl
+         << "  vertices vectors: " << render.vertices << " bytes" << endl
+         << "  GL buffers:       " << render.buffers << " bytes" << endl
+         << "  framebuffer:      " << render.framebuffer << " bytes" << endl
+         << "Live heap: " << MemoryTracker::liveBytes() << " bytes, strict mode "
+         << (MemoryTracker::isStrict() ? "on" : "off") << endl;
 }
 
 bool Engine::shouldClose() {
-    return glfwWindowShouldClose(window);
+    if (frameLimit && frameCount >= frameLimit) {
+        return true;
+    }
+    if (viewer && !viewer->isConnected()) {
+        return true;
+    }
+    return window && glfwWindowShouldClose(window);
 }
\ No newline at end of file
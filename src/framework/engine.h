@@ -7,12 +7,20 @@
 #include <GLFW/glfw3.h>
 
 #include "shaderManager.h"
-#include "../shapes/circle.h"
-#include "../shapes/rect.h"
-#include "../shapes/shape.h"
-#include "../shapes/triangle.h"
+#include "memoryTracker.h"
+#include "telemetry.h"
+#include "renderer.h"
+#include "frameCapture.h"
+#include "threadPool.h"
+#include "densityGrid.h"
+#include "commandQueue.h"
+#include "autoTuner.h"
+#include "boidStream.h"
+#include "../simulation/flock.h"
+#include "../simulation/domainDecomposition.h"
+#include "../simulation/compactFlock.h"
 
-using std::vector, std::unique_ptr, std::make_unique, glm::ortho, glm::mat4, glm::vec3, glm::vec4;
+using std::vector, std::unique_ptr, std::shared_ptr, std::make_unique, std::string, glm::ortho, glm::mat4, glm::vec3, glm::vec4;
 
 /**
  * @brief The Engine class.
@@ -21,8 +29,20 @@ using std::vector, std::unique_ptr, std::make_unique, glm::ortho, glm::mat4, glm
 class Engine {
     private:
         /// @brief The actual GLFW window.
+        /// @details Stays null with the software and NONE backends, which run headless.
         GLFWwindow* window{};
 
+        /// @brief Which Renderer draws the frames
+        RenderBackend backend;
+        /// @brief Draws every frame (see GLRenderer, SoftwareRenderer and NullRenderer)
+        unique_ptr<Renderer> renderer;
+        /// @brief Number of frames to run before closing, 0 for no limit
+        unsigned long frameLimit;
+        /// @brief Number of frames rendered so far
+        unsigned long frameCount = 0;
+        /// @brief Records the OpenGL frames when an output directory is given
+        unique_ptr<FrameCapture> capture;
+
         /// @brief The width and height of the window.
         const unsigned int WIDTH = 1600, HEIGHT = 800; // Window dimensions
 
@@ -31,21 +51,130 @@ class Engine {
         unique_ptr<ShaderManager> shaderManager;
 
         // Shapes
-        vector<unique_ptr<Circle>> boids;
+        /// @brief Worker threads shared by the simulation and the software renderer
+        ThreadPool threads;
+        /// @brief Default number of steps between Morton sorts of the boids (see Flock::setSortInterval())
+        const int SORT_INTERVAL = 30;
+        /// @brief Simulation state of every boid
+        unique_ptr<Flock> flock;
+        /// @brief Worker processes running the flock, if decompose() was called
+        unique_ptr<DomainDecomposition> domain;
+        /// @brief Quantized copy of the flock that is simulated instead, if useCompactStorage() was called
+        unique_ptr<CompactFlock> compact;
+        /// @brief Tunes the grid, blocks and threads of the flock, if enableAutotune() was called
+        unique_ptr<AutoTuner> tuner;
+        /// @brief Sends every frame to viewer processes, if startStream() was called
+        unique_ptr<StreamServer> stream;
+        /// @brief Receives the boids of another engine instead of simulating them, if watchStream() was called
+        unique_ptr<StreamClient> viewer;
         const int RADIUS = 50;
 
+        /// @brief How to draw one static obstacle
+        struct Obstacle {
+            enum Type { CIRCLE, RECT, TRIANGLE } type;
+            vec2 pos;
+            /// @brief Radius in size.x for circles
+            vec2 size;
+            color fill;
+        };
+        /// @brief Static obstacles, drawn under the boids
+        vector<Obstacle> obstacles;
+
+        /// @brief Maximum number of boids alive at once (all memory is reserved up front)
+        const size_t MAX_BOIDS = 1 << 16;
+        /// @brief Boids placed by initShapes(), shared between two teams (see setPopulation())
+        size_t population = 164;
+        /// @brief Number of boids spawned by a left click
+        const int SPAWN_COUNT = 1000;
+        /// @brief Boids within this many pixels of the cursor are despawned by a right click
+        const float DESPAWN_RADIUS = 75;
+        /// @brief Team of the next flock spawned with the mouse
+        int spawnTeam = 0;
+        /// @brief Mouse button states from the previous frame, so a click is only handled once
+        bool leftPressed = false, rightPressed = false;
+        /// @brief Flow field influence that follows the cursor while A or R is held
+        FlowField::Influence mouseInfluence;
+        /// @brief Id of mouseInfluence in the flow field, -1 when not active
+        int mouseInfluenceId = -1;
+
+        /// @brief Magnification of the view: 2 shows a quarter of the world, 0.5 the world in a quarter of the window
+        float zoom = 1;
+        /// @brief World position at the center of the window
+        vec2 viewCenter = vec2(WIDTH / 2.0f, HEIGHT / 2.0f);
+        /// @brief Below this zoom the boids are drawn as a density heatmap instead (see setLodZoom())
+        float lodZoom = 1;
+        /// @brief Limits of the zoom, and the factor one press of = or - changes it by
+        const float MIN_ZOOM = 0.125f, MAX_ZOOM = 8, ZOOM_STEP = 1.25f;
+        /// @brief Side of a density grid cell in screen pixels, whatever the zoom
+        const float DENSITY_CELL_PIXELS = 4;
+        /// @brief Per team boid counts drawn instead of the boids when zoomed out
+        DensityGrid density;
+        /// @brief Zoom the density grid cells were sized for, 0 before the first heatmap
+        float densityZoom = 0;
+
+        /// @brief Corners of the world rectangle in the window
+        vec2 viewMin() const;
+        vec2 viewMax() const;
+        /// @brief Maps a window position (origin at the bottom left) to the world
+        vec2 toWorld(vec2 screen) const;
+
+        /// @brief Commands posted by the input handlers, scripts and other threads, applied at the start of update()
+        /// @details Shared with the script thread, which may outlive the engine while blocked on stdin.
+        shared_ptr<CommandQueue> commands = std::make_shared<CommandQueue>();
+        /// @brief Reads the script given to runCommandScript(), if any
+        unique_ptr<CommandScript> script;
+        /// @brief While set, update() applies commands but does not step the flock
+        bool paused = false;
+        /// @brief Steps a fixed 1/60 s and keeps the flock reproducible (see setDeterministic())
+        bool deterministic = false;
+
+        /// @brief Applies the commands posted since the last step
+        void applyCommands();
+        void apply(const Command &command);
+        /// @brief Writes every boid as a "x y vx vy team leader" line
+        void writeSnapshot(const char *path) const;
+
+        /// @brief Shared memory segment the frame stats are published to (see tools/telemetryReader.cpp)
+        Telemetry telemetry;
+        /// @brief Stats of the frame in progress
+        TelemetryFrame telemetryFrame;
+
+        /// @brief Set once the shared memory segment was created (on the first frame, unless watching a stream)
+        bool telemetryStarted = false;
+
+        /// @brief Writes telemetryFrame to the shared memory segment
+        void publishTelemetry();
+        /// @brief Sends the boids of the frame to the stream's viewers
+        void publishStream();
+
+        /// @brief Key states from the previous frame, used by keyPressed()
+        bool keysDown[GLFW_KEY_LAST + 1] = {};
+
+        /// @brief Returns true only on the frame the key goes down
+        bool keyPressed(int key);
+
         // Shaders
         Shader shapeShader;
+        Shader obstacleShader;
+        Shader spriteShader;
+        Shader heatmapShader;
 
         double mouseX, mouseY;
 
     public:
 
         /// @brief Constructor for the Engine class.
-        /// @details Initializes window and shaders.
-        Engine();
+        /// @details Initializes window and shaders, unless backend is SOFTWARE or NONE.
+        /// @param backend Which Renderer to draw with
+        /// @param outputDir Directory to write every frame to, empty to not record
+        /// @param frameLimit Number of frames to run before closing, 0 for no limit
+        /// @param captureFormat How OpenGL frames are recorded (the software backend always writes PPMs)
+        explicit Engine(RenderBackend backend = RenderBackend::OPENGL, const string &outputDir = "",
+                        unsigned long frameLimit = 0,
+                        FrameCapture::Format captureFormat = FrameCapture::Format::IMAGE_SEQUENCE);
 
         /// @brief Destructor for the Engine class.
+        /// @details Flushes the frame capture, so it must run before glfwTerminate().
         ~Engine();
 
         /// @brief Initializes the GLFW window.
@@ -53,24 +182,111 @@ class Engine {
         unsigned int initWindow(bool debug = false);
 
         /// @brief Loads shaders from files and stores them in the shaderManager.
-        /// @details Renderers are initialized here.
         void initShaders();
 
         /// @brief Initializes the shapes to be rendered.
+        /// @details Scatters population boids over the window without overlaps (see Flock::scatter()), seeded from rand().
         void initShapes();
 
+        /// @brief Places the static obstacles and bakes their distance grid.
+        void initObstacles();
+
+        /// @brief Runs the flock in worker processes, each owning a strip of the world
+        /// @details Switches the flock to UpdateMode::SYNCHRONOUS. While the workers run, input that changes the
+        /// boids (spawning, despawning, attractors, mode toggles) is ignored.
+        /// @return The number of workers started, 0 if the flock stays in this process
+        int decompose(int processes);
+
+        /// @brief Starts over with count boids, and room for at least MAX_BOIDS
+        /// @details Replaces the flock, so call it before anything else that changes the flock.
+        void setPopulation(size_t count);
+
+        /// @brief Sorts the boids along a Morton curve every steps updates (0 never sorts)
+        void setSortInterval(int steps);
+
+        /// @brief Recomputes each boid's neighbor steering only every steps updates (see Flock::setSteeringInterval())
+        /// @details While zoomed in, the boids on screen still steer every update. Not used by the compact storage,
+        /// and turned off by decompose().
+        void setSteeringInterval(int steps);
+
+        /// @brief Resolves the collisions of the sequential update in a separate parallel stage (see Flock::setCollisionMode())
+        void setCollisionMode(CollisionMode mode);
+
+        /// @brief Sets how far past the interaction radius the synchronous neighbor lists reach (see Flock::setNeighborSkin())
+        void setNeighborSkin(float skin);
+
+        /// @brief Makes runs bit-for-bit reproducible from the same seed, on any number of cores
+        /// @details Steps a fixed 1/60 s instead of the frame time and runs the flock deterministically
+        /// (see Flock::setDeterministic()), in parallel on the thread pool. Input still changes the run.
+        void setDeterministic(bool deterministic);
+
+        /// @brief Times the flock with several grid cell sizes, block sizes and thread counts and keeps the fastest
+        /// @details Tunes again when the population or density changes a lot. The choices are kept in cachePath
+        /// and reused by later runs on the same machine (see AutoTuner). Not used by decompose() or the compact storage.
+        void enableAutotune(const string &cachePath);
+
+        /// @brief Replaces the constants of the flocking rules (see Flock::setConfig())
+        /// @details Call before decompose(): the workers keep the rules they were started with.
+        void setConfig(const SimConfig &config);
+
+        /// @brief Magnifies the view around its center, clamped to [MIN_ZOOM, MAX_ZOOM]
+        void setZoom(float zoom);
+
+        /// @brief Draws a density heatmap instead of the boids while the zoom is below lodZoom
+        /// @details The heatmap costs the same at any population, so it pays off once boids get smaller than
+        /// a few pixels. 0 never switches to it.
+        void setLodZoom(float lodZoom);
+
+        /// @brief Queue for changing the simulation from any thread, e.g. a network or scripting thread
+        /// @details Commands are applied by the next update(), never in the middle of a step.
+        CommandQueue &getCommandQueue();
+
+        /// @brief Reads commands from a file, or stdin for "-", on a background thread (see CommandScript)
+        void runCommandScript(const string &path);
+
+        /// @brief Simulates the flock in quantized form (9 bytes per boid) from now on
+        /// @details Like decompose(), input that changes the boids is ignored afterwards.
+        void useCompactStorage();
+
+        /// @brief Streams every frame's boids to viewers connecting to the UNIX socket at path (see StreamServer)
+        /// @details Slow viewers skip frames instead of holding up the step. Works with every backend, most
+        /// usefully NONE, so the simulation does not spend time drawing.
+        /// @return false if the socket could not be created
+        bool startStream(const string &path);
+
+        /// @brief Shows the boids streamed by another engine on path instead of simulating them
+        /// @details The flock of this engine is emptied and never stepped, and input that changes the boids is
+        /// ignored; zoom still works. The engine closes when the stream ends.
+        /// @return false if nothing streams on path
+        bool watchStream(const string &path);
+
         /// @brief Processes input from the user.
         /// @details (e.g. keyboard input, mouse input, etc.)
+        /// @details Left click spawns a flock at the cursor, right click despawns the boids around it.
+        /// These, P and Space (pause) are posted to the command queue like any other command.
+        /// @details Q toggles the quadtree cohesion, K toggles the topological (k nearest) neighbor mode.
+        /// @details S toggles the synchronous update, which reuses neighbor lists between steps.
+        /// @details C toggles the parallel (colored) collision stage of the sequential update.
+        /// @details P cycles through the rule presets (classic, school, swarm).
+        /// @details Holding A attracts the boids to the cursor, holding R repels them.
+        /// @details = and - zoom in and out around the cursor.
+        /// @details M prints a memory report.
         void processInput();
 
         /// @brief Updates the game state.
         /// @details (e.g. collision detection, delta time, etc.)
+        /// @details The headless backends and deterministic runs step a fixed 1/60 s per frame, so their output does not
+        /// depend on how fast they render.
+        /// @details Queued commands are applied first.
         void update();
 
         /// @brief Renders the game state.
         /// @details Displays/renders objects on the screen.
         void render();
 
+        /// @brief Prints the heap allocations of the last frame and the memory used by each subsystem.
+        void reportMemory() const;
+
         /* deltaTime variables */
         float deltaTime = 0.0f; // Time between current frame and last frame
         float lastFrame = 0.0f; // Time of last frame (used to calculate deltaTime)
@@ -81,6 +297,7 @@ class Engine {
 
         /// @brief Returns true if the window should close.
         /// @details (Wrapper for glfwWindowShouldClose()).
+        /// @details Also true once frameLimit frames have been rendered, or once the watched stream has ended.
         /// @return true if the window should close
         /// @return false if the window should not close
         bool shouldClose();
@@ -95,18 +312,6 @@ class Engine {
         // 4th quadrant
         // mat4 PROJECTION = ortho(0.0f, static_cast<float>(WIDTH), static_cast<float>(HEIGHT), 0.0f, -1.0f, 1.0f);
 
-        /// @brief Checks for collisions between all boids
-        void checkCollisions();
-
-        /// @brief Prevents boids from going off screen
-        void checkBounds(unique_ptr<Circle> &bubble) const;
-
-        // my additions to engine.h:
-        void center(unique_ptr<Circle> &boid1, unique_ptr<Circle> &boid2);
-        void avoid(unique_ptr<Circle> &boid1, unique_ptr<Circle> &boid2);
-        void matchVelocity(unique_ptr<Circle> &boid1);
-        void speedLimit(unique_ptr<Circle> &boid1);
-
 };
 
 #endif //GRAPHICS_ENGINE_H
\ No newline at end of file
@@ -0,0 +1,186 @@
+#include "frameCapture.h"
+#include "image.h"
+
+#include <chrono>
+#include <iostream>
+
+using std::chrono::steady_clock;
+
+FrameCapture::FrameCapture(unsigned int width, unsigned int height, const string &outputDir, Format format)
+    : width(width), height(height), frameBytes((size_t) width * height * 4), outputDir(outputDir), format(format) {
+    glGenBuffers(RING_SIZE, pixelBuffers);
+    for (GLuint buffer : pixelBuffers) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, frameBytes, nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    if (format == Format::IMAGE_SEQUENCE) {
+        framePath.resize(outputDir.size() + 32);
+        ppmRow.resize(width * 3);
+    } else {
+        string path = outputDir + "/capture.rgba";
+        rawFile = std::fopen(path.c_str(), "wb");
+        if (!rawFile) {
+            std::cout << "| ERROR::CAPTURE: Failed to open " << path << std::endl;
+        }
+    }
+
+    writer = std::thread(&FrameCapture::writerLoop, this);
+}
+
+FrameCapture::~FrameCapture() {
+    finish();
+}
+
+void FrameCapture::capture() {
+    steady_clock::time_point start = steady_clock::now();
+
+    reclaim();
+
+    // The oldest buffer was read into LATENCY frames ago, so mapping it should not wait on the GPU
+    if (inFlight == LATENCY) {
+        retire((head - inFlight + RING_SIZE) % RING_SIZE);
+        --inFlight;
+    }
+
+    bool free;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        free = state[head] == State::FREE;
+        if (free) {
+            state[head] = State::READING;
+        }
+    }
+    if (free) {
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glReadBuffer(GL_BACK);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffers[head]);
+        // With a pixel pack buffer bound this only queues the copy and returns
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        bufferFrame[head] = frame;
+        head = (head + 1) % RING_SIZE;
+        ++inFlight;
+    } else {
+        // The writer still holds the buffer
+        ++dropped;
+    }
+    ++frame;
+
+    captureTime += std::chrono::duration<double, std::milli>(steady_clock::now() - start).count();
+    ++captures;
+}
+
+void FrameCapture::retire(int slot) {
+    // The buffer stays mapped while the writer reads it; reclaim() unmaps it afterwards
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffers[slot]);
+    void *pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, frameBytes, GL_MAP_READ_BIT);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!pixels) {
+        state[slot] = State::FREE;
+        ++dropped;
+        return;
+    }
+    state[slot] = State::WRITING;
+    mapped[slot] = static_cast<const unsigned char *>(pixels);
+    queue[(queueHead + queueSize) % RING_SIZE] = slot;
+    ++queueSize;
+    ready.notify_one();
+}
+
+void FrameCapture::reclaim() {
+    int done[RING_SIZE], count = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (int slot = 0; slot < RING_SIZE; ++slot) {
+            if (state[slot] == State::WRITTEN) {
+                state[slot] = State::FREE;
+                done[count++] = slot;
+            }
+        }
+    }
+    // Only this thread reads into the buffers, so they can be unmapped outside the lock
+    for (int i = 0; i < count; ++i) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffers[done[i]]);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    if (count > 0) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+}
+
+void FrameCapture::writerLoop() {
+    while (true) {
+        int slot;
+        const unsigned char *pixels;
+        unsigned long number;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            ready.wait(lock, [this] { return queueSize > 0 || stopping; });
+            if (queueSize == 0) {
+                return;
+            }
+            slot = queue[queueHead];
+            pixels = mapped[slot];
+            number = bufferFrame[slot];
+            queueHead = (queueHead + 1) % RING_SIZE;
+            --queueSize;
+        }
+
+        if (format == Format::RAW_VIDEO) {
+            if (rawFile) {
+                std::fwrite(pixels, 1, frameBytes, rawFile);
+            }
+        } else {
+            std::snprintf(framePath.data(), framePath.size(), "%s/frame_%06lu.ppm", outputDir.c_str(), number);
+            if (!writePPM(framePath.data(), pixels, width, height, ppmRow.data())) {
+                std::cout << "| ERROR::CAPTURE: Failed to write " << framePath.data() << std::endl;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        state[slot] = State::WRITTEN;
+        ++written;
+    }
+}
+
+void FrameCapture::finish() {
+    if (!writer.joinable()) {
+        return;
+    }
+
+    // Hand the writer the buffers still in flight, oldest first; it drains its queue before stopping
+    while (inFlight > 0) {
+        retire((head - inFlight + RING_SIZE) % RING_SIZE);
+        --inFlight;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    ready.notify_one();
+    writer.join();
+    reclaim();
+
+    glDeleteBuffers(RING_SIZE, pixelBuffers);
+    if (rawFile) {
+        std::fclose(rawFile);
+        rawFile = nullptr;
+    }
+    std::cout << "Captured " << written << " frames to " << outputDir << " (" << dropped << " dropped, "
+              << getAverageCaptureTime() << " ms per frame on the render thread)" << std::endl;
+}
+
+unsigned long FrameCapture::getWrittenFrames() const { return written; }
+
+unsigned long FrameCapture::getDroppedFrames() const { return dropped; }
+
+float FrameCapture::getAverageCaptureTime() const { return captures ? captureTime / captures : 0; }
+
+size_t FrameCapture::memoryUsage() const {
+    return RING_SIZE * frameBytes;
+}
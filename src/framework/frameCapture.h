@@ -0,0 +1,130 @@
+#ifndef GRAPHICS_FRAMECAPTURE_H
+#define GRAPHICS_FRAMECAPTURE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <glad/glad.h>
+
+using std::string, std::vector;
+
+/**
+ * @brief Records the frames drawn with OpenGL without stalling the render loop.
+ * @details capture() only queues an asynchronous glReadPixels of the back buffer into one of RING_SIZE pixel
+ * buffer objects. The buffer is mapped LATENCY frames later, once the GPU is done with it, and the mapped range
+ * is handed to a background thread that writes it to disk straight from there. The render thread never copies
+ * the pixels: it only unmaps the buffer in a later capture(), once the writer is done with it (unmapping needs
+ * the GL context). If the writer still holds the next buffer, the frame is dropped rather than blocking the
+ * render loop.
+ * @details Needs the GL context to be current for capture() and finish().
+ */
+class FrameCapture {
+public:
+    /// @brief How the captured frames are stored
+    enum class Format {
+        /// @brief One PPM per frame: DIR/frame_000000.ppm, ...
+        IMAGE_SEQUENCE,
+        /// @brief Every frame appended to DIR/capture.rgba (RGBA8, bottom row first)
+        RAW_VIDEO
+    };
+
+    /// @brief Number of pixel buffer objects, read back or held by the writer
+    static const int RING_SIZE = 5;
+    /// @brief Frames between reading a frame back and mapping it
+    static const int LATENCY = 2;
+
+    /// @brief Construct a new FrameCapture and start its writer thread
+    /// @param width The width of the framebuffer
+    /// @param height The height of the framebuffer
+    /// @param outputDir Directory to write the frames to
+    /// @param format How to store the frames
+    FrameCapture(unsigned int width, unsigned int height, const string &outputDir,
+                 Format format = Format::IMAGE_SEQUENCE);
+
+    /// @brief Calls finish()
+    ~FrameCapture();
+
+    FrameCapture(const FrameCapture &) = delete;
+    FrameCapture &operator=(const FrameCapture &) = delete;
+
+    /// @brief Starts reading back the current frame
+    /// @details Call after drawing and before swapping buffers.
+    void capture();
+
+    /// @brief Writes out the frames still in flight, stops the writer and frees the buffers
+    void finish();
+
+    // -----------------------------------
+    // Getters
+    // -----------------------------------
+
+    /// @brief Number of frames written so far
+    unsigned long getWrittenFrames() const;
+    /// @brief Number of frames dropped because the writer was behind
+    unsigned long getDroppedFrames() const;
+    /// @brief Average time capture() spent on the calling thread, in milliseconds
+    float getAverageCaptureTime() const;
+
+    /// @brief Bytes of pixel buffers held
+    size_t memoryUsage() const;
+
+private:
+    /// @brief Where each pixel buffer is in its cycle
+    enum class State {
+        /// @brief Can be read into
+        FREE,
+        /// @brief A glReadPixels into it is queued
+        READING,
+        /// @brief Mapped, queued for or being written by the writer
+        WRITING,
+        /// @brief Written, still mapped until the render thread unmaps it
+        WRITTEN
+    };
+
+    /// @brief Maps a pixel buffer and queues it for the writer
+    void retire(int slot);
+
+    /// @brief Unmaps the buffers the writer is done with
+    void reclaim();
+
+    /// @brief Writer thread: writes queued frames until stopped
+    void writerLoop();
+
+    unsigned int width, height;
+    size_t frameBytes;
+    string outputDir;
+    Format format;
+    FILE *rawFile = nullptr;
+
+    GLuint pixelBuffers[RING_SIZE] = {};
+    /// @brief Next pixel buffer to read into, and how many hold a frame not yet retired
+    int head = 0, inFlight = 0;
+    /// @brief Frame number of each pixel buffer's contents
+    unsigned long bufferFrame[RING_SIZE] = {};
+    unsigned long frame = 0;
+
+    /// @brief State and mapped pixels of each pixel buffer; guarded by mutex once the buffer is WRITING
+    State state[RING_SIZE] = {};
+    const unsigned char *mapped[RING_SIZE] = {};
+    /// @brief Ring of pixel buffers queued for the writer
+    int queue[RING_SIZE] = {}, queueHead = 0, queueSize = 0;
+    /// @brief PPM path and row buffers of the writer thread
+    vector<char> framePath;
+    vector<unsigned char> ppmRow;
+
+    std::mutex mutex;
+    std::condition_variable ready;
+    bool stopping = false;
+    std::thread writer;
+
+    std::atomic<unsigned long> written{0};
+    unsigned long dropped = 0;
+    double captureTime = 0;
+    unsigned long captures = 0;
+};
+
+#endif //GRAPHICS_FRAMECAPTURE_H
@@ -0,0 +1,117 @@
+#include "glRenderer.h"
+#include "densityGrid.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+/// @brief Heading that leaves a mesh upright
+static const vec2 UP(0, 1);
+
+GLRenderer::GLRenderer(GLFWwindow *window, Shader &circleShader, Shader &shapeShader, Shader &spriteShader,
+                       Shader &heatmapShader)
+    : window(window), spriteShader(spriteShader), heatmapShader(heatmapShader) {
+    // Radius 0.5 so the mesh covers exactly the circle once it is scaled by the diameter
+    circle = std::make_unique<Circle>(circleShader, vec2(0, 0), 0.5f, color());
+    rect = std::make_unique<Rect>(shapeShader, vec2(0, 0), vec2(1, 1), color());
+    triangle = std::make_unique<Triangle>(shapeShader, vec2(0, 0), vec2(1, 1), color());
+
+    int width, height;
+    glfwGetFramebufferSize(window, &width, &height);
+    view = vec4(0, 0, width, height);
+
+    glGenVertexArrays(1, &heatmapVAO);
+    glGenTextures(1, &densityTexture);
+    glBindTexture(GL_TEXTURE_2D, densityTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+GLRenderer::~GLRenderer() {
+    glDeleteTextures(1, &densityTexture);
+    glDeleteVertexArrays(1, &heatmapVAO);
+}
+
+void GLRenderer::beginFrame(const color &background) {
+    glClearColor(background.red, background.green, background.blue, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+}
+
+void GLRenderer::setView(vec2 min, vec2 max) {
+    view = vec4(min, max);
+    spriteShader.use();
+    spriteShader.setMatrix4("projection", glm::ortho(min.x, max.x, min.y, max.y, -1.0f, 1.0f));
+}
+
+void GLRenderer::drawCircle(vec2 center, float radius, const color &fill) {
+    queue.submit(spriteShader, *circle, {center, vec2(radius * 2, radius * 2), UP, fill.vec});
+}
+
+void GLRenderer::drawRect(vec2 pos, vec2 size, const color &fill) {
+    queue.submit(spriteShader, *rect, {pos, size, UP, fill.vec});
+}
+
+void GLRenderer::drawTriangle(vec2 pos, vec2 size, const color &fill) {
+    queue.submit(spriteShader, *triangle, {pos, size, UP, fill.vec});
+}
+
+void GLRenderer::drawTriangle(vec2 pos, vec2 size, vec2 heading, const color &fill) {
+    queue.submit(spriteShader, *triangle, {pos, size, heading, fill.vec});
+}
+
+void GLRenderer::drawDensity(const DensityGrid &grid, const color *teamColors) {
+    // Keep the draw order: what was queued so far goes under the heatmap
+    queue.flush();
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, densityTexture);
+    if (grid.getColumns() != textureColumns || grid.getRows() != textureRows) {
+        textureColumns = grid.getColumns();
+        textureRows = grid.getRows();
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, textureColumns, textureRows, 0, GL_RGBA, GL_FLOAT,
+                     grid.getIntensity());
+    } else {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, textureColumns, textureRows, GL_RGBA, GL_FLOAT, grid.getIntensity());
+    }
+
+    static_assert(MAX_TEAMS == 4, "the heatmap keeps one team per texture channel");
+    heatmapShader.use();
+    heatmapShader.setInteger("density", 0);
+    heatmapShader.setVector4f("view", view);
+    heatmapShader.setVector2f("gridSize", vec2(textureColumns, textureRows) * grid.getCellSize());
+    heatmapShader.setMatrix4("teamColors", glm::mat4(teamColors[0].vec, teamColors[1].vec, teamColors[2].vec,
+                                                     teamColors[3].vec));
+
+    // Teams add up, and the heatmap adds to what is under it
+    glBlendFunc(GL_ONE, GL_ONE);
+    glBindVertexArray(heatmapVAO);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glBindVertexArray(0);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void GLRenderer::endFrame() {
+    queue.flush();
+    if (capture) {
+        capture->capture();
+    }
+    glfwSwapBuffers(window);
+}
+
+void GLRenderer::setCapture(FrameCapture *capture) {
+    this->capture = capture;
+}
+
+Renderer::MemoryUsage GLRenderer::memoryUsage() const {
+    MemoryUsage usage;
+    usage.vertices = circle->getVertexMemory() + rect->getVertexMemory() + triangle->getVertexMemory();
+    usage.buffers = circle->getBufferMemory() + rect->getBufferMemory() + triangle->getBufferMemory() +
+                    queue.getBufferMemory() + (size_t) textureColumns * textureRows * 4 * sizeof(float);
+    usage.framebuffer = queue.getVertexMemory();
+    if (capture) {
+        usage.framebuffer += capture->memoryUsage();
+    }
+    return usage;
+}
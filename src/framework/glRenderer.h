@@ -0,0 +1,74 @@
+#ifndef GRAPHICS_GLRENDERER_H
+#define GRAPHICS_GLRENDERER_H
+
+#include <memory>
+#include <GLFW/glfw3.h>
+
+#include "renderer.h"
+#include "renderQueue.h"
+#include "shader.h"
+#include "frameCapture.h"
+#include "../shapes/circle.h"
+#include "../shapes/rect.h"
+#include "../shapes/triangle.h"
+
+using std::unique_ptr, glm::vec4;
+
+/**
+ * @brief Draws through OpenGL into the GLFW window.
+ * @details Keeps one Circle, Rect and Triangle as meshes and queues every draw as an instance of one of them,
+ * so drawing never creates GL objects. endFrame() submits the queue: one instanced draw per mesh, however many
+ * shapes and boids the frame has.
+ * @details drawDensity() keeps the grid in a float texture and draws it with one full-screen pass of the heatmap
+ * shader, after submitting what was queued before it.
+ */
+class GLRenderer : public Renderer {
+public:
+    /// @brief Construct a new GLRenderer
+    /// @param window The window to swap buffers on
+    /// @param circleShader Shader the Circle mesh is created with (circle.vert/frag)
+    /// @param shapeShader Shader the Rect and Triangle meshes are created with (shape.vert/frag)
+    /// @param spriteShader Instanced shader every draw goes through (sprite.vert/frag)
+    /// @param heatmapShader Shader drawDensity() draws with (heatmap.vert/frag)
+    GLRenderer(GLFWwindow *window, Shader &circleShader, Shader &shapeShader, Shader &spriteShader,
+               Shader &heatmapShader);
+    ~GLRenderer() override;
+
+    void beginFrame(const color &background) override;
+    void setView(vec2 min, vec2 max) override;
+    void drawCircle(vec2 center, float radius, const color &fill) override;
+    void drawRect(vec2 pos, vec2 size, const color &fill) override;
+    void drawTriangle(vec2 pos, vec2 size, const color &fill) override;
+    void drawTriangle(vec2 pos, vec2 size, vec2 heading, const color &fill) override;
+    void drawDensity(const DensityGrid &grid, const color *teamColors) override;
+    void endFrame() override;
+    MemoryUsage memoryUsage() const override;
+
+    /// @brief Reads every frame back into capture before it is swapped, or stops capturing if null
+    void setCapture(FrameCapture *capture);
+
+private:
+    GLFWwindow *window;
+    Shader &spriteShader;
+    Shader &heatmapShader;
+    /// @brief Records the frames if set (not owned)
+    FrameCapture *capture = nullptr;
+
+    unique_ptr<Circle> circle;
+    unique_ptr<Rect> rect;
+    unique_ptr<Triangle> triangle;
+
+    /// @brief Draws of the current frame
+    RenderQueue queue;
+
+    /// @brief World rectangle on screen, <vec2 min, vec2 max>
+    vec4 view;
+    /// @brief Empty vertex array bound for the full-screen pass (core profile needs one to draw)
+    unsigned int heatmapVAO = 0;
+    /// @brief Density grid texture, RGBA32F
+    unsigned int densityTexture = 0;
+    /// @brief Size of densityTexture in texels
+    int textureColumns = 0, textureRows = 0;
+};
+
+#endif //GRAPHICS_GLRENDERER_H
@@ -0,0 +1,30 @@
+#include "image.h"
+
+#include <cstdio>
+#include <vector>
+
+bool writePPM(const string &path, const unsigned char *rgba, unsigned int width, unsigned int height) {
+    std::vector<unsigned char> row(width * 3);
+    return writePPM(path.c_str(), rgba, width, height, row.data());
+}
+
+bool writePPM(const char *path, const unsigned char *rgba, unsigned int width, unsigned int height,
+              unsigned char *row) {
+    FILE *file = std::fopen(path, "wb");
+    if (!file) {
+        return false;
+    }
+    std::fprintf(file, "P6\n%u %u\n255\n", width, height);
+
+    // PPM rows go top to bottom
+    for (int y = (int) height - 1; y >= 0; --y) {
+        const unsigned char *pixel = rgba + (size_t) y * width * 4;
+        for (unsigned int x = 0; x < width; ++x, pixel += 4) {
+            row[x * 3] = pixel[0];
+            row[x * 3 + 1] = pixel[1];
+            row[x * 3 + 2] = pixel[2];
+        }
+        std::fwrite(row, 1, width * 3, file);
+    }
+    return std::fclose(file) == 0;
+}
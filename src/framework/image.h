@@ -0,0 +1,18 @@
+#ifndef GRAPHICS_IMAGE_H
+#define GRAPHICS_IMAGE_H
+
+#include <string>
+
+using std::string;
+
+/// @brief Writes an RGBA8 image to path as a binary PPM (alpha is dropped)
+/// @param rgba width * height pixels, bottom row first (the order glReadPixels returns them in)
+/// @return false if the file could not be written
+bool writePPM(const string &path, const unsigned char *rgba, unsigned int width, unsigned int height);
+
+/// @brief Same, converting each row in row (width * 3 bytes) instead of a buffer of its own
+/// @details Does not allocate, for writers that run every frame.
+bool writePPM(const char *path, const unsigned char *rgba, unsigned int width, unsigned int height,
+              unsigned char *row);
+
+#endif //GRAPHICS_IMAGE_H
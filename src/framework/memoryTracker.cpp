@@ -0,0 +1,141 @@
+#include "memoryTracker.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+namespace {
+    const int PHASES = (int) MemoryTracker::Phase::COUNT;
+
+    /// @brief Counters of the frame in progress and of the last complete frame, per phase
+    struct AtomicCounters {
+        std::atomic<uint64_t> allocations{0}, frees{0}, bytesAllocated{0}, bytesFreed{0};
+    };
+    AtomicCounters current[PHASES];
+    MemoryTracker::Counters previous[PHASES];
+    MemoryTracker::Counters totals;
+
+    /// @brief Each thread has its own phase; threads that never enter a Scope count as OTHER
+    thread_local int phase = (int) MemoryTracker::Phase::OTHER;
+    std::atomic<int64_t> live{0};
+#ifdef BOIDS_ASSERT_NO_ALLOC
+    std::atomic<bool> strict{true};
+#else
+    std::atomic<bool> strict{false};
+#endif
+    std::atomic<int> steadyFrames{0};
+
+    /// @brief Every block starts with a header holding its size, so delete knows how much was freed.
+    /// @details 16 bytes keeps the returned pointer aligned like malloc's.
+    const size_t HEADER = 16;
+
+    void *allocate(size_t bytes) {
+        void *block = std::malloc(bytes + HEADER);
+        if (!block) {
+            return nullptr;
+        }
+        *static_cast<size_t *>(block) = bytes;
+        MemoryTracker::recordAllocation(bytes);
+        return static_cast<char *>(block) + HEADER;
+    }
+
+    void release(void *ptr) {
+        if (!ptr) {
+            return;
+        }
+        void *block = static_cast<char *>(ptr) - HEADER;
+        MemoryTracker::recordFree(*static_cast<size_t *>(block));
+        std::free(block);
+    }
+}
+
+MemoryTracker::Scope::Scope(Phase phase) : previous(getPhase()) { setPhase(phase); }
+MemoryTracker::Scope::~Scope() { setPhase(previous); }
+
+void MemoryTracker::setPhase(Phase newPhase) { phase = (int) newPhase; }
+MemoryTracker::Phase MemoryTracker::getPhase() { return (Phase) phase; }
+
+void MemoryTracker::recordAllocation(size_t bytes) {
+    int p = phase;
+    current[p].allocations.fetch_add(1, std::memory_order_relaxed);
+    current[p].bytesAllocated.fetch_add(bytes, std::memory_order_relaxed);
+    live.fetch_add((int64_t) bytes, std::memory_order_relaxed);
+
+    if (strict.load(std::memory_order_relaxed) && steadyFrames.load(std::memory_order_relaxed) >= STEADY_FRAMES &&
+        (p == (int) Phase::UPDATE || p == (int) Phase::RENDER)) {
+        // No iostreams here: they could allocate and recurse
+        std::fprintf(stderr, "| ERROR::MEMORY: %zu byte allocation in steady-state %s phase\n",
+                     bytes, phaseName((Phase) p));
+        std::abort();
+    }
+}
+
+void MemoryTracker::recordFree(size_t bytes) {
+    int p = phase;
+    current[p].frees.fetch_add(1, std::memory_order_relaxed);
+    current[p].bytesFreed.fetch_add(bytes, std::memory_order_relaxed);
+    live.fetch_sub((int64_t) bytes, std::memory_order_relaxed);
+}
+
+void MemoryTracker::endFrame() {
+    for (int p = 0; p < PHASES; ++p) {
+        previous[p].allocations = current[p].allocations.exchange(0);
+        previous[p].frees = current[p].frees.exchange(0);
+        previous[p].bytesAllocated = current[p].bytesAllocated.exchange(0);
+        previous[p].bytesFreed = current[p].bytesFreed.exchange(0);
+
+        totals.allocations += previous[p].allocations;
+        totals.frees += previous[p].frees;
+        totals.bytesAllocated += previous[p].bytesAllocated;
+        totals.bytesFreed += previous[p].bytesFreed;
+    }
+    if (steadyFrames < STEADY_FRAMES) {
+        ++steadyFrames;
+    }
+}
+
+MemoryTracker::Counters MemoryTracker::lastFrame(Phase p) { return previous[(int) p]; }
+MemoryTracker::Counters MemoryTracker::total()             { return totals; }
+int64_t MemoryTracker::liveBytes()                          { return live.load(); }
+
+void MemoryTracker::setStrict(bool value) { strict = value; }
+bool MemoryTracker::isStrict()            { return strict; }
+void MemoryTracker::resetSteadyState()    { steadyFrames = 0; }
+
+const char *MemoryTracker::phaseName(Phase p) {
+    switch (p) {
+        case Phase::INPUT:  return "input";
+        case Phase::UPDATE: return "update";
+        case Phase::RENDER: return "render";
+        default:            return "other";
+    }
+}
+
+// --------------------------------------------------------
+// Replaced global allocation functions
+// --------------------------------------------------------
+
+void *operator new(size_t bytes) {
+    if (void *ptr = allocate(bytes)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t bytes) {
+    if (void *ptr = allocate(bytes)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new(size_t bytes, const std::nothrow_t &) noexcept   { return allocate(bytes); }
+void *operator new[](size_t bytes, const std::nothrow_t &) noexcept { return allocate(bytes); }
+
+void operator delete(void *ptr) noexcept                           { release(ptr); }
+void operator delete[](void *ptr) noexcept                         { release(ptr); }
+void operator delete(void *ptr, size_t) noexcept                   { release(ptr); }
+void operator delete[](void *ptr, size_t) noexcept                 { release(ptr); }
+void operator delete(void *ptr, const std::nothrow_t &) noexcept   { release(ptr); }
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept { release(ptr); }
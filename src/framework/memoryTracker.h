@@ -0,0 +1,81 @@
+#ifndef GRAPHICS_MEMORYTRACKER_H
+#define GRAPHICS_MEMORYTRACKER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Counts heap allocations made through the global operator new/delete.
+ * @details memoryTracker.cpp replaces the global operators, so every allocation is counted against the
+ * frame phase of the thread that makes it. Engine sets the phase in processInput(), update() and render()
+ * and calls endFrame() once per frame. ThreadPool workers take the phase of the thread that started the
+ * loop; any other thread (file writers, command scripts, ...) counts as OTHER.
+ * @details In strict mode (default when built with BOIDS_ASSERT_NO_ALLOC), any allocation during update()
+ * or render() aborts the program once the loop has reached a steady state, that is after
+ * STEADY_FRAMES frames without a call to resetSteadyState().
+ */
+class MemoryTracker {
+public:
+    enum class Phase { OTHER, INPUT, UPDATE, RENDER, COUNT };
+
+    struct Counters {
+        uint64_t allocations = 0;
+        uint64_t frees = 0;
+        uint64_t bytesAllocated = 0;
+        uint64_t bytesFreed = 0;
+    };
+
+    /// @brief Sets the phase for as long as it is in scope, then restores the previous one
+    class Scope {
+    public:
+        explicit Scope(Phase phase);
+        ~Scope();
+    private:
+        Phase previous;
+    };
+
+    /// @brief Frames to wait after a resetSteadyState() before strict mode kicks in
+    static const int STEADY_FRAMES = 120;
+
+    /// @brief Phase of the calling thread
+    static void setPhase(Phase phase);
+    static Phase getPhase();
+
+    /// @brief Moves the counters of the current frame into lastFrame() and starts a new frame
+    static void endFrame();
+
+    /// @brief Counters of the last complete frame for one phase
+    static Counters lastFrame(Phase phase);
+
+    /// @brief Counters since the start of the program, all phases together
+    static Counters total();
+
+    /// @brief Bytes currently allocated through operator new
+    static int64_t liveBytes();
+
+    /// @brief Turns strict (abort on steady-state allocation) mode on or off
+    static void setStrict(bool strict);
+    static bool isStrict();
+
+    /// @brief Call before expected allocations (spawning, resizing, ...) to restart the warm-up
+    static void resetSteadyState();
+
+    /// @brief Restarts the warm-up if list cannot hold size elements without growing
+    /// @details For buffers that keep their high-water mark: call before the growth, strict mode aborts inside it.
+    template <typename T>
+    static void expectGrowth(const std::vector<T> &list, size_t size) {
+        if (size > list.capacity()) {
+            resetSteadyState();
+        }
+    }
+
+    /// @brief Called by the replaced operator new and delete
+    static void recordAllocation(size_t bytes);
+    static void recordFree(size_t bytes);
+
+    /// @brief Name of a phase for reports
+    static const char *phaseName(Phase phase);
+};
+
+#endif //GRAPHICS_MEMORYTRACKER_H
@@ -0,0 +1,39 @@
+#include "nullRenderer.h"
+
+#include <algorithm>
+#include <thread>
+
+using std::chrono::steady_clock;
+
+NullRenderer::NullRenderer(float frameRate)
+    : period(frameRate > 0 ? std::chrono::duration_cast<steady_clock::duration>(
+                                 std::chrono::duration<float>(1.0f / frameRate))
+                           : steady_clock::duration::zero()),
+      nextFrame(steady_clock::now()) {}
+
+void NullRenderer::beginFrame(const color &) {}
+void NullRenderer::setView(vec2, vec2) {}
+void NullRenderer::drawCircle(vec2, float, const color &) {}
+void NullRenderer::drawRect(vec2, vec2, const color &) {}
+void NullRenderer::drawTriangle(vec2, vec2, const color &) {}
+void NullRenderer::drawTriangle(vec2, vec2, vec2, const color &) {}
+void NullRenderer::drawBoids(const BoidPool &, const color *) {}
+void NullRenderer::drawDensity(const DensityGrid &, const color *) {}
+
+void NullRenderer::endFrame() {
+    if (period == steady_clock::duration::zero()) {
+        return;
+    }
+    nextFrame += period;
+    steady_clock::time_point now = steady_clock::now();
+    if (nextFrame > now) {
+        std::this_thread::sleep_until(nextFrame);
+    } else {
+        // Running behind: start counting again from now instead of rushing the next frames
+        nextFrame = now;
+    }
+}
+
+Renderer::MemoryUsage NullRenderer::memoryUsage() const {
+    return MemoryUsage();
+}
@@ -0,0 +1,33 @@
+#ifndef GRAPHICS_NULLRENDERER_H
+#define GRAPHICS_NULLRENDERER_H
+
+#include <chrono>
+#include "renderer.h"
+
+/**
+ * @brief Draws nothing, for running the simulation headless (e.g. to stream it, see StreamServer).
+ * @details endFrame() waits for the next tick of frameRate, so a headless run steps in real time like a
+ * window with vsync would. A frame that took longer is not caught up on.
+ */
+class NullRenderer : public Renderer {
+public:
+    /// @param frameRate Frames per second to pace endFrame() to, 0 to run as fast as the simulation steps
+    explicit NullRenderer(float frameRate = 60);
+
+    void beginFrame(const color &background) override;
+    void setView(vec2 min, vec2 max) override;
+    void drawCircle(vec2 center, float radius, const color &fill) override;
+    void drawRect(vec2 pos, vec2 size, const color &fill) override;
+    void drawTriangle(vec2 pos, vec2 size, const color &fill) override;
+    void drawTriangle(vec2 pos, vec2 size, vec2 heading, const color &fill) override;
+    void drawBoids(const BoidPool &boids, const color *teamColors) override;
+    void drawDensity(const DensityGrid &grid, const color *teamColors) override;
+    void endFrame() override;
+    MemoryUsage memoryUsage() const override;
+
+private:
+    std::chrono::steady_clock::duration period;
+    std::chrono::steady_clock::time_point nextFrame;
+};
+
+#endif //GRAPHICS_NULLRENDERER_H
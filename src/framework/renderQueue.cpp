@@ -0,0 +1,118 @@
+#include "renderQueue.h"
+
+#include <algorithm>
+#include <cstddef>
+
+RenderQueue::RenderQueue() {
+    glGenBuffers(1, &instanceVBO);
+}
+
+RenderQueue::~RenderQueue() {
+    glDeleteBuffers(1, &instanceVBO);
+}
+
+void RenderQueue::submit(Shader &shader, const Shape &mesh, const Instance &instance) {
+    const uint64_t key = (uint64_t) shader.ID << 32 | mesh.getVAO();
+
+    // Requests come in runs of the same mesh, so the last group almost always matches
+    size_t group = groups.size();
+    if (!groups.empty() && groups.back().key == key) {
+        group = groups.size() - 1;
+    } else {
+        for (size_t i = 0; i < groups.size(); ++i) {
+            if (groups[i].key == key) {
+                group = i;
+                break;
+            }
+        }
+        if (group == groups.size()) {
+            groups.push_back({key, &shader, &mesh, 0, 0});
+        }
+    }
+
+    ++groups[group].count;
+    instances.push_back(instance);
+    instanceGroups.push_back((uint16_t) group);
+}
+
+int RenderQueue::flush() {
+    if (instances.empty()) {
+        groups.clear();
+        return 0;
+    }
+
+    // Counting sort: each group gets a contiguous range, in key order
+    groupOrder.resize(groups.size());
+    for (size_t i = 0; i < groupOrder.size(); ++i) {
+        groupOrder[i] = (uint16_t) i;
+    }
+    std::sort(groupOrder.begin(), groupOrder.end(),
+              [this](uint16_t a, uint16_t b) { return groups[a].key < groups[b].key; });
+    uint32_t start = 0;
+    for (uint16_t group : groupOrder) {
+        groups[group].start = start;
+        start += groups[group].count;
+    }
+
+    sorted.resize(instances.size());
+    for (size_t i = 0; i < instances.size(); ++i) {
+        sorted[groups[instanceGroups[i]].start++] = instances[i];
+    }
+
+    // One upload for the whole frame; orphan the old storage so the driver need not wait for the last frame
+    const size_t bytes = sorted.size() * sizeof(Instance);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    bufferSize = std::max(bufferSize, bytes);
+    glBufferData(GL_ARRAY_BUFFER, bufferSize, nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, sorted.data());
+
+    unsigned int program = 0;
+    for (uint16_t index : groupOrder) {
+        Group &group = groups[index];
+        // start was advanced past the group by the scatter
+        group.start -= group.count;
+        if (group.shader->ID != program) {
+            group.shader->use();
+            program = group.shader->ID;
+        }
+        bindInstances(*group.mesh, group.start);
+        group.mesh->drawInstanced((int) group.count);
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    int drawCalls = (int) groups.size();
+    groups.clear();
+    instances.clear();
+    instanceGroups.clear();
+    return drawCalls;
+}
+
+void RenderQueue::bindInstances(const Shape &mesh, uint32_t start) {
+    glBindVertexArray(mesh.getVAO());
+
+    const GLsizei stride = sizeof(Instance);
+    const char *base = reinterpret_cast<const char *>((size_t) start * sizeof(Instance));
+    // location 1: vec4 (pos, size), location 2: heading, location 3: color
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, stride, base + offsetof(Instance, pos));
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, base + offsetof(Instance, heading));
+    glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, stride, base + offsetof(Instance, color));
+
+    // Enabling the attributes and their divisors is VAO state: only needed once per mesh
+    if (std::find(preparedVAOs.begin(), preparedVAOs.end(), mesh.getVAO()) == preparedVAOs.end()) {
+        for (unsigned int location = 1; location <= 3; ++location) {
+            glEnableVertexAttribArray(location);
+            glVertexAttribDivisor(location, 1);
+        }
+        preparedVAOs.push_back(mesh.getVAO());
+    }
+}
+
+size_t RenderQueue::getVertexMemory() const {
+    return (instances.capacity() + sorted.capacity()) * sizeof(Instance) +
+           instanceGroups.capacity() * sizeof(uint16_t) + groups.capacity() * sizeof(Group);
+}
+
+size_t RenderQueue::getBufferMemory() const {
+    return bufferSize;
+}
@@ -0,0 +1,80 @@
+#ifndef GRAPHICS_RENDERQUEUE_H
+#define GRAPHICS_RENDERQUEUE_H
+
+#include <cstdint>
+#include <vector>
+#include "shader.h"
+#include "../shapes/shape.h"
+
+using std::vector;
+
+/**
+ * @brief Collects draw requests for the frame and submits them as one instanced draw per (shader, mesh).
+ * @details Any Shape can serve as the mesh: the queue only uses its VAO and drawInstanced(). Each request
+ * carries its own placement and color as instance attributes (locations 1-3, see sprite.vert), so the
+ * shape's uniforms are not used.
+ * @details Requests are grouped with a counting sort, so within a group they keep their submission order;
+ * groups are drawn in (shader, mesh) order.
+ */
+class RenderQueue {
+public:
+    /// @brief Per-instance attributes of one request
+    struct Instance {
+        /// @brief Center of the mesh in world pixels
+        vec2 pos;
+        /// @brief Scale of the mesh along right and heading
+        vec2 size;
+        /// @brief Unit vector the mesh's +y axis is turned to ((0, 1) leaves it upright)
+        vec2 heading;
+        vec4 color;
+    };
+
+    /// @brief Creates the instance buffer; needs a current GL context
+    RenderQueue();
+    ~RenderQueue();
+
+    RenderQueue(const RenderQueue &) = delete;
+    RenderQueue &operator=(const RenderQueue &) = delete;
+
+    /// @brief Queues one copy of mesh, drawn with shader
+    /// @details shader and mesh must stay alive until flush().
+    void submit(Shader &shader, const Shape &mesh, const Instance &instance);
+
+    /// @brief Sorts the requests, uploads them in one buffer update and issues one draw per group
+    /// @return The number of draw calls issued
+    int flush();
+
+    /// @brief Bytes used by the request lists on the CPU
+    size_t getVertexMemory() const;
+    /// @brief Bytes of the instance buffer on the GPU
+    size_t getBufferMemory() const;
+
+private:
+    /// @brief Requests that share a shader and a mesh
+    struct Group {
+        uint64_t key;
+        Shader *shader;
+        const Shape *mesh;
+        uint32_t count, start;
+    };
+
+    /// @brief Points the instance attributes of mesh's VAO at the instances of one group
+    void bindInstances(const Shape &mesh, uint32_t start);
+
+    vector<Group> groups;
+    /// @brief Indices into groups, sorted by key
+    vector<uint16_t> groupOrder;
+    /// @brief Requests in submission order, and the index of their group
+    vector<Instance> instances;
+    vector<uint16_t> instanceGroups;
+    /// @brief Requests ordered by group, as uploaded
+    vector<Instance> sorted;
+    /// @brief VAOs whose instance attributes are already enabled
+    vector<unsigned int> preparedVAOs;
+
+    unsigned int instanceVBO = 0;
+    /// @brief Size of the instance buffer in bytes
+    size_t bufferSize = 0;
+};
+
+#endif //GRAPHICS_RENDERQUEUE_H
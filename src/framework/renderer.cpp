@@ -0,0 +1,14 @@
+#include "renderer.h"
+
+void Renderer::drawBoid(const Boid &boid, const color &fill) {
+    // A boid that stands still keeps pointing up
+    float speed = glm::length(boid.velocity);
+    vec2 heading = speed > 0 ? boid.velocity / speed : vec2(0, 1);
+    drawTriangle(boid.pos, vec2(2, 3) * boid.radius, heading, fill);
+}
+
+void Renderer::drawBoids(const BoidPool &boids, const color *teamColors) {
+    for (const Boid &boid : boids) {
+        drawBoid(boid, teamColors[boid.team]);
+    }
+}
@@ -0,0 +1,73 @@
+#ifndef GRAPHICS_RENDERER_H
+#define GRAPHICS_RENDERER_H
+
+#include <cstddef>
+#include "color.h"
+#include "../simulation/boidPool.h"
+
+using glm::vec2;
+
+class DensityGrid;
+
+/// @brief Which Renderer the Engine draws with
+enum class RenderBackend {
+    /// @brief OpenGL in a GLFW window
+    OPENGL,
+    /// @brief CPU rasterizer, headless (no window or GL driver needed)
+    SOFTWARE,
+    /// @brief Draws nothing, headless, in real time (see NullRenderer)
+    NONE
+};
+
+/**
+ * @brief Interface between the Engine and whatever draws the frame.
+ * @details Positions and sizes are in world pixels with the origin at the bottom left, like PROJECTION.
+ * Rects and triangles are centered on pos and scaled by size, like the Rect and Triangle shapes.
+ * setView() picks the part of the world that fills the frame.
+ */
+class Renderer {
+public:
+    /// @brief Bytes used by the renderer
+    struct MemoryUsage {
+        /// @brief vertices/indices vectors of the shapes
+        size_t vertices = 0;
+        /// @brief Buffers uploaded to the GPU
+        size_t buffers = 0;
+        /// @brief CPU side framebuffer and command lists
+        size_t framebuffer = 0;
+    };
+
+    virtual ~Renderer() = default;
+
+    /// @brief Starts a frame by clearing it to background
+    virtual void beginFrame(const color &background) = 0;
+
+    /// @brief Stretches the world rectangle from min to max over the whole frame
+    /// @details Until called, the frame shows the world at one pixel per world pixel from the origin.
+    virtual void setView(vec2 min, vec2 max) = 0;
+
+    virtual void drawCircle(vec2 center, float radius, const color &fill) = 0;
+    virtual void drawRect(vec2 pos, vec2 size, const color &fill) = 0;
+    virtual void drawTriangle(vec2 pos, vec2 size, const color &fill) = 0;
+    /// @brief Draws the triangle turned so its tip points along heading (a unit vector)
+    virtual void drawTriangle(vec2 pos, vec2 size, vec2 heading, const color &fill) = 0;
+
+    /// @brief Draws one boid as a triangle pointing where it flies
+    void drawBoid(const Boid &boid, const color &fill);
+
+    /// @brief Draws every boid in the color of its team
+    /// @details Calls drawBoid() for each boid; backends override it with something faster.
+    virtual void drawBoids(const BoidPool &boids, const color *teamColors);
+
+    /// @brief Draws the grid as a heatmap over the whole view, in one pass whatever the number of boids
+    /// @details Each team adds its color scaled by its DensityGrid::getIntensity(), clamped to white.
+    /// The grid is read when drawn, not kept.
+    virtual void drawDensity(const DensityGrid &grid, const color *teamColors) = 0;
+
+    /// @brief Finishes the frame (swaps buffers, writes an image, ...)
+    virtual void endFrame() = 0;
+
+    virtual MemoryUsage memoryUsage() const = 0;
+};
+
+#endif //GRAPHICS_RENDERER_H
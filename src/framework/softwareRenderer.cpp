@@ -0,0 +1,273 @@
+#include "softwareRenderer.h"
+#include "image.h"
+#include "densityGrid.h"
+#include "memoryTracker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+SoftwareRenderer::SoftwareRenderer(unsigned int width, unsigned int height, const string &outputDir,
+                                   ThreadPool *threads)
+    : width(width), height(height), outputDir(outputDir), pixels(width * height), threads(threads) {
+    tilesX = (int) (width + TILE_SIZE - 1) / TILE_SIZE;
+    tilesY = (int) (height + TILE_SIZE - 1) / TILE_SIZE;
+    bins.resize(tilesX * tilesY);
+    if (!outputDir.empty()) {
+        framePath.resize(outputDir.size() + 32);
+        ppmRow.resize(width * 3);
+    }
+}
+
+uint32_t SoftwareRenderer::pack(const color &fill) {
+    auto channel = [](float value) { return (uint32_t) std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f); };
+    return channel(fill.red) | channel(fill.green) << 8 | channel(fill.blue) << 16 | channel(fill.alpha) << 24;
+}
+
+void SoftwareRenderer::beginFrame(const color &background) {
+    this->background = pack(background);
+    primitives.clear();
+}
+
+void SoftwareRenderer::setView(vec2 min, vec2 max) {
+    // The frame keeps its aspect ratio, so one scale fits both axes
+    viewMin = min;
+    viewScale = width / (max.x - min.x);
+}
+
+vec2 SoftwareRenderer::toScreen(vec2 pos) const {
+    return (pos - viewMin) * viewScale;
+}
+
+void SoftwareRenderer::add(Primitive primitive, vec2 min, vec2 max) {
+    // A pixel is covered when its center is inside, so round the bounds inwards to pixel centers
+    primitive.x0 = std::max((int) std::ceil(min.x - 0.5f), 0);
+    primitive.y0 = std::max((int) std::ceil(min.y - 0.5f), 0);
+    primitive.x1 = std::min((int) std::floor(max.x - 0.5f), (int) width - 1);
+    primitive.y1 = std::min((int) std::floor(max.y - 0.5f), (int) height - 1);
+    if (primitive.x0 > primitive.x1 || primitive.y0 > primitive.y1) {
+        return;
+    }
+    MemoryTracker::expectGrowth(primitives, primitives.size() + 1);
+    primitives.push_back(primitive);
+}
+
+void SoftwareRenderer::drawCircle(vec2 center, float radius, const color &fill) {
+    center = toScreen(center);
+    radius *= viewScale;
+    Primitive circle{Type::CIRCLE, pack(fill), center};
+    circle.radius = radius;
+    add(circle, center - vec2(radius, radius), center + vec2(radius, radius));
+}
+
+void SoftwareRenderer::drawRect(vec2 pos, vec2 size, const color &fill) {
+    pos = toScreen(pos);
+    size *= viewScale;
+    Primitive rect{Type::RECT, pack(fill), pos - size * 0.5f, pos + size * 0.5f};
+    add(rect, rect.a, rect.b);
+}
+
+void SoftwareRenderer::drawTriangle(vec2 pos, vec2 size, const color &fill) {
+    pos = toScreen(pos);
+    size *= viewScale;
+    // Same corners as Triangle::initVectors()
+    Primitive triangle{Type::TRIANGLE, pack(fill),
+                       pos + vec2(-0.5f, -0.5f) * size, pos + vec2(0.5f, -0.5f) * size, pos + vec2(0.0f, 0.5f) * size};
+    add(triangle, glm::min(triangle.a, glm::min(triangle.b, triangle.c)),
+        glm::max(triangle.a, glm::max(triangle.b, triangle.c)));
+}
+
+void SoftwareRenderer::drawTriangle(vec2 pos, vec2 size, vec2 heading, const color &fill) {
+    pos = toScreen(pos);
+    size *= viewScale;
+    // Triangle::initVectors() corners, with +y turned to heading like sprite.vert
+    vec2 right(heading.y, -heading.x);
+    auto corner = [&](float x, float y) { return pos + right * (x * size.x) + heading * (y * size.y); };
+    Primitive triangle{Type::TRIANGLE, pack(fill), corner(-0.5f, -0.5f), corner(0.5f, -0.5f), corner(0.0f, 0.5f)};
+    add(triangle, glm::min(triangle.a, glm::min(triangle.b, triangle.c)),
+        glm::max(triangle.a, glm::max(triangle.b, triangle.c)));
+}
+
+void SoftwareRenderer::drawBoids(const BoidPool &boids, const color *teamColors) {
+    MemoryTracker::expectGrowth(primitives, primitives.size() + boids.size());
+    primitives.reserve(primitives.size() + boids.size());
+    for (const Boid &boid : boids) {
+        drawBoid(boid, teamColors[boid.team]);
+    }
+}
+
+void SoftwareRenderer::drawDensity(const DensityGrid &grid, const color *teamColors) {
+    densityColumns = grid.getColumns();
+    densityRows = grid.getRows();
+    density.assign(grid.getIntensity(), grid.getIntensity() + (size_t) densityColumns * densityRows * MAX_TEAMS);
+    for (int team = 0; team < MAX_TEAMS; ++team) {
+        densityColors[team] = teamColors[team].vec;
+    }
+
+    Primitive heatmap{Type::DENSITY, 0, toScreen(vec2(0, 0))};
+    heatmap.radius = grid.getCellSize() * viewScale;
+    add(heatmap, heatmap.a, heatmap.a + vec2(densityColumns, densityRows) * heatmap.radius);
+}
+
+void SoftwareRenderer::endFrame() {
+    // Bin the primitives into every tile their bounds overlap
+    for (vector<uint32_t> &bin : bins) {
+        bin.clear();
+    }
+    for (uint32_t i = 0; i < primitives.size(); ++i) {
+        const Primitive &primitive = primitives[i];
+        for (int ty = primitive.y0 / TILE_SIZE; ty <= primitive.y1 / TILE_SIZE; ++ty) {
+            for (int tx = primitive.x0 / TILE_SIZE; tx <= primitive.x1 / TILE_SIZE; ++tx) {
+                vector<uint32_t> &bin = bins[ty * tilesX + tx];
+                MemoryTracker::expectGrowth(bin, bin.size() + 1);
+                bin.push_back(i);
+            }
+        }
+    }
+
+    auto rasterize = [this](size_t begin, size_t end) {
+        for (size_t tile = begin; tile < end; ++tile) {
+            rasterizeTile((int) tile);
+        }
+    };
+    if (threads) {
+        threads->parallelFor(bins.size(), 1, rasterize);
+    } else {
+        rasterize(0, bins.size());
+    }
+
+    if (!outputDir.empty()) {
+        std::snprintf(framePath.data(), framePath.size(), "%s/frame_%06lu.ppm", outputDir.c_str(), frame);
+        // Pixels are packed R, G, B, A from the lowest byte, see writePPM()
+        if (!::writePPM(framePath.data(), reinterpret_cast<const unsigned char *>(pixels.data()), width, height,
+                        ppmRow.data())) {
+            std::cout << "| ERROR::RENDERER: Failed to write " << framePath.data() << std::endl;
+        }
+    }
+    ++frame;
+}
+
+void SoftwareRenderer::rasterizeTile(int tile) {
+    int x0 = (tile % tilesX) * TILE_SIZE, y0 = (tile / tilesX) * TILE_SIZE;
+    int x1 = std::min(x0 + TILE_SIZE, (int) width) - 1, y1 = std::min(y0 + TILE_SIZE, (int) height) - 1;
+
+    for (int y = y0; y <= y1; ++y) {
+        std::fill(pixels.begin() + y * width + x0, pixels.begin() + y * width + x1 + 1, background);
+    }
+
+    for (uint32_t index : bins[tile]) {
+        const Primitive &primitive = primitives[index];
+        int px0 = std::max(primitive.x0, x0), px1 = std::min(primitive.x1, x1);
+        int py0 = std::max(primitive.y0, y0), py1 = std::min(primitive.y1, y1);
+        switch (primitive.type) {
+            case Type::CIRCLE:
+                fillCircle(primitive, px0, py0, px1, py1);
+                break;
+            case Type::RECT:
+                fillRect(primitive, px0, py0, px1, py1);
+                break;
+            case Type::TRIANGLE:
+                fillTriangle(primitive, px0, py0, px1, py1);
+                break;
+            case Type::DENSITY:
+                fillDensity(primitive, px0, py0, px1, py1);
+                break;
+        }
+    }
+}
+
+void SoftwareRenderer::fillCircle(const Primitive &circle, int x0, int y0, int x1, int y1) {
+    const float radius2 = circle.radius * circle.radius;
+    for (int y = y0; y <= y1; ++y) {
+        float dy = y + 0.5f - circle.a.y;
+        float rest = radius2 - dy * dy;
+        uint32_t *row = &pixels[y * width];
+        int x = x0;
+#ifdef __SSE2__
+        // Four pixels per iteration: keep the old pixel where (dx * dx > rest), write the color elsewhere
+        const __m128 restV = _mm_set1_ps(rest);
+        const __m128i colorV = _mm_set1_epi32((int) circle.color);
+        __m128 dx = _mm_setr_ps(x + 0.5f - circle.a.x, x + 1.5f - circle.a.x,
+                                x + 2.5f - circle.a.x, x + 3.5f - circle.a.x);
+        const __m128 four = _mm_set1_ps(4.0f);
+        for (; x + 3 <= x1; x += 4) {
+            __m128i inside = _mm_castps_si128(_mm_cmple_ps(_mm_mul_ps(dx, dx), restV));
+            __m128i old = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + x));
+            __m128i blended = _mm_or_si128(_mm_and_si128(inside, colorV), _mm_andnot_si128(inside, old));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(row + x), blended);
+            dx = _mm_add_ps(dx, four);
+        }
+#endif
+        for (; x <= x1; ++x) {
+            float dx = x + 0.5f - circle.a.x;
+            if (dx * dx <= rest) {
+                row[x] = circle.color;
+            }
+        }
+    }
+}
+
+void SoftwareRenderer::fillRect(const Primitive &rect, int x0, int y0, int x1, int y1) {
+    for (int y = y0; y <= y1; ++y) {
+        std::fill(pixels.begin() + y * width + x0, pixels.begin() + y * width + x1 + 1, rect.color);
+    }
+}
+
+void SoftwareRenderer::fillTriangle(const Primitive &triangle, int x0, int y0, int x1, int y1) {
+    // Edge functions; dividing by the signed area makes them positive inside for either winding
+    auto edge = [](vec2 a, vec2 b, vec2 p) { return (b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x); };
+    float area = edge(triangle.a, triangle.b, triangle.c);
+    if (area == 0) {
+        return;
+    }
+    for (int y = y0; y <= y1; ++y) {
+        for (int x = x0; x <= x1; ++x) {
+            vec2 p(x + 0.5f, y + 0.5f);
+            if (edge(triangle.a, triangle.b, p) / area >= 0 && edge(triangle.b, triangle.c, p) / area >= 0 &&
+                edge(triangle.c, triangle.a, p) / area >= 0) {
+                pixels[y * width + x] = triangle.color;
+            }
+        }
+    }
+}
+
+void SoftwareRenderer::fillDensity(const Primitive &heatmap, int x0, int y0, int x1, int y1) {
+    // Nearest cell per pixel, added to the pixel like the GL heatmap (which filters between cells)
+    const float cellsPerPixel = 1.0f / heatmap.radius;
+    for (int y = y0; y <= y1; ++y) {
+        int row = std::min((int) ((y + 0.5f - heatmap.a.y) * cellsPerPixel), densityRows - 1);
+        for (int x = x0; x <= x1; ++x) {
+            int column = std::min((int) ((x + 0.5f - heatmap.a.x) * cellsPerPixel), densityColumns - 1);
+            const float *cell = &density[((size_t) row * densityColumns + column) * MAX_TEAMS];
+            vec4 heat(0.0f);
+            for (int team = 0; team < MAX_TEAMS; ++team) {
+                heat += densityColors[team] * cell[team];
+            }
+            uint32_t &pixel = pixels[y * width + x];
+            color under((pixel & 0xff) / 255.0f, (pixel >> 8 & 0xff) / 255.0f, (pixel >> 16 & 0xff) / 255.0f);
+            pixel = pack(color(under.vec + heat));
+        }
+    }
+}
+
+bool SoftwareRenderer::writePPM(const string &path) const {
+    // Pixels are packed R, G, B, A from the lowest byte, which is RGBA8 byte order on little-endian machines
+    return ::writePPM(path, reinterpret_cast<const unsigned char *>(pixels.data()), width, height);
+}
+
+const vector<uint32_t> &SoftwareRenderer::getPixels() const { return pixels; }
+
+Renderer::MemoryUsage SoftwareRenderer::memoryUsage() const {
+    MemoryUsage usage;
+    usage.framebuffer = pixels.capacity() * sizeof(uint32_t) + primitives.capacity() * sizeof(Primitive) +
+                        density.capacity() * sizeof(float);
+    for (const vector<uint32_t> &bin : bins) {
+        usage.framebuffer += bin.capacity() * sizeof(uint32_t);
+    }
+    return usage;
+}
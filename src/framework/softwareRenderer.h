@@ -0,0 +1,112 @@
+#ifndef GRAPHICS_SOFTWARERENDERER_H
+#define GRAPHICS_SOFTWARERENDERER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "renderer.h"
+#include "threadPool.h"
+
+using std::vector, std::string;
+
+/**
+ * @brief Rasterizes the frame on the CPU into an in-memory framebuffer.
+ * @details Draw calls are only recorded. endFrame() bins them into square tiles, then rasterizes the tiles in
+ * parallel: each tile is owned by one thread, so no locking is needed and draw order within a tile is kept.
+ * Circle spans are tested several pixels at a time with SSE2 when available.
+ * @details drawDensity() records one primitive covering the whole frame that samples the grid per pixel.
+ * @details If an output directory is given, every frame is written there as a binary PPM image
+ * (frame_000000.ppm, frame_000001.ppm, ...), ready for ffmpeg.
+ */
+class SoftwareRenderer : public Renderer {
+public:
+    /// @brief Side of a square tile in pixels
+    static const int TILE_SIZE = 64;
+
+    /// @brief Construct a new SoftwareRenderer
+    /// @param width The width of the framebuffer
+    /// @param height The height of the framebuffer
+    /// @param outputDir Directory to write frames to, or empty to keep them in memory only
+    /// @param threads Rasterizes the tiles, or nullptr for this thread only; not owned
+    SoftwareRenderer(unsigned int width, unsigned int height, const string &outputDir = "",
+                     ThreadPool *threads = nullptr);
+
+    void beginFrame(const color &background) override;
+    void setView(vec2 min, vec2 max) override;
+    void drawCircle(vec2 center, float radius, const color &fill) override;
+    void drawRect(vec2 pos, vec2 size, const color &fill) override;
+    void drawTriangle(vec2 pos, vec2 size, const color &fill) override;
+    void drawTriangle(vec2 pos, vec2 size, vec2 heading, const color &fill) override;
+    void drawBoids(const BoidPool &boids, const color *teamColors) override;
+    void drawDensity(const DensityGrid &grid, const color *teamColors) override;
+    void endFrame() override;
+    MemoryUsage memoryUsage() const override;
+
+    /// @brief Pixels of the last frame, RGBA8, bottom row first
+    const vector<uint32_t> &getPixels() const;
+
+    /// @brief Writes the last frame to path as a binary PPM
+    /// @return false if the file could not be written
+    bool writePPM(const string &path) const;
+
+private:
+    enum class Type { CIRCLE, RECT, TRIANGLE, DENSITY };
+
+    /// @brief A recorded draw call
+    struct Primitive {
+        Type type = Type::CIRCLE;
+        uint32_t color = 0;
+        /// @brief Circle center and radius, or the corners of a rect/triangle
+        /// @details For the density grid, a is where its origin lands and radius is the side of a cell, in pixels.
+        vec2 a = vec2(0, 0), b = vec2(0, 0), c = vec2(0, 0);
+        float radius = 0;
+        /// @brief Pixel bounds (inclusive) clipped to the framebuffer
+        int x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+    };
+
+    /// @brief Clips the primitive's bounds and records it (skipped if fully off screen)
+    void add(Primitive primitive, vec2 min, vec2 max);
+
+    /// @brief Rasterizes every primitive binned to one tile
+    void rasterizeTile(int tile);
+
+    void fillCircle(const Primitive &circle, int x0, int y0, int x1, int y1);
+    void fillRect(const Primitive &rect, int x0, int y0, int x1, int y1);
+    void fillTriangle(const Primitive &triangle, int x0, int y0, int x1, int y1);
+    void fillDensity(const Primitive &density, int x0, int y0, int x1, int y1);
+
+    /// @brief Maps a world position to framebuffer pixels (see setView())
+    vec2 toScreen(vec2 pos) const;
+
+    /// @brief Packs a color into RGBA8
+    static uint32_t pack(const color &fill);
+
+    unsigned int width, height;
+    int tilesX, tilesY;
+    string outputDir;
+    unsigned long frame = 0;
+    /// @brief Path of the frame being written and one converted PPM row, sized once so writing frames
+    /// does not allocate
+    vector<char> framePath;
+    vector<unsigned char> ppmRow;
+
+    /// @brief World position at the bottom left of the frame, and pixels per world pixel
+    vec2 viewMin = vec2(0, 0);
+    float viewScale = 1;
+
+    /// @brief Intensities and colors copied by drawDensity(), so the grid can change before endFrame()
+    vector<float> density;
+    int densityColumns = 0, densityRows = 0;
+    vec4 densityColors[MAX_TEAMS];
+
+    uint32_t background = 0;
+    vector<uint32_t> pixels;
+    vector<Primitive> primitives;
+    /// @brief Indices of the primitives overlapping each tile, in draw order
+    vector<vector<uint32_t>> bins;
+
+    ThreadPool *threads;
+};
+
+#endif //GRAPHICS_SOFTWARERENDERER_H
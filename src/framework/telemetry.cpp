@@ -0,0 +1,106 @@
+#include "telemetry.h"
+
+#include <cstring>
+#include <iostream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#define TELEMETRY_POSIX
+#endif
+
+void TelemetrySegment::write(const TelemetryFrame &value) {
+    uint32_t start = sequence.load(std::memory_order_relaxed);
+    // Odd: a write is in progress
+    sequence.store(start + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(&frame, &value, sizeof(TelemetryFrame));
+    sequence.store(start + 2, std::memory_order_release);
+}
+
+bool TelemetrySegment::read(TelemetryFrame &out) const {
+    uint32_t before = sequence.load(std::memory_order_acquire);
+    if (before & 1) {
+        return false;
+    }
+    std::memcpy(&out, &frame, sizeof(TelemetryFrame));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return sequence.load(std::memory_order_relaxed) == before;
+}
+
+Telemetry::~Telemetry() {
+    close();
+}
+
+bool Telemetry::create(const char *name) {
+    close();
+#ifdef TELEMETRY_POSIX
+    int fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+    if (fd < 0 || ftruncate(fd, sizeof(TelemetrySegment)) != 0) {
+        std::cout << "| ERROR::TELEMETRY: Failed to create shared memory segment " << name << std::endl;
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        return false;
+    }
+    void *memory = mmap(nullptr, sizeof(TelemetrySegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (memory == MAP_FAILED) {
+        return false;
+    }
+
+    segment = static_cast<TelemetrySegment *>(memory);
+    segment->sequence.store(0);
+    segment->frame = TelemetryFrame();
+    segment->version = TelemetrySegment::VERSION;
+    // Written last so readers never see a half initialized segment
+    std::atomic_thread_fence(std::memory_order_release);
+    segment->magic = TelemetrySegment::MAGIC;
+
+    std::strncpy(owned, name, sizeof(owned) - 1);
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool Telemetry::open(const char *name) {
+    close();
+#ifdef TELEMETRY_POSIX
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) {
+        return false;
+    }
+    void *memory = mmap(nullptr, sizeof(TelemetrySegment), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (memory == MAP_FAILED) {
+        return false;
+    }
+
+    segment = static_cast<TelemetrySegment *>(memory);
+    if (segment->magic != TelemetrySegment::MAGIC || segment->version != TelemetrySegment::VERSION) {
+        std::cout << "| ERROR::TELEMETRY: " << name << " has an unknown layout" << std::endl;
+        close();
+        return false;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+void Telemetry::close() {
+#ifdef TELEMETRY_POSIX
+    if (segment) {
+        munmap(segment, sizeof(TelemetrySegment));
+    }
+    if (owned[0]) {
+        shm_unlink(owned);
+    }
+#endif
+    segment = nullptr;
+    owned[0] = '\0';
+}
+
+TelemetrySegment *Telemetry::getSegment() const { return segment; }
@@ -0,0 +1,88 @@
+#ifndef GRAPHICS_TELEMETRY_H
+#define GRAPHICS_TELEMETRY_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+/// @brief Default name of the shared memory segment
+#define TELEMETRY_SEGMENT_NAME "/boids_telemetry"
+
+/// @brief Number of team counters in a frame (matches MAX_TEAMS in boid.h)
+const int TELEMETRY_TEAMS = 4;
+
+/// @brief Stats published for every frame
+/// @details Plain fixed-size data: this struct is shared between processes, so only add fields at the end
+/// and bump TelemetrySegment::VERSION.
+struct TelemetryFrame {
+    uint64_t frame = 0;
+    /// @brief Seconds since the engine started
+    double time = 0;
+    /// @brief Time between the last two frames, in milliseconds
+    float frameTime = 0;
+    /// @brief Time spent in processInput(), update() and render(), in milliseconds
+    float inputTime = 0, updateTime = 0, renderTime = 0;
+    uint32_t boids = 0;
+    uint32_t teams[TELEMETRY_TEAMS] = {};
+    /// @brief Number of boid collisions resolved in the last update()
+    uint32_t contacts = 0;
+};
+
+/**
+ * @brief Layout of the shared memory segment.
+ * @details The single writer protects frame with a seqlock: sequence is odd while a write is in progress.
+ * Readers copy the frame and retry if sequence was odd or changed during the copy, so neither side ever
+ * blocks and writing is just a few stores into mapped memory (no syscalls).
+ */
+struct TelemetrySegment {
+    static const uint32_t MAGIC = 0x42444953; // "BDIS"
+    static const uint32_t VERSION = 1;
+
+    uint32_t magic;
+    uint32_t version;
+    std::atomic<uint32_t> sequence;
+    TelemetryFrame frame;
+
+    /// @brief Publishes a frame (single writer only)
+    void write(const TelemetryFrame &value);
+
+    /// @brief Copies a consistent frame into out
+    /// @return false if the writer was busy; just try again later
+    bool read(TelemetryFrame &out) const;
+};
+
+/**
+ * @brief Owns a mapping of the telemetry segment.
+ * @details The publisher creates the segment (and unlinks it when destroyed); readers attach read-only.
+ * Opening and closing are the only calls that make syscalls. On platforms without POSIX shared memory
+ * open() fails and the engine runs without telemetry.
+ */
+class Telemetry {
+public:
+    Telemetry() = default;
+    ~Telemetry();
+
+    Telemetry(const Telemetry &) = delete;
+    Telemetry &operator=(const Telemetry &) = delete;
+
+    /// @brief Creates the segment for publishing
+    /// @return true on success
+    bool create(const char *name = TELEMETRY_SEGMENT_NAME);
+
+    /// @brief Attaches to an existing segment for reading
+    /// @return true on success
+    bool open(const char *name = TELEMETRY_SEGMENT_NAME);
+
+    /// @brief Unmaps the segment (and unlinks it if this object created it)
+    void close();
+
+    /// @brief The mapped segment, or nullptr if not open
+    TelemetrySegment *getSegment() const;
+
+private:
+    TelemetrySegment *segment = nullptr;
+    /// @brief Name of the segment if this object created it (so it can unlink it), empty otherwise
+    char owned[64] = {};
+};
+
+#endif //GRAPHICS_TELEMETRY_H
@@ -0,0 +1,96 @@
+#include "threadPool.h"
+#include <algorithm>
+
+ThreadPool::ThreadPool(unsigned int threads) {
+    if (threads == 0) {
+        threads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    // The calling thread works too, so start one fewer worker
+    limit = threads;
+    for (unsigned int i = 1; i < threads; ++i) {
+        workers.emplace_back(&ThreadPool::workerLoop, this, i - 1);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+}
+
+unsigned int ThreadPool::getThreadCount() const {
+    return (unsigned int) workers.size() + 1;
+}
+
+void ThreadPool::setThreadLimit(unsigned int threads) {
+    std::lock_guard<std::mutex> lock(mutex);
+    limit = std::clamp(threads, 1u, getThreadCount());
+}
+
+unsigned int ThreadPool::getThreadLimit() const {
+    return limit;
+}
+
+void ThreadPool::run(size_t count, size_t chunk, Body body, void *context) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        this->body = body;
+        this->context = context;
+        phase = MemoryTracker::getPhase();
+        this->count = count;
+        this->chunk = chunk;
+        next = 0;
+        busy = (unsigned int) workers.size();
+        ++generation;
+    }
+    wake.notify_all();
+
+    work();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this] { return busy == 0; });
+}
+
+void ThreadPool::work() {
+    while (true) {
+        size_t begin = next.fetch_add(chunk);
+        if (begin >= count) {
+            return;
+        }
+        body(context, begin, std::min(begin + chunk, count));
+    }
+}
+
+void ThreadPool::workerLoop(unsigned int index) {
+    unsigned long seen = 0;
+    while (true) {
+        bool active;
+        MemoryTracker::Phase loopPhase;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) {
+                return;
+            }
+            seen = generation;
+            active = index + 1 < limit;
+            loopPhase = phase;
+        }
+
+        if (active) {
+            MemoryTracker::Scope scope(loopPhase);
+            work();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            --busy;
+        }
+        done.notify_one();
+    }
+}
@@ -0,0 +1,97 @@
+#ifndef GRAPHICS_THREADPOOL_H
+#define GRAPHICS_THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "memoryTracker.h"
+
+/**
+ * @brief Fixed set of worker threads for data-parallel loops.
+ * @details parallelFor() hands out chunks of an index range to the workers and the calling thread,
+ * and returns once every chunk is done. The loop body is passed by pointer rather than through
+ * std::function, so dispatching never allocates. Workers count their allocations against the
+ * MemoryTracker phase of the thread that called parallelFor().
+ */
+class ThreadPool {
+public:
+    /// @brief Construct a new ThreadPool
+    /// @param threads Total number of threads including the caller; 0 uses every hardware thread
+    explicit ThreadPool(unsigned int threads = 0);
+
+    /// @brief Stops and joins the workers
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    /// @brief Calls fn(begin, end) on chunks covering [0, count), in parallel
+    /// @param chunk Number of indices per chunk (at least 1)
+    template <typename F>
+    void parallelFor(size_t count, size_t chunk, F &&fn);
+
+    /// @brief Total number of threads that run chunks (workers plus the caller)
+    unsigned int getThreadCount() const;
+
+    /// @brief Runs the following loops on at most threads threads, the caller included
+    /// @details Clamped to [1, getThreadCount()]. Idle workers still wake up for every loop, but take no chunks.
+    void setThreadLimit(unsigned int threads);
+    unsigned int getThreadLimit() const;
+
+private:
+    using Body = void (*)(void *context, size_t begin, size_t end);
+
+    template <typename F>
+    static void invoke(void *context, size_t begin, size_t end) {
+        (*static_cast<F *>(context))(begin, end);
+    }
+
+    /// @brief Runs one loop on every thread and waits for it to finish
+    void run(size_t count, size_t chunk, Body body, void *context);
+
+    /// @brief Takes chunks of the current loop until none are left
+    void work();
+
+    /// @param index Workers with index + 1 >= limit sit out the loops
+    void workerLoop(unsigned int index);
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake, done;
+
+    /// @brief Incremented for every loop so that workers notice new work
+    unsigned long generation = 0;
+    /// @brief Number of workers still busy with the current loop
+    unsigned int busy = 0;
+    bool stopping = false;
+    /// @brief Threads that take chunks, see setThreadLimit()
+    unsigned int limit = 1;
+
+    // The loop currently running
+    Body body = nullptr;
+    void *context = nullptr;
+    MemoryTracker::Phase phase = MemoryTracker::Phase::OTHER;
+    size_t count = 0, chunk = 1;
+    std::atomic<size_t> next{0};
+};
+
+template <typename F>
+void ThreadPool::parallelFor(size_t count, size_t chunk, F &&fn) {
+    using Fn = typename std::remove_reference<F>::type;
+    if (count == 0) {
+        return;
+    }
+    chunk = chunk ? chunk : 1;
+    // Not worth waking the workers for a single chunk
+    if (workers.empty() || count <= chunk || limit <= 1) {
+        fn((size_t) 0, count);
+        return;
+    }
+    run(count, chunk, &invoke<Fn>, (void *) &fn);
+}
+
+#endif //GRAPHICS_THREADPOOL_H
@@ -1,18 +1,158 @@
 
 #include "framework/engine.h"
 
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 
 
 int main(int argc, char *argv[]) {
-    Engine engine;
+    // --software renders headless on the CPU, --frames N stops after N frames, --out DIR writes every frame there
+    // (--raw writes the OpenGL frames to a single raw RGBA stream instead of PPMs)
+    // --processes N splits the flock over N worker processes, --compact stores it quantized,
+    // --sort K reorders the boids in memory every K steps (0 never), --config FILE reads the rule constants,
+    // --zoom Z starts zoomed by Z, --lod-zoom Z draws a density heatmap instead of the boids below zoom Z,
+    // --stagger K recomputes the steering of each boid every K steps only, --skin PX sets the neighbor list skin,
+    // --commands FILE posts the commands in FILE (- for stdin) to the running simulation,
+    // --deterministic gives the same run on any number of cores, --seed N seeds the initial boids,
+    // --boids N starts with N boids, --colored-contacts resolves the collisions of the sequential update in parallel,
+    // --autotune picks the fastest grid cell size, block size and thread count (cached in autotune.cache),
+    // --headless simulates without drawing (until killed or --frames N), --stream sends every frame to viewers,
+    // --view shows a stream instead of simulating (both on STREAM_SOCKET_PATH, or --socket PATH)
+    RenderBackend backend = RenderBackend::OPENGL;
+    FrameCapture::Format captureFormat = FrameCapture::Format::IMAGE_SEQUENCE;
+    string outputDir;
+    unsigned long frames = 0;
+    int processes = 0;
+    bool compact = false;
+    int sortInterval = -1;
+    string configPath;
+    float zoom = 1;
+    float lodZoom = -1;
+    int steeringInterval = 1;
+    float skin = -1;
+    string commandsPath;
+    bool deterministic = false;
+    bool autotune = false;
+    bool coloredContacts = false;
+    unsigned int seed = 1;
+    size_t population = 0;
+    bool streaming = false, viewing = false;
+    string socketPath = STREAM_SOCKET_PATH;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--software") == 0) {
+            backend = RenderBackend::SOFTWARE;
+        } else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frames = std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            outputDir = argv[++i];
+        } else if (std::strcmp(argv[i], "--processes") == 0 && i + 1 < argc) {
+            processes = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--sort") == 0 && i + 1 < argc) {
+            sortInterval = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--config") == 0 && i + 1 < argc) {
+            configPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--zoom") == 0 && i + 1 < argc) {
+            zoom = std::strtof(argv[++i], nullptr);
+        } else if (std::strcmp(argv[i], "--lod-zoom") == 0 && i + 1 < argc) {
+            lodZoom = std::strtof(argv[++i], nullptr);
+        } else if (std::strcmp(argv[i], "--stagger") == 0 && i + 1 < argc) {
+            steeringInterval = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--skin") == 0 && i + 1 < argc) {
+            skin = std::strtof(argv[++i], nullptr);
+        } else if (std::strcmp(argv[i], "--commands") == 0 && i + 1 < argc) {
+            commandsPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--boids") == 0 && i + 1 < argc) {
+            population = std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = (unsigned int) std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--socket") == 0 && i + 1 < argc) {
+            socketPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--headless") == 0) {
+            backend = RenderBackend::NONE;
+        } else if (std::strcmp(argv[i], "--stream") == 0) {
+            streaming = true;
+        } else if (std::strcmp(argv[i], "--view") == 0) {
+            viewing = true;
+        } else if (std::strcmp(argv[i], "--deterministic") == 0) {
+            deterministic = true;
+        } else if (std::strcmp(argv[i], "--colored-contacts") == 0) {
+            coloredContacts = true;
+        } else if (std::strcmp(argv[i], "--autotune") == 0) {
+            autotune = true;
+        } else if (std::strcmp(argv[i], "--compact") == 0) {
+            compact = true;
+        } else if (std::strcmp(argv[i], "--raw") == 0) {
+            captureFormat = FrameCapture::Format::RAW_VIDEO;
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--software] [--frames N] [--out DIR] [--raw] [--processes N] [--compact] [--sort K] [--config FILE] [--zoom Z] [--lod-zoom Z] [--stagger K] [--skin PX] [--commands FILE] [--deterministic] [--seed N] [--boids N] [--autotune] [--colored-contacts] [--headless] [--stream] [--view] [--socket PATH]" << std::endl;
+            return 1;
+        }
+    }
+    // Headless runs have no window to close
+    if (backend == RenderBackend::SOFTWARE && frames == 0) {
+        frames = 600;
+    }
+
+    SimConfig config;
+    if (!configPath.empty() && !loadSimConfig(configPath, config)) {
+        return 1;
+    }
+
+    // Engine::initShapes() seeds the placement of the boids from rand()
+    std::srand(seed);
+
+    {
+        // Scoped so the engine releases its GL objects before glfwTerminate()
+        Engine engine(backend, outputDir, frames, captureFormat);
+        if (population > 0) {
+            engine.setPopulation(population);
+        }
+        if (sortInterval >= 0) {
+            engine.setSortInterval(sortInterval);
+        }
+        if (!configPath.empty()) {
+            engine.setConfig(config);
+        }
+        engine.setZoom(zoom);
+        engine.setDeterministic(deterministic);
+        engine.setSteeringInterval(steeringInterval);
+        if (skin >= 0) {
+            engine.setNeighborSkin(skin);
+        }
+        if (coloredContacts) {
+            engine.setCollisionMode(CollisionMode::COLORED);
+        }
+        if (autotune) {
+            engine.enableAutotune("autotune.cache");
+        }
+        if (lodZoom >= 0) {
+            engine.setLodZoom(lodZoom);
+        }
+        if (viewing) {
+            // The boids come from the stream: nothing here changes them
+            if (!engine.watchStream(socketPath)) {
+                return 1;
+            }
+        } else if (compact) {
+            engine.useCompactStorage();
+        } else if (processes > 0) {
+            engine.decompose(processes);
+        }
+        if (!commandsPath.empty()) {
+            engine.runCommandScript(commandsPath);
+        }
+        if (streaming && !engine.startStream(socketPath)) {
+            return 1;
+        }
 
-    while (!engine.shouldClose()) {
-        engine.processInput();
-        engine.update();
-        engine.render();
+        while (!engine.shouldClose()) {
+            engine.processInput();
+            engine.update();
+            engine.render();
+        }
     }
 
     glfwTerminate();
     return 0;
-}
\ No newline at end of file
+}
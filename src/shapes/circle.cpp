@@ -19,6 +19,10 @@ void Circle::draw() const {
     glBindVertexArray(0);
 }
 
+void Circle::drawInstanced(int count) const {
+    glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, segments + 2, count);
+}
+
 void Circle::initVectors() {
     // Center of circle
     vertices.push_back(0.0f);
@@ -47,6 +47,7 @@ public:
 
     /// @brief Draws the circle
     void draw() const override;
+    void drawInstanced(int count) const override;
 
     /// @brief Computes the border of the circle, and stores the vertices in the circleVertices array.
     void initVectors();
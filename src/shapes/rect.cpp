@@ -25,6 +25,10 @@ void Rect::draw() const {
     glBindVertexArray(0);
 }
 
+void Rect::drawInstanced(int count) const {
+    glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0, count);
+}
+
 void Rect::initVectors() {
     this->vertices.insert(vertices.end(), {
         -0.5f, 0.5f,   // Top left
@@ -33,6 +33,7 @@ public:
 
     /// @brief Binds the VAO and calls the virtual draw function
     void draw() const override;
+    void drawInstanced(int count) const override;
 
     float getLeft() const override;
     float getRight() const override;
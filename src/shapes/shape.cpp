@@ -84,6 +84,14 @@ vec2 Shape::getPos() const      { return pos; }
 float Shape::getPosX() const    { return pos.x; }
 float Shape::getPosY() const    { return pos.y; }
 vec2 Shape::getSize() const     { return size; }
+
+size_t Shape::getVertexMemory() const {
+    return vertices.capacity() * sizeof(float) + indices.capacity() * sizeof(unsigned int);
+}
+size_t Shape::getBufferMemory() const {
+    return vertices.size() * sizeof(float) + indices.size() * sizeof(unsigned int);
+}
+unsigned int Shape::getVAO() const { return VAO; }
 vec2 Shape::getVelocity() const { return velocity; }
 void Shape::setVelocity(vec2 v) { this->velocity = v;}
 
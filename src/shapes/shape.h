@@ -65,6 +65,15 @@ class Shape {
         // Size Functions
         vec2 getSize() const;
 
+        // Memory Functions
+        /// @brief Bytes used by the vertices and indices vectors on the CPU
+        size_t getVertexMemory() const;
+        /// @brief Bytes uploaded to the VBO and EBO on the GPU
+        size_t getBufferMemory() const;
+
+        /// @brief The Vertex Array Object holding the mesh
+        unsigned int getVAO() const;
+
         // Velocity Functions
         vec2 getVelocity() const;
         void setVelocity(vec2 velocity);
@@ -115,6 +124,10 @@ class Shape {
         /// @brief Pure virtual function to draw the shape.
         virtual void draw() const = 0;
 
+        /// @brief Draws count copies of the mesh in one call
+        /// @details Expects the VAO to be bound with per-instance attributes set up (see RenderQueue).
+        virtual void drawInstanced(int count) const = 0;
+
 protected:
         /// @brief Shader used to draw all abstract shapes.
         /// @note TODO This will need to be a pointer for custom shaders.
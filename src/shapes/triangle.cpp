@@ -21,6 +21,10 @@ void Triangle::draw() const {
     glBindVertexArray(0);
 }
 
+void Triangle::drawInstanced(int count) const {
+    glDrawElementsInstanced(GL_TRIANGLES, 3, GL_UNSIGNED_INT, 0, count);
+}
+
 void Triangle::initVectors() {
     this->vertices.insert(this->vertices.end(), {
             -0.5f, -0.5f,  // Bottom left
@@ -31,4 +35,9 @@ void Triangle::initVectors() {
     this->indices.insert(this->indices.end(), {
             0, 1, 2,
     });
-}
\ No newline at end of file
+}
+// Overridden Getters from Shape
+float Triangle::getLeft() const    { return pos.x - (size.x / 2); }
+float Triangle::getRight() const   { return pos.x + (size.x / 2); }
+float Triangle::getTop() const     { return pos.y + (size.y / 2); }
+float Triangle::getBottom() const  { return pos.y - (size.y / 2); }
@@ -21,9 +21,15 @@ public:
 
     /// @brief Binds the VAO and calls the virtual draw function
     void draw() const override;
+    void drawInstanced(int count) const override;
 
     /// @brief Populates the vertices and indices vectors
     void initVectors();
+
+    float getLeft() const override;
+    float getRight() const override;
+    float getTop() const override;
+    float getBottom() const override;
 };
 
 #endif //GRAPHICS_TRIANGLE_H
@@ -0,0 +1,35 @@
+#include "boid.h"
+#include <cmath>
+
+bool Boid::isOverlapping(const Boid &other) const {
+    // Compare squared distances so no sqrt is needed
+    vec2 delta = other.pos - pos;
+    float radiusSum = radius + other.radius;
+    return glm::dot(delta, delta) < radiusSum * radiusSum;
+}
+
+void Boid::bounce(Boid &other) {
+    vec2 delta = other.pos - pos;
+    float distance = glm::length(delta);
+    float overlap = (radius + other.radius - distance);
+
+    // Check if boids are overlapping (and not exactly on top of each other)
+    if (overlap > 0 && distance > 0) {
+        // Adjust positions based on radius (as a proxy for mass)
+        float thisMass = radius * radius * M_PI;
+        float otherMass = other.radius * other.radius * M_PI;
+        float totalMass = thisMass + otherMass;
+
+        pos = pos - overlap * (thisMass / totalMass) * delta / distance;
+        other.pos = other.pos + overlap * (otherMass / totalMass) * delta / distance;
+
+        // Velocity calculations for elastic collision
+        vec2 velocityDifference = velocity - other.velocity;
+
+        float dotProduct = glm::dot(velocityDifference, delta) / (distance * distance);
+        vec2 collisionNormal = dotProduct * delta;
+
+        velocity = velocity - (2 * otherMass / totalMass) * collisionNormal;
+        other.velocity = other.velocity + (2 * thisMass / totalMass) * collisionNormal;
+    }
+}
@@ -0,0 +1,46 @@
+#ifndef GRAPHICS_BOID_H
+#define GRAPHICS_BOID_H
+
+#include <cstdint>
+#include "glm/glm.hpp"
+
+using glm::vec2;
+
+/// @brief Maximum number of teams (colors) a flock can contain.
+const int MAX_TEAMS = 4;
+
+/// @brief Simulation state of a single boid.
+/// @details Boids are plain data so that they can be stored contiguously in a BoidPool.
+/// @details They are drawn with a single shared Circle in Engine::render().
+struct Boid {
+    /// @brief The position of the boid
+    vec2 pos;
+    /// @brief The x and y velocities of the boid
+    vec2 velocity;
+    /// @brief Radius of the boid (also used as its mass in bounce())
+    float radius = 0;
+    /// @brief Index of the team (color) the boid belongs to
+    int team = 0;
+    /// @brief Leaders chase other teams and convert the boids they hit
+    bool leader = false;
+
+    /// @brief Checks if two boids are overlapping
+    bool isOverlapping(const Boid &other) const;
+
+    /// @brief Handles the collision between two boids
+    /// @details Same elastic collision as Circle::bounce(), but on plain data.
+    void bounce(Boid &other);
+};
+
+/// @brief Stable reference to a boid stored in a BoidPool.
+/// @details Stays valid while the boid moves around inside the pool, and is invalidated when the boid is despawned.
+struct BoidHandle {
+    static const uint32_t INVALID = UINT32_MAX;
+
+    uint32_t id = INVALID;
+    uint32_t generation = 0;
+
+    bool valid() const { return id != INVALID; }
+};
+
+#endif //GRAPHICS_BOID_H
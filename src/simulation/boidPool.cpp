@@ -0,0 +1,104 @@
+#include "boidPool.h"
+
+BoidPool::BoidPool(size_t capacity)
+    : boids(capacity), slotToId(capacity), idToSlot(capacity), generations(capacity, 0) {
+    freeIds.reserve(capacity);
+    clear();
+}
+
+BoidHandle BoidPool::spawn(const Boid &boid) {
+    if (full()) {
+        return {};
+    }
+
+    uint32_t id = freeIds.back();
+    freeIds.pop_back();
+
+    boids[count] = boid;
+    slotToId[count] = id;
+    idToSlot[id] = count;
+    ++count;
+
+    return {id, generations[id]};
+}
+
+bool BoidPool::despawn(BoidHandle handle) {
+    if (!get(handle)) {
+        return false;
+    }
+    despawnAt(idToSlot[handle.id]);
+    return true;
+}
+
+void BoidPool::despawnAt(size_t index) {
+    uint32_t id = slotToId[index];
+    size_t last = count - 1;
+
+    // Move the last live boid into the hole to keep the array packed
+    if (index != last) {
+        boids[index] = boids[last];
+        slotToId[index] = slotToId[last];
+        idToSlot[slotToId[index]] = index;
+    }
+    --count;
+
+    ++generations[id];
+    freeIds.push_back(id);
+}
+
+void BoidPool::clear() {
+    // Bump the generation of every live id so that old handles go stale
+    for (size_t i = 0; i < count; ++i) {
+        ++generations[slotToId[i]];
+    }
+    count = 0;
+
+    // Push ids in reverse so they are handed out in increasing order
+    freeIds.clear();
+    for (size_t id = boids.size(); id > 0; --id) {
+        freeIds.push_back(id - 1);
+    }
+}
+
+Boid *BoidPool::get(BoidHandle handle) {
+    if (!handle.valid() || handle.id >= generations.size() || generations[handle.id] != handle.generation) {
+        return nullptr;
+    }
+    return &boids[idToSlot[handle.id]];
+}
+
+BoidHandle BoidPool::handleAt(size_t index) const {
+    uint32_t id = slotToId[index];
+    return {id, generations[id]};
+}
+
+void BoidPool::reorder(const uint32_t *order) {
+    reorderBoids.resize(boids.size());
+    reorderIds.resize(slotToId.size());
+    for (size_t i = 0; i < count; ++i) {
+        reorderBoids[i] = boids[order[i]];
+        reorderIds[i] = slotToId[order[i]];
+        idToSlot[reorderIds[i]] = i;
+    }
+    // The dead slots past count only hold stale data, so they need not be copied
+    boids.swap(reorderBoids);
+    slotToId.swap(reorderIds);
+}
+
+size_t BoidPool::size() const     { return count; }
+size_t BoidPool::capacity() const { return boids.size(); }
+bool BoidPool::full() const       { return count == boids.size(); }
+
+size_t BoidPool::memoryUsage() const {
+    return (boids.capacity() + reorderBoids.capacity()) * sizeof(Boid) +
+           (slotToId.capacity() + idToSlot.capacity() + generations.capacity() + freeIds.capacity() +
+            reorderIds.capacity()) * sizeof(uint32_t);
+}
+
+Boid &BoidPool::operator[](size_t index)             { return boids[index]; }
+const Boid &BoidPool::operator[](size_t index) const { return boids[index]; }
+
+Boid *BoidPool::begin()             { return boids.data(); }
+Boid *BoidPool::end()               { return boids.data() + count; }
+const Boid *BoidPool::begin() const { return boids.data(); }
+const Boid *BoidPool::end() const   { return boids.data() + count; }
@@ -0,0 +1,90 @@
+#ifndef GRAPHICS_BOIDPOOL_H
+#define GRAPHICS_BOIDPOOL_H
+
+#include <vector>
+#include <cstddef>
+#include "boid.h"
+
+using std::vector;
+
+/// @brief Fixed-capacity slab of boids with a free list and stable handles.
+/// @details Live boids are kept packed at the front of one array so the simulation can loop over them directly.
+/// @details A handle's id indexes a sparse table that maps to the boid's current slot, so handles stay valid
+/// when despawn() moves the last boid into the freed slot.
+/// @details All memory is allocated in the constructor: spawn() and despawn() never allocate.
+class BoidPool {
+public:
+    /// @brief Construct a new BoidPool
+    /// @param capacity The maximum number of boids that can be alive at once
+    explicit BoidPool(size_t capacity);
+
+    /// @brief Adds a boid to the pool
+    /// @return A handle to the new boid, or an invalid handle if the pool is full
+    BoidHandle spawn(const Boid &boid);
+
+    /// @brief Removes the boid referenced by handle
+    /// @return false if the handle was stale or invalid
+    bool despawn(BoidHandle handle);
+
+    /// @brief Removes the boid stored at the given slot
+    /// @details The last live boid is moved into the slot, so loop backwards when despawning while iterating.
+    void despawnAt(size_t index);
+
+    /// @brief Removes every boid and invalidates all outstanding handles
+    void clear();
+
+    /// @brief Returns the boid referenced by handle, or nullptr if it was despawned
+    Boid *get(BoidHandle handle);
+
+    /// @brief Returns the handle of the boid stored at the given slot
+    BoidHandle handleAt(size_t index) const;
+
+    /// @brief Moves the boid in slot order[i] to slot i, for every live slot i
+    /// @details Handles stay valid; pointers and slot indices do not. order must be a permutation of [0, size()).
+    /// @details The first call allocates a second copy of the boid array to gather into.
+    void reorder(const uint32_t *order);
+
+    // --------------------------------------------------------
+    // Getters
+    // --------------------------------------------------------
+    size_t size() const;
+    size_t capacity() const;
+    bool full() const;
+
+    /// @brief Bytes reserved by the pool (all of it is allocated up front)
+    size_t memoryUsage() const;
+
+    Boid &operator[](size_t index);
+    const Boid &operator[](size_t index) const;
+
+    // Iteration over the live boids only
+    Boid *begin();
+    Boid *end();
+    const Boid *begin() const;
+    const Boid *end() const;
+
+private:
+    /// @brief Boid storage, sized to capacity; only the first count entries are alive
+    vector<Boid> boids;
+
+    /// @brief Handle id of the boid in each slot
+    vector<uint32_t> slotToId;
+
+    /// @brief Slot of the boid with each handle id
+    vector<uint32_t> idToSlot;
+
+    /// @brief Generation of each handle id, bumped every time the id is freed
+    vector<uint32_t> generations;
+
+    /// @brief Stack of unused handle ids
+    vector<uint32_t> freeIds;
+
+    /// @brief Gather buffers for reorder(), swapped with boids and slotToId
+    vector<Boid> reorderBoids;
+    vector<uint32_t> reorderIds;
+
+    /// @brief Number of live boids
+    size_t count = 0;
+};
+
+#endif //GRAPHICS_BOIDPOOL_H
@@ -0,0 +1,317 @@
+#include "compactFlock.h"
+#include "../framework/memoryTracker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+CompactFlock::CompactFlock(Flock &rules) : rules(rules) {
+    origin = vec2(-MARGIN_CELLS * CELL_SIZE, -MARGIN_CELLS * CELL_SIZE);
+    columns = (int) std::ceil(rules.getWidth() / CELL_SIZE) + 2 * MARGIN_CELLS;
+    rows = (int) std::ceil(rules.getHeight() / CELL_SIZE) + 2 * MARGIN_CELLS;
+    blockColumns = (columns + BLOCK_CELLS - 1) / BLOCK_CELLS;
+    blockRows = (rows + BLOCK_CELLS - 1) / BLOCK_CELLS;
+    cellStart.assign(columns * rows + 1, 0);
+    cellCount.assign(columns * rows + 1, 0);
+}
+
+int CompactFlock::cellOf(vec2 pos) const {
+    int cx = std::clamp((int) std::floor((pos.x - origin.x) / CELL_SIZE), 0, columns - 1);
+    int cy = std::clamp((int) std::floor((pos.y - origin.y) / CELL_SIZE), 0, rows - 1);
+    return cy * columns + cx;
+}
+
+vec2 CompactFlock::cellOrigin(int cell) const {
+    return origin + vec2(cell % columns, cell / columns) * CELL_SIZE;
+}
+
+Boid CompactFlock::decode(size_t index, vec2 corner) const {
+    Boid boid;
+    boid.pos = corner + vec2(x[index], y[index]) * POSITION_SCALE;
+    boid.velocity = vec2(vx[index], vy[index]) * VELOCITY_SCALE;
+    boid.team = tag[index] & TEAM_MASK;
+    boid.leader = tag[index] & LEADER_BIT;
+    boid.radius = boid.leader ? Flock::LEADER_RADIUS : Flock::RADIUS;
+    return boid;
+}
+
+/// @brief Rounds value / scale to the nearest 16-bit integer, saturating
+static int16_t quantize(float value, float scale) {
+    return (int16_t) std::clamp(std::lround(value / scale), -32768L, 32767L);
+}
+
+void CompactFlock::encode(size_t index, vec2 corner, const Boid &boid) {
+    x[index] = quantize(boid.pos.x - corner.x, POSITION_SCALE);
+    y[index] = quantize(boid.pos.y - corner.y, POSITION_SCALE);
+    vx[index] = quantize(boid.velocity.x, VELOCITY_SCALE);
+    vy[index] = quantize(boid.velocity.y, VELOCITY_SCALE);
+    tag[index] = (uint8_t) ((boid.team & TEAM_MASK) | (boid.leader ? LEADER_BIT : 0));
+}
+
+void CompactFlock::load(const BoidPool &boids) {
+    x.clear();
+    y.clear();
+    vx.clear();
+    vy.clear();
+    tag.clear();
+    std::fill(cellStart.begin(), cellStart.end(), 0);
+    pending.assign(boids.begin(), boids.end());
+    commit();
+}
+
+void CompactFlock::spawn(const Boid &boid) {
+    pending.push_back(boid);
+}
+
+void CompactFlock::commit() {
+    if (pending.empty()) {
+        return;
+    }
+    // Every stored boid stays in its bucket; the new ones are inserted like boids changing cells
+    for (int cell = 0; cell < columns * rows; ++cell) {
+        cellCount[cell] = cellStart[cell + 1] - cellStart[cell];
+    }
+    movers.clear();
+    for (const Boid &boid : pending) {
+        movers.push_back({cellOf(boid.pos), boid});
+    }
+    vector<Boid>().swap(pending);
+
+    size_t size = x.size() + movers.size();
+    x.resize(size);
+    y.resize(size);
+    vx.resize(size);
+    vy.resize(size);
+    tag.resize(size);
+    rebin();
+
+    // Only a small share of the boids changes cells in a step: keep enough room for that, not for the spawn
+    vector<Mover>().swap(movers);
+    movers.reserve(size / 16 + 64);
+}
+
+void CompactFlock::sumBlocks() {
+    blockSums.assign(blockColumns * blockRows, TeamSums());
+    for (int cell = 0; cell < columns * rows; ++cell) {
+        vec2 corner = cellOrigin(cell);
+        TeamSums &sums = blockSums[(cell / columns / BLOCK_CELLS) * blockColumns + (cell % columns) / BLOCK_CELLS];
+        for (uint32_t i = cellStart[cell]; i < cellStart[cell + 1]; ++i) {
+            sums.add(tag[i] & TEAM_MASK, corner + vec2(x[i], y[i]) * POSITION_SCALE);
+        }
+    }
+}
+
+void CompactFlock::update(float deltaTime) {
+    // Same radii as Flock::avoid(), Flock::matchVelocity() and Flock::center()
+    const SimConfig &config = rules.getConfig();
+    const float avoidDist = config.minDistance * 4, matchDist = config.matchDistance;
+    const float minDist = config.minDistance, dist = config.cohesionDistance;
+    const float scanDist = std::max(avoidDist, matchDist);
+    const float collideDist = 2 * Flock::LEADER_RADIUS;
+
+    rules.setTimeStep(deltaTime);
+    contacts = 0;
+    sumBlocks();
+
+    // Range of cells covering the square of radius r around pos
+    auto cellRange = [this](vec2 pos, float r, int &x0, int &y0, int &x1, int &y1) {
+        int low = cellOf(pos - vec2(r, r)), high = cellOf(pos + vec2(r, r));
+        x0 = low % columns;
+        y0 = low / columns;
+        x1 = high % columns;
+        y1 = high / columns;
+    };
+
+    const int16_t *xs = x.data(), *ys = y.data();
+    for (int cell = 0; cell < columns * rows; ++cell) {
+        const vec2 corner = cellOrigin(cell);
+        for (uint32_t i = cellStart[cell]; i < cellStart[cell + 1]; ++i) {
+            Boid boid1 = decode(i, corner);
+            const vec2 start = boid1.pos;
+            int x0, y0, x1, y1;
+
+            boid1.pos += boid1.velocity * deltaTime;
+
+            // Separation and alignment in one pass over the nearby cells
+            vec2 velocitySum(0, 0);
+            int numBoidsNear = 0;
+            cellRange(boid1.pos, scanDist, x0, y0, x1, y1);
+            for (int cy = y0; cy <= y1; ++cy) {
+                for (int cx = x0; cx <= x1; ++cx) {
+                    int near = cy * columns + cx;
+                    vec2 nearCorner = cellOrigin(near);
+                    // Offset from boid1 to the cell corner, so a neighbor is one multiply-add away
+                    vec2 offset = nearCorner - boid1.pos;
+                    for (uint32_t j = cellStart[near]; j < cellStart[near + 1]; ++j) {
+                        // Dequantize the position alone first: most boids in the square are out of range
+                        float dx = offset.x + xs[j] * POSITION_SCALE, dy = offset.y + ys[j] * POSITION_SCALE;
+                        float d2 = dx * dx + dy * dy;
+                        if (j == i || d2 >= scanDist * scanDist) {
+                            continue;
+                        }
+                        Boid boid2 = decode(j, nearCorner);
+                        if (d2 < avoidDist * avoidDist) {
+                            rules.avoid(boid1, boid2);
+                        }
+                        if (d2 < matchDist * matchDist) {
+                            velocitySum += boid2.velocity;
+                            ++numBoidsNear;
+                        }
+                    }
+                }
+            }
+
+            // Cohesion with the team centroids of the blocks in range (not counting boid1 itself)
+            TeamSums near;
+            const int ownBlock = (cell / columns / BLOCK_CELLS) * blockColumns + (cell % columns) / BLOCK_CELLS;
+            cellRange(boid1.pos, dist, x0, y0, x1, y1);
+            for (int by = y0 / BLOCK_CELLS; by <= y1 / BLOCK_CELLS; ++by) {
+                for (int bx = x0 / BLOCK_CELLS; bx <= x1 / BLOCK_CELLS; ++bx) {
+                    int block = by * blockColumns + bx;
+                    const TeamSums &sums = blockSums[block];
+                    for (int team = 0; team < MAX_TEAMS; ++team) {
+                        int count = sums.count[team];
+                        vec2 sum = sums.sum[team];
+                        if (block == ownBlock && team == boid1.team) {
+                            --count;
+                            sum -= start;
+                        }
+                        if (count > 0) {
+                            vec2 delta = sum / (float) count - boid1.pos;
+                            float d2 = glm::dot(delta, delta);
+                            if (d2 < dist * dist && d2 > minDist * minDist) {
+                                near.count[team] += count;
+                                near.sum[team] += sum;
+                            }
+                        }
+                    }
+                }
+            }
+            rules.center(boid1, near);
+
+            // boid1 counts towards its own average velocity, like in Flock::matchVelocity()
+            rules.matchVelocity(boid1, (velocitySum + boid1.velocity) / (float) (numBoidsNear + 1));
+
+            // Collisions write the other boid back in place
+            cellRange(boid1.pos, collideDist, x0, y0, x1, y1);
+            for (int cy = y0; cy <= y1; ++cy) {
+                for (int cx = x0; cx <= x1; ++cx) {
+                    int near = cy * columns + cx;
+                    vec2 nearCorner = cellOrigin(near);
+                    for (uint32_t j = cellStart[near]; j < cellStart[near + 1]; ++j) {
+                        vec2 delta = nearCorner + vec2(x[j], y[j]) * POSITION_SCALE - boid1.pos;
+                        if (j == i || glm::dot(delta, delta) >= collideDist * collideDist) {
+                            continue;
+                        }
+                        Boid other = decode(j, nearCorner);
+                        if (boid1.isOverlapping(other)) {
+                            boid1.bounce(other);
+                            ++contacts;
+                            if (boid1.leader && !other.leader && boid1.team != other.team) {
+                                other.team = boid1.team;
+                            }
+                            encode(j, nearCorner, other);
+                        }
+                    }
+                }
+            }
+
+            rules.finishStep(boid1);
+
+            // Still relative to this cell: offsets reach one cell past it until rebin()
+            encode(i, corner, boid1);
+        }
+    }
+
+    // Find the boids that left their cell, and compact the buckets over them
+    movers.clear();
+    for (int cell = 0; cell < columns * rows; ++cell) {
+        const vec2 corner = cellOrigin(cell);
+        uint32_t kept = cellStart[cell];
+        for (uint32_t i = cellStart[cell]; i < cellStart[cell + 1]; ++i) {
+            vec2 pos = corner + vec2(x[i], y[i]) * POSITION_SCALE;
+            int target = cellOf(pos);
+            if (target != cell) {
+                MemoryTracker::expectGrowth(movers, movers.size() + 1);
+                movers.push_back({target, decode(i, corner)});
+                continue;
+            }
+            if (kept != i) {
+                x[kept] = x[i];
+                y[kept] = y[i];
+                vx[kept] = vx[i];
+                vy[kept] = vy[i];
+                tag[kept] = tag[i];
+            }
+            ++kept;
+        }
+        cellCount[cell] = kept - cellStart[cell];
+    }
+    if (!movers.empty()) {
+        rebin();
+    }
+
+    std::fill(teamCounts, teamCounts + MAX_TEAMS, 0);
+    for (uint8_t value : tag) {
+        ++teamCounts[value & TEAM_MASK];
+    }
+}
+
+void CompactFlock::rebin() {
+    // On entry bucket c holds cellCount[c] boids from cellStart[c], and every mover still has to be placed.
+    // New bucket starts: the boids kept plus the movers arriving, per cell
+    const int cells = columns * rows;
+    vector<uint32_t> &kept = cellCount;
+
+    // cellStart[c] becomes the new start; the old one is only needed to move the kept boids
+    auto moveBucket = [this, &kept](int cell, uint32_t from, uint32_t to) {
+        uint32_t n = kept[cell];
+        std::memmove(&x[to], &x[from], n * sizeof(int16_t));
+        std::memmove(&y[to], &y[from], n * sizeof(int16_t));
+        std::memmove(&vx[to], &vx[from], n * sizeof(int16_t));
+        std::memmove(&vy[to], &vy[from], n * sizeof(int16_t));
+        std::memmove(&tag[to], &tag[from], n);
+    };
+
+    // Arrivals per cell, counted in the new starts array
+    movedStart.assign(cells + 1, 0);
+    for (const Mover &mover : movers) {
+        ++movedStart[mover.cell + 1];
+    }
+    for (int cell = 0; cell < cells; ++cell) {
+        movedStart[cell + 1] += movedStart[cell] + kept[cell];
+    }
+
+    // Buckets only shift, keeping their order, so moving the ones that go right from the right end and the
+    // ones that go left from the left end never overwrites a bucket that has not moved yet
+    for (int cell = cells - 1; cell >= 0; --cell) {
+        if (movedStart[cell] > cellStart[cell] && kept[cell]) {
+            moveBucket(cell, cellStart[cell], movedStart[cell]);
+        }
+    }
+    for (int cell = 0; cell < cells; ++cell) {
+        if (movedStart[cell] < cellStart[cell] && kept[cell]) {
+            moveBucket(cell, cellStart[cell], movedStart[cell]);
+        }
+    }
+    cellStart.swap(movedStart);
+
+    // Movers go after the boids kept in their new bucket
+    for (const Mover &mover : movers) {
+        uint32_t index = cellStart[mover.cell] + kept[mover.cell]++;
+        encode(index, cellOrigin(mover.cell), mover.boid);
+    }
+}
+
+CompactFlock::MemoryUsage CompactFlock::memoryUsage() const {
+    MemoryUsage usage;
+    usage.boids = (x.capacity() + y.capacity() + vx.capacity() + vy.capacity()) * sizeof(int16_t) + tag.capacity();
+    usage.cells = (cellStart.capacity() + cellCount.capacity() + movedStart.capacity()) * sizeof(uint32_t) +
+                  blockSums.capacity() * sizeof(TeamSums);
+    usage.movers = movers.capacity() * sizeof(Mover) + pending.capacity() * sizeof(Boid);
+    return usage;
+}
+
+size_t CompactFlock::size() const               { return x.size(); }
+int CompactFlock::getContactCount() const       { return contacts; }
+int CompactFlock::getTeamCount(int team) const  { return teamCounts[team]; }
@@ -0,0 +1,134 @@
+#ifndef GRAPHICS_COMPACTFLOCK_H
+#define GRAPHICS_COMPACTFLOCK_H
+
+#include <cstdint>
+#include <vector>
+#include "flock.h"
+
+using std::vector;
+
+/**
+ * @brief Quantized storage for very large flocks, updated with the rules of a Flock.
+ * @details Each boid takes 9 bytes instead of the 40 of a Boid in a BoidPool (28 plus 12 of handle bookkeeping):
+ * - position: two 16-bit fixed-point offsets from the corner of the grid cell the boid is stored in
+ * - velocity: two 16-bit fixed-point values
+ * - tag: team in the low bits, plus a leader bit (the radius follows from it)
+ * @details Fields live in separate arrays, sorted by cell. The update never expands the flock into Boids:
+ * the neighbor loops dequantize positions cell by cell as they read them.
+ * @details Boids are updated in place in cell order, like UpdateMode::SEQUENTIAL updates them in storage order.
+ * Cohesion uses the team centroids of small blocks of cells, like the quadtree with a single level. Boids that left their cell
+ * are moved to their new cell after each step without a second copy of the arrays.
+ */
+class CompactFlock {
+public:
+    /// @brief Side of a grid cell in pixels
+    static constexpr float CELL_SIZE = 32;
+    /// @brief Pixels per unit of a quantized position: offsets cover [-CELL_SIZE, CELL_SIZE)
+    static constexpr float POSITION_SCALE = CELL_SIZE / 32768;
+    /// @brief Pixels per second per unit of a quantized velocity: covers about +-512
+    static constexpr float VELOCITY_SCALE = 1.0f / 64;
+    /// @brief Cells added around the world so boids slightly off screen keep full precision
+    static const int MARGIN_CELLS = 4;
+    /// @brief Cohesion uses the team centroids of blocks of BLOCK_CELLS x BLOCK_CELLS cells
+    static const int BLOCK_CELLS = 2;
+
+    /// @brief Construct a new CompactFlock over the world of rules
+    /// @param rules Supplies the flocking rules, bounds, obstacles and flow field
+    explicit CompactFlock(Flock &rules);
+
+    /// @brief Replaces the boids with a quantized copy of boids
+    void load(const BoidPool &boids);
+
+    /// @brief Adds a boid; call commit() after the last one, before update() or forEach()
+    void spawn(const Boid &boid);
+    /// @brief Sorts the boids added with spawn() into their cells
+    void commit();
+
+    /// @brief Advances the simulation by deltaTime seconds
+    void update(float deltaTime);
+
+    /// @brief Calls fn(const Boid &) with a dequantized copy of every boid
+    template <typename F>
+    void forEach(F fn) const;
+
+    /// @brief Bytes used by the compact state
+    struct MemoryUsage {
+        /// @brief Per boid arrays (9 bytes per boid of capacity)
+        size_t boids = 0;
+        /// @brief Per cell arrays: bucket offsets and team centroids
+        size_t cells = 0;
+        /// @brief Boids changing cells in the last step
+        size_t movers = 0;
+    };
+    MemoryUsage memoryUsage() const;
+
+    // -----------------------------------
+    // Getters
+    // -----------------------------------
+    size_t size() const;
+    /// @brief Number of collisions resolved in the last update()
+    int getContactCount() const;
+    /// @brief Number of boids in a team at the end of the last update()
+    int getTeamCount(int team) const;
+
+private:
+    static const uint8_t TEAM_MASK = 0x3, LEADER_BIT = 0x4;
+    static_assert(MAX_TEAMS <= TEAM_MASK + 1, "the tag has two bits for the team");
+
+    /// @brief Cell a position falls in, clamped to the grid
+    int cellOf(vec2 pos) const;
+    /// @brief World position of the corner of a cell
+    vec2 cellOrigin(int cell) const;
+
+    /// @brief Dequantizes the boid stored at index in cell
+    Boid decode(size_t index, vec2 origin) const;
+    /// @brief Quantizes boid into index, relative to the corner origin of its bucket
+    void encode(size_t index, vec2 origin, const Boid &boid);
+
+    /// @brief Sums the team positions of every block of cells
+    void sumBlocks();
+    /// @brief Inserts movers into their new buckets
+    /// @details Expects cellCount to hold the number of boids kept at the start of each bucket.
+    void rebin();
+
+    Flock &rules;
+    vec2 origin;
+    int columns, rows;
+    /// @brief Number of cohesion blocks along each axis
+    int blockColumns, blockRows;
+
+    // One entry per boid, sorted by cell
+    vector<int16_t> x, y, vx, vy;
+    vector<uint8_t> tag;
+
+    /// @brief Boids of cell c are at cellStart[c] to cellStart[c + 1] - 1
+    vector<uint32_t> cellStart;
+    /// @brief Scratch per cell for rebin() and commit(): boids kept in each bucket, then the new bucket starts
+    vector<uint32_t> cellCount, movedStart;
+    /// @brief Team sums of each block at the start of the step
+    vector<TeamSums> blockSums;
+
+    /// @brief A boid changing cells, with the cell it goes to
+    struct Mover {
+        int cell;
+        Boid boid;
+    };
+    vector<Mover> movers;
+    /// @brief Boids added by spawn() since the last commit()
+    vector<Boid> pending;
+
+    int contacts = 0;
+    int teamCounts[MAX_TEAMS] = {};
+};
+
+template <typename F>
+void CompactFlock::forEach(F fn) const {
+    for (int cell = 0; cell < columns * rows; ++cell) {
+        vec2 corner = cellOrigin(cell);
+        for (uint32_t i = cellStart[cell]; i < cellStart[cell + 1]; ++i) {
+            fn(decode(i, corner));
+        }
+    }
+}
+
+#endif //GRAPHICS_COMPACTFLOCK_H
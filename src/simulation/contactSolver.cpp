@@ -0,0 +1,155 @@
+#include "contactSolver.h"
+
+#include <algorithm>
+#include "../framework/memoryTracker.h"
+
+/// @brief Bounces the pair if it overlaps; a leader converts the regular boid of another team it hits
+/// @return 1 if the pair bounced
+static int bouncePair(Boid &a, Boid &b) {
+    if (!a.isOverlapping(b)) {
+        return 0;
+    }
+    a.bounce(b);
+    if (a.leader && !b.leader && a.team != b.team) {
+        b.team = a.team;
+    } else if (b.leader && !a.leader && a.team != b.team) {
+        a.team = b.team;
+    }
+    return 1;
+}
+
+/// @brief Index of the lowest set bit of a non zero value
+static int lowestBit(uint64_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(value);
+#else
+    int bit = 0;
+    while (!(value & 1)) {
+        value >>= 1;
+        ++bit;
+    }
+    return bit;
+#endif
+}
+
+int ContactSolver::resolve(Boid *boids, size_t count, const SpatialGrid &grid, float reach, ThreadPool *threads) {
+    stats = Stats();
+    const size_t blocks = (count + BLOCK - 1) / BLOCK;
+    if (found.size() < blocks) {
+        found.resize(blocks);
+    }
+
+    // Each block only writes its own list
+    auto search = [&](size_t begin, size_t end) {
+        for (size_t block = begin; block < end; ++block) {
+            vector<Pair> &pairs = found[block];
+            pairs.clear();
+            pairs.reserve(BLOCK * PAIRS_PER_BOID);
+            for (size_t i = block * BLOCK; i < std::min(count, (block + 1) * BLOCK); ++i) {
+                grid.forEachNear(boids[i].pos, reach, [&](int slot) {
+                    if ((size_t) slot > i && boids[i].isOverlapping(boids[slot])) {
+                        MemoryTracker::expectGrowth(pairs, pairs.size() + 1);
+                        pairs.push_back({(int) i, slot, 0});
+                    }
+                });
+            }
+        }
+    };
+    if (threads) {
+        threads->parallelFor(blocks, 1, search);
+    } else {
+        search(0, blocks);
+    }
+
+    // Greedy coloring: each pair takes the lowest color neither of its boids has yet
+    const uint64_t ALL = ~0ull >> (64 - (MAX_COLORS - 1));
+    if (used.size() < count) {
+        used.resize(count, 0);
+    }
+    colorStart.assign(MAX_COLORS + 1, 0);
+    for (size_t block = 0; block < blocks; ++block) {
+        for (Pair &pair : found[block]) {
+            uint64_t taken = used[pair.a] | used[pair.b];
+            pair.color = (taken & ALL) == ALL ? MAX_COLORS - 1 : lowestBit(~taken);
+            if (pair.color < MAX_COLORS - 1) {
+                used[pair.a] |= 1ull << pair.color;
+                used[pair.b] |= 1ull << pair.color;
+            }
+            ++colorStart[pair.color + 1];
+            ++stats.pairs;
+        }
+    }
+    for (int color = 0; color < MAX_COLORS; ++color) {
+        if (colorStart[color + 1] > 0) {
+            stats.colors = color + 1;
+        }
+        colorStart[color + 1] += colorStart[color];
+    }
+
+    // Bucket the pairs by color, keeping the order they were found in, and clear the colors of their boids
+    MemoryTracker::expectGrowth(sorted, stats.pairs);
+    sorted.resize(stats.pairs);
+    vector<size_t> &next = colorStart;
+    for (size_t block = 0; block < blocks; ++block) {
+        for (const Pair &pair : found[block]) {
+            sorted[next[pair.color]++] = pair;
+            used[pair.a] = used[pair.b] = 0;
+        }
+    }
+    // next[c] ended where color c + 1 starts: shift back
+    for (int color = MAX_COLORS; color > 0; --color) {
+        colorStart[color] = colorStart[color - 1];
+    }
+    colorStart[0] = 0;
+
+    int total = 0;
+    for (int color = 0; color < stats.colors; ++color) {
+        const size_t first = colorStart[color], pairs = colorStart[color + 1] - first;
+        if (color == MAX_COLORS - 1) {
+            // Boids in too many contacts: one after another
+            for (size_t i = first; i < first + pairs; ++i) {
+                total += bouncePair(boids[sorted[i].a], boids[sorted[i].b]);
+            }
+            continue;
+        }
+        const size_t batches = (pairs + BATCH - 1) / BATCH;
+        if (bounces.size() < batches) {
+            MemoryTracker::expectGrowth(bounces, batches);
+            bounces.resize(batches);
+        }
+        // No boid appears twice in a color, so the batches never touch the same boid
+        auto bounceBatches = [&](size_t begin, size_t end) {
+            for (size_t batch = begin; batch < end; ++batch) {
+                int bounced = 0;
+                for (size_t i = first + batch * BATCH; i < first + std::min(pairs, (batch + 1) * BATCH); ++i) {
+                    bounced += bouncePair(boids[sorted[i].a], boids[sorted[i].b]);
+                }
+                bounces[batch] = bounced;
+            }
+        };
+        if (threads) {
+            threads->parallelFor(batches, 1, bounceBatches);
+        } else {
+            bounceBatches(0, batches);
+        }
+        for (size_t batch = 0; batch < batches; ++batch) {
+            total += bounces[batch];
+        }
+    }
+    stats.bounces = (size_t) total;
+    return total;
+}
+
+const ContactSolver::Stats &ContactSolver::getStats() const {
+    return stats;
+}
+
+size_t ContactSolver::memoryUsage() const {
+    size_t bytes = found.capacity() * sizeof(vector<Pair>) + sorted.capacity() * sizeof(Pair) +
+                   colorStart.capacity() * sizeof(size_t) + used.capacity() * sizeof(uint64_t) +
+                   bounces.capacity() * sizeof(int);
+    for (const vector<Pair> &pairs : found) {
+        bytes += pairs.capacity() * sizeof(Pair);
+    }
+    return bytes;
+}
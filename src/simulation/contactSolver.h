@@ -0,0 +1,72 @@
+#ifndef GRAPHICS_CONTACTSOLVER_H
+#define GRAPHICS_CONTACTSOLVER_H
+
+#include <cstdint>
+#include <vector>
+#include "spatialGrid.h"
+#include "../framework/threadPool.h"
+
+using std::vector;
+
+/**
+ * @brief Resolves every collision of a flock in parallel, without locks or atomics.
+ * @details Boid::bounce() moves both boids of a contact, so two contacts that share a boid cannot be resolved at
+ * the same time. resolve() finds every overlapping pair with a SpatialGrid, then colors the pairs greedily so
+ * that no boid appears twice in one color. The colors are resolved one after another, and the pairs of a color,
+ * which touch disjoint boids, are split over the threads.
+ * @details Pairs are found and colored in a fixed order and each color is a fixed list, so the result does not
+ * depend on the number of threads. A boid in more than MAX_COLORS - 1 contacts at once (a dense pile-up) gets its
+ * extra pairs resolved one by one after the colors.
+ * @details Each block of boids has room for one pair per boid. The number of pairs depends on the positions, so a
+ * pile-up can still grow the lists mid-step: that restarts the MemoryTracker warm-up instead of tripping strict mode.
+ */
+class ContactSolver {
+public:
+    /// @brief Colors tracked per boid (one bit each); the last one holds the pairs resolved one by one
+    static const int MAX_COLORS = 64;
+
+    /// @brief Counters of the last resolve()
+    struct Stats {
+        /// @brief Overlapping pairs found, and how many of them still overlapped when their color came
+        size_t pairs = 0, bounces = 0;
+        /// @brief Colors used, the last one included if any pair needed it
+        int colors = 0;
+    };
+
+    /// @brief Finds and resolves every overlapping pair of the count boids
+    /// @details Each pair bounces if it still overlaps when its color comes, and a leader converts the regular
+    /// boid of another team it hits.
+    /// @param grid Built over boids at their current positions
+    /// @param reach Largest sum of the radii of two boids
+    /// @param threads Splits the search and the colors, or nullptr for this thread only
+    /// @return The number of bounces
+    int resolve(Boid *boids, size_t count, const SpatialGrid &grid, float reach, ThreadPool *threads);
+
+    const Stats &getStats() const;
+    /// @brief Bytes reserved by the pair lists and colors
+    size_t memoryUsage() const;
+
+private:
+    /// @brief Boids searched per task, and pairs resolved per task
+    static const size_t BLOCK = 1024, BATCH = 256;
+    /// @brief Pairs reserved per boid before a list has to grow
+    static const size_t PAIRS_PER_BOID = 1;
+
+    struct Pair {
+        int a, b;
+        int color;
+    };
+
+    /// @brief Pairs found by each block of boids, a < b
+    vector<vector<Pair>> found;
+    /// @brief Pairs of color c are sorted[colorStart[c]] to sorted[colorStart[c + 1] - 1]
+    vector<Pair> sorted;
+    vector<size_t> colorStart;
+    /// @brief Colors taken by each boid, one bit per color
+    vector<uint64_t> used;
+    /// @brief Bounces of each batch of a color
+    vector<int> bounces;
+    Stats stats;
+};
+
+#endif //GRAPHICS_CONTACTSOLVER_H
@@ -0,0 +1,361 @@
+#include "domainDecomposition.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#define DOMAIN_POSIX
+#endif
+
+/// @brief Message from the coordinator to every worker
+struct StepCommand {
+    float deltaTime;
+    /// @brief 0 tells the worker to exit
+    uint32_t run;
+};
+
+/// @brief Header of the reply from a worker, followed by count DomainBoids
+struct StepResult {
+    uint32_t count;
+    uint32_t contacts;
+};
+
+#ifdef DOMAIN_POSIX
+
+#ifdef MSG_NOSIGNAL
+static const int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+static const int SEND_FLAGS = 0;
+#endif
+
+static bool writeAll(int fd, const void *data, size_t bytes) {
+    const char *p = static_cast<const char *>(data);
+    while (bytes > 0) {
+        ssize_t n = send(fd, p, bytes, SEND_FLAGS);
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        bytes -= n;
+    }
+    return true;
+}
+
+static bool readAll(int fd, void *data, size_t bytes) {
+    char *p = static_cast<char *>(data);
+    while (bytes > 0) {
+        ssize_t n = recv(fd, p, bytes, 0);
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        bytes -= n;
+    }
+    return true;
+}
+
+/**
+ * @brief Sends out to the other end of fd while receiving its list into in
+ * @details Both ends send at the same time, so sending and receiving are interleaved with poll() to never
+ * block on a full socket buffer.
+ */
+static bool exchange(int fd, const vector<DomainBoid> &out, vector<DomainBoid> &in) {
+    uint32_t outCount = (uint32_t) out.size(), inCount = 0;
+    size_t sent = 0, got = 0;
+    const size_t outBytes = sizeof(outCount) + out.size() * sizeof(DomainBoid);
+    size_t inBytes = sizeof(inCount);
+
+    while (sent < outBytes || got < inBytes) {
+        pollfd request{fd, (short) ((sent < outBytes ? POLLOUT : 0) | (got < inBytes ? POLLIN : 0)), 0};
+        if (poll(&request, 1, -1) < 0) {
+            return false;
+        }
+        if (request.revents & (POLLERR | POLLNVAL)) {
+            return false;
+        }
+        if (sent < outBytes && (request.revents & POLLOUT)) {
+            // The count goes first, then the boids
+            const char *data = sent < sizeof(outCount) ? (const char *) &outCount + sent
+                                                       : (const char *) out.data() + (sent - sizeof(outCount));
+            size_t chunk = sent < sizeof(outCount) ? sizeof(outCount) - sent : outBytes - sent;
+            ssize_t n = send(fd, data, chunk, SEND_FLAGS | MSG_DONTWAIT);
+            if (n < 0) {
+                return false;
+            }
+            sent += n;
+        }
+        if (got < inBytes && (request.revents & (POLLIN | POLLHUP))) {
+            char *data = got < sizeof(inCount) ? (char *) &inCount + got
+                                               : (char *) in.data() + (got - sizeof(inCount));
+            size_t chunk = got < sizeof(inCount) ? sizeof(inCount) - got : inBytes - got;
+            ssize_t n = recv(fd, data, chunk, MSG_DONTWAIT);
+            if (n <= 0) {
+                return false;
+            }
+            got += n;
+            if (got == sizeof(inCount)) {
+                in.resize(inCount);
+                inBytes += inCount * sizeof(DomainBoid);
+            }
+        }
+    }
+    if (inCount == 0) {
+        in.clear();
+    }
+    return true;
+}
+
+#endif
+
+DomainDecomposition::DomainDecomposition(Flock &flock) : flock(flock) {}
+
+DomainDecomposition::~DomainDecomposition() {
+    stop();
+}
+
+int DomainDecomposition::start(int count) {
+#ifdef DOMAIN_POSIX
+    stop();
+    count = std::clamp(count, 1, std::max(1, (int) (flock.getWidth() / HALO_WIDTH)));
+
+    // Map ids back to handles to merge the results
+    BoidPool &boids = flock.getBoids();
+    handles.assign(boids.capacity(), BoidHandle());
+    for (size_t i = 0; i < boids.size(); ++i) {
+        BoidHandle handle = boids.handleAt(i);
+        handles[handle.id] = handle;
+    }
+    received.reserve(boids.size());
+
+    // One socket per worker to the coordinator, and one between each pair of neighbors
+    vector<int> coordinator(2 * count, -1), neighbors(2 * std::max(count - 1, 0), -1);
+    bool ok = true;
+    for (int i = 0; i < count && ok; ++i) {
+        ok = socketpair(AF_UNIX, SOCK_STREAM, 0, &coordinator[2 * i]) == 0;
+    }
+    for (int i = 0; i < count - 1 && ok; ++i) {
+        ok = socketpair(AF_UNIX, SOCK_STREAM, 0, &neighbors[2 * i]) == 0;
+    }
+#ifdef SO_NOSIGPIPE
+    // No MSG_NOSIGNAL on macOS: a worker dying must not kill the coordinator with SIGPIPE
+    int one = 1;
+    for (int fd : coordinator) { if (fd >= 0) setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one)); }
+    for (int fd : neighbors) { if (fd >= 0) setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one)); }
+#endif
+    if (!ok) {
+        std::cout << "| ERROR::DOMAIN: Failed to create sockets" << std::endl;
+        for (int fd : coordinator) { if (fd >= 0) close(fd); }
+        for (int fd : neighbors) { if (fd >= 0) close(fd); }
+        return 0;
+    }
+
+    std::cout.flush();
+    for (int i = 0; i < count; ++i) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            // Keep only this worker's ends: [2i + 1] of its coordinator pair, [2(i-1) + 1] and [2i] of the neighbor pairs
+            int left = i > 0 ? neighbors[2 * (i - 1) + 1] : -1;
+            int right = i < count - 1 ? neighbors[2 * i] : -1;
+            for (int j = 0; j < (int) coordinator.size(); ++j) {
+                if (j != 2 * i + 1) close(coordinator[j]);
+            }
+            for (int fd : neighbors) {
+                if (fd != left && fd != right) close(fd);
+            }
+            runWorker(i, count, coordinator[2 * i + 1], left, right);
+        }
+        if (pid < 0) {
+            std::cout << "| ERROR::DOMAIN: Failed to start worker " << i << std::endl;
+            for (int j = i; j < count; ++j) {
+                close(coordinator[2 * j]);
+            }
+            break;
+        }
+        workers.push_back({pid, coordinator[2 * i]});
+    }
+
+    // The coordinator only talks to the workers through its own ends
+    for (int i = 0; i < count; ++i) {
+        close(coordinator[2 * i + 1]);
+    }
+    for (int fd : neighbors) {
+        close(fd);
+    }
+
+    if ((int) workers.size() < count) {
+        stop();
+        return 0;
+    }
+    return count;
+#else
+    std::cout << "| ERROR::DOMAIN: Worker processes are only supported on POSIX systems" << std::endl;
+    return 0;
+#endif
+}
+
+void DomainDecomposition::stop() {
+#ifdef DOMAIN_POSIX
+    StepCommand command{0, 0};
+    for (Worker &worker : workers) {
+        writeAll(worker.fd, &command, sizeof(command));
+        close(worker.fd);
+    }
+    for (Worker &worker : workers) {
+        waitpid(worker.pid, nullptr, 0);
+    }
+#endif
+    workers.clear();
+}
+
+bool DomainDecomposition::step(float deltaTime) {
+#ifdef DOMAIN_POSIX
+    StepCommand command{deltaTime, 1};
+    bool ok = true;
+    for (Worker &worker : workers) {
+        ok = ok && writeAll(worker.fd, &command, sizeof(command));
+    }
+
+    contacts = 0;
+    BoidPool &boids = flock.getBoids();
+    for (Worker &worker : workers) {
+        StepResult result{};
+        ok = ok && readAll(worker.fd, &result, sizeof(result));
+        if (!ok) {
+            break;
+        }
+        received.resize(result.count);
+        ok = readAll(worker.fd, received.data(), received.size() * sizeof(DomainBoid));
+        for (const DomainBoid &record : received) {
+            if (Boid *boid = boids.get(handles[record.id])) {
+                *boid = record.boid;
+            }
+        }
+        contacts += result.contacts;
+    }
+
+    if (!ok) {
+        std::cout << "| ERROR::DOMAIN: Lost a worker, stopping the decomposition" << std::endl;
+        stop();
+        return false;
+    }
+    flock.countTeams();
+    return true;
+#else
+    return false;
+#endif
+}
+
+void DomainDecomposition::runWorker(int index, int count, int coordinatorFd, int leftFd, int rightFd) {
+#ifdef DOMAIN_POSIX
+    // Strip edges; the outer strips also own anything past the edges of the world
+    const float stripWidth = (float) flock.getWidth() / count;
+    const float x0 = index * stripWidth, x1 = (index + 1) * stripWidth;
+    auto owns = [&](float x) { return (index == 0 || x >= x0) && (index == count - 1 || x < x1); };
+
+    // fork() only copied the calling thread: the coordinator's pool has no workers here
+    flock.setThreadPool(nullptr);
+
+    // Take this strip's boids from the copy of the flock inherited from the coordinator
+    vector<DomainBoid> owned;
+    const BoidPool &boids = flock.getBoids();
+    for (size_t i = 0; i < boids.size(); ++i) {
+        if (owns(boids[i].pos.x)) {
+            owned.push_back({boids.handleAt(i).id, boids[i]});
+        }
+    }
+
+    vector<DomainBoid> toLeft, toRight, fromLeft, fromRight;
+    vector<Boid> current, next;
+    vector<uint32_t> ids;
+
+    // Swaps lists with both neighbors. Even strips talk to the right first and odd strips to the left first,
+    // so every pair of neighbors is ready for each other at the same time.
+    auto exchangeNeighbors = [&]() {
+        bool ok = true;
+        for (int pass = 0; pass < 2 && ok; ++pass) {
+            bool right = (pass == 0) == (index % 2 == 0);
+            if (right && rightFd >= 0) {
+                ok = exchange(rightFd, toRight, fromRight);
+            } else if (!right && leftFd >= 0) {
+                ok = exchange(leftFd, toLeft, fromLeft);
+            }
+        }
+        return ok;
+    };
+
+    StepCommand command{};
+    while (readAll(coordinatorFd, &command, sizeof(command)) && command.run) {
+        // Halos: boids the neighbors need to update their own
+        toLeft.clear();
+        toRight.clear();
+        fromLeft.clear();
+        fromRight.clear();
+        for (const DomainBoid &record : owned) {
+            if (index > 0 && record.boid.pos.x < x0 + HALO_WIDTH) {
+                toLeft.push_back(record);
+            }
+            if (index < count - 1 && record.boid.pos.x >= x1 - HALO_WIDTH) {
+                toRight.push_back(record);
+            }
+        }
+        if (!exchangeNeighbors()) {
+            break;
+        }
+
+        // Own boids first, then the halo boids that are only read
+        current.clear();
+        ids.clear();
+        for (const vector<DomainBoid> *list : {&owned, &fromLeft, &fromRight}) {
+            for (const DomainBoid &record : *list) {
+                current.push_back(record.boid);
+                ids.push_back(record.id);
+            }
+        }
+        next.resize(owned.size());
+        int contacts = flock.stepSynchronous(command.deltaTime, current.data(), ids.data(), current.size(),
+                                             owned.size(), next.data());
+
+        // Migration: hand the boids that left the strip to the neighbor on that side
+        toLeft.clear();
+        toRight.clear();
+        fromLeft.clear();
+        fromRight.clear();
+        size_t kept = 0;
+        for (size_t i = 0; i < owned.size(); ++i) {
+            owned[i].boid = next[i];
+            float x = next[i].pos.x;
+            if (owns(x)) {
+                owned[kept++] = owned[i];
+            } else if (x < x0) {
+                toLeft.push_back(owned[i]);
+            } else {
+                toRight.push_back(owned[i]);
+            }
+        }
+        owned.resize(kept);
+        if (!exchangeNeighbors()) {
+            break;
+        }
+        // A boid is only passed on one strip per step; if it went further the next owner passes it along
+        owned.insert(owned.end(), fromLeft.begin(), fromLeft.end());
+        owned.insert(owned.end(), fromRight.begin(), fromRight.end());
+
+        StepResult result{(uint32_t) owned.size(), (uint32_t) contacts};
+        if (!writeAll(coordinatorFd, &result, sizeof(result)) ||
+            !writeAll(coordinatorFd, owned.data(), owned.size() * sizeof(DomainBoid))) {
+            break;
+        }
+    }
+    // Skip the destructors and atexit handlers of the coordinator's objects copied by fork()
+    _exit(0);
+#endif
+}
+
+bool DomainDecomposition::isRunning() const   { return !workers.empty(); }
+int DomainDecomposition::getWorkerCount() const { return (int) workers.size(); }
+int DomainDecomposition::getContactCount() const { return contacts; }
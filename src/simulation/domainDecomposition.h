@@ -0,0 +1,79 @@
+#ifndef GRAPHICS_DOMAINDECOMPOSITION_H
+#define GRAPHICS_DOMAINDECOMPOSITION_H
+
+#include <cstdint>
+#include <vector>
+#include "flock.h"
+
+using std::vector;
+
+/// @brief A boid as sent between processes, with the id that orders it (its BoidHandle::id in the coordinator)
+struct DomainBoid {
+    uint32_t id;
+    Boid boid;
+};
+
+/**
+ * @brief Runs the SYNCHRONOUS flock update split over several worker processes on one host.
+ * @details The world is cut into vertical strips, each owned by a forked worker that only holds its own boids.
+ * Every step, neighboring workers swap the boids within HALO_WIDTH of their shared edge (halos) over
+ * UNIX domain sockets, update their own boids, then hand the boids that crossed an edge to the new owner.
+ * @details The coordinator (the calling process) keeps the merged state in its Flock for rendering.
+ * Boids are updated exactly like Flock::update() in UpdateMode::SYNCHRONOUS, so the result is the same
+ * as a single-process run.
+ * @details Spawning, despawning and flow field changes in the coordinator are not sent to running workers.
+ */
+class DomainDecomposition {
+public:
+    /// @brief Boids closer than this to a strip edge are copied to the neighbor each step
+    static constexpr float HALO_WIDTH = Flock::INTERACTION_RADIUS + 2 * Flock::LEADER_RADIUS;
+
+    /// @brief Construct a new DomainDecomposition of flock (not started)
+    explicit DomainDecomposition(Flock &flock);
+
+    /// @brief Stops the workers
+    ~DomainDecomposition();
+
+    DomainDecomposition(const DomainDecomposition &) = delete;
+    DomainDecomposition &operator=(const DomainDecomposition &) = delete;
+
+    /// @brief Splits the current boids over up to workers processes
+    /// @details Strips are kept at least HALO_WIDTH wide, so a halo only ever comes from the two neighbors.
+    /// @return The number of workers started, 0 if processes are not supported or could not be started
+    int start(int workers);
+
+    /// @brief Tells the workers to exit and waits for them
+    void stop();
+
+    /// @brief Advances every worker by one step and copies their boids back into the flock
+    /// @return false if a worker failed, in which case the decomposition is stopped
+    bool step(float deltaTime);
+
+    // -----------------------------------
+    // Getters
+    // -----------------------------------
+    bool isRunning() const;
+    int getWorkerCount() const;
+    /// @brief Number of collisions resolved by all workers in the last step()
+    int getContactCount() const;
+
+private:
+    /// @brief Coordinator side of one worker
+    struct Worker {
+        int pid = -1;
+        /// @brief Socket to the worker
+        int fd = -1;
+    };
+
+    /// @brief Body of a worker process; never returns
+    void runWorker(int index, int count, int coordinatorFd, int leftFd, int rightFd);
+
+    Flock &flock;
+    vector<Worker> workers;
+    /// @brief Handle of every boid in the flock by id, to merge the workers' results
+    vector<BoidHandle> handles;
+    vector<DomainBoid> received;
+    int contacts = 0;
+};
+
+#endif //GRAPHICS_DOMAINDECOMPOSITION_H
@@ -0,0 +1,852 @@
+#include "flock.h"
+#include "../framework/memoryTracker.h"
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+
+static float distance(const Boid &boid1, const Boid &boid2) {
+    return glm::distance(boid1.pos, boid2.pos);
+}
+
+template <typename F>
+auto Flock::withConfig(F fn) {
+    // Each preset gets its own copy of the kernels with the constants folded in
+    switch (preset) {
+        case Preset::CLASSIC:
+            return fn(FixedConfig<Preset::CLASSIC>());
+        case Preset::SCHOOL:
+            return fn(FixedConfig<Preset::SCHOOL>());
+        case Preset::SWARM:
+            return fn(FixedConfig<Preset::SWARM>());
+        default:
+            return fn(RuntimeConfig{&config});
+    }
+}
+
+Flock::Flock(unsigned int width, unsigned int height, size_t capacity)
+    : width(width), height(height), boids(capacity) {
+    flowField.init(width, height, FLOW_CELL_SIZE);
+}
+
+BoidHandle Flock::spawn(vec2 pos, vec2 velocity, int team, bool leader) {
+    Boid boid;
+    boid.pos = pos;
+    boid.velocity = velocity;
+    boid.radius = leader ? LEADER_RADIUS : RADIUS;
+    boid.team = team;
+    boid.leader = leader;
+    BoidHandle handle = boids.spawn(boid);
+    // The id may have steered a despawned boid before
+    if (handle.valid() && !steeringCache.empty()) {
+        steeringCache[handle.id] = vec2(0, 0);
+    }
+    return handle;
+}
+
+int Flock::spawnFlock(vec2 center, int count, int team) {
+    // Scatter the boids over a disc that grows with the size of the flock
+    const float spread = RADIUS * 4 * sqrt((float) count);
+    int spawned = 0;
+
+    for (int i = 0; i < count && !boids.full(); ++i) {
+        bool leader = i % 10 == 9;
+        float maxSpeed = leader ? LEADER_MAX_SPEED : MAX_SPEED;
+
+        float theta = 2.0f * 3.1415926f * float(rand()) / float(RAND_MAX);
+        float r = spread * sqrt(float(rand()) / float(RAND_MAX));
+        vec2 position = center + vec2(r * cosf(theta), r * sinf(theta));
+        vec2 velocity(rand() % int(maxSpeed), rand() % int(maxSpeed));
+
+        spawn(position, velocity, team, leader);
+        ++spawned;
+    }
+    return spawned;
+}
+
+/// @brief splitmix64: a well mixed 64-bit value for each input, so random draws need no shared state
+static uint64_t mix(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+/// @brief Uniform in [0, 1) from the top 53 bits of x
+static double unit(uint64_t x) {
+    return (double) (x >> 11) * (1.0 / 9007199254740992.0);
+}
+
+size_t Flock::scatter(vec2 min, vec2 max, size_t count, int teams, uint32_t seed) {
+    count = std::min(count, boids.capacity() - boids.size());
+    if (count == 0 || teams <= 0) {
+        return 0;
+    }
+
+    vec2 center = (min + max) * 0.5f;
+    vec2 size = glm::max(max - min, vec2(SPAWN_SPACING, SPAWN_SPACING));
+    auto cellsIn = [](vec2 size) {
+        return (size_t) (size.x / SPAWN_SPACING) * (size_t) (size.y / SPAWN_SPACING);
+    };
+    if (cellsIn(size) < count) {
+        size *= std::sqrt((float) count / (float) cellsIn(size));
+        while (cellsIn(size) < count) {
+            size *= 1.01f;
+        }
+    }
+    const size_t columns = (size_t) (size.x / SPAWN_SPACING), cells = cellsIn(size);
+    const vec2 origin = center - vec2((float) columns, (float) (cells / columns)) * (SPAWN_SPACING * 0.5f);
+    // Boid i takes a cell in [ceil(i * stride), ceil((i + 1) * stride)): at least one, and no two boids share one
+    const double stride = (double) cells / (double) count;
+    const float jitter = SPAWN_SPACING - 2 * LEADER_RADIUS;
+
+    vector<Boid> placed(count);
+    auto place = [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            uint64_t random = mix((uint64_t) seed << 32 ^ i);
+            size_t first = (size_t) std::ceil(i * stride);
+            size_t last = std::min((size_t) std::ceil((i + 1) * stride), cells);
+            size_t cell = first + (size_t) (unit(random) * (double) (last - first));
+            Boid &boid = placed[i];
+            boid.leader = (random = mix(random)) % 10 == 9;
+            boid.team = (int) ((random = mix(random)) % (uint64_t) teams);
+            vec2 corner = origin + vec2((float) (cell % columns), (float) (cell / columns)) * SPAWN_SPACING;
+            float x = LEADER_RADIUS + jitter * (float) unit(random = mix(random));
+            float y = LEADER_RADIUS + jitter * (float) unit(random = mix(random));
+            boid.pos = corner + vec2(x, y);
+            float maxSpeed = boid.leader ? LEADER_MAX_SPEED : MAX_SPEED;
+            float vx = maxSpeed * (float) unit(random = mix(random));
+            float vy = maxSpeed * (float) unit(random = mix(random));
+            boid.velocity = vec2(vx, vy);
+        }
+    };
+    if (threads) {
+        threads->parallelFor(count, 4096, place);
+    } else {
+        place(0, count);
+    }
+
+    for (const Boid &boid : placed) {
+        spawn(boid.pos, boid.velocity, boid.team, boid.leader);
+    }
+    return count;
+}
+
+int Flock::despawnNear(vec2 center, float radius) {
+    int despawned = 0;
+    // Loop backwards: despawnAt() moves the last boid into the freed slot
+    for (size_t i = boids.size(); i > 0; --i) {
+        vec2 delta = boids[i - 1].pos - center;
+        if (glm::dot(delta, delta) < radius * radius) {
+            boids.despawnAt(i - 1);
+            ++despawned;
+        }
+    }
+    return despawned;
+}
+
+void Flock::checkBounds(Boid &boid1) const {
+    checkBounds(boid1, RuntimeConfig{&config});
+}
+
+template <typename Config>
+void Flock::checkBounds(Boid &boid1, Config rules) const {
+    const SimConfig &c = rules.get();
+    vec2 position = boid1.pos;
+    vec2 velocity = boid1.velocity;
+    const float rotation = c.turnSpeed;
+    vec2 newVelocity;
+    newVelocity.x = boid1.velocity.x;
+    newVelocity.y = boid1.velocity.y;
+
+    position += velocity * deltaTime;
+
+    if (boid1.pos.x < c.marginX) {
+        newVelocity.x += rotation;
+        boid1.velocity = newVelocity;
+        if (boid1.pos.x - boid1.radius < 0) {
+            boid1.pos.x = boid1.radius;
+        }
+    }
+    if (boid1.pos.x > width - c.marginX) {
+        newVelocity.x -= rotation;
+        boid1.velocity = newVelocity;
+        if (boid1.pos.x - boid1.radius > width) {
+            boid1.pos.x = boid1.radius;
+        }
+    }
+    if (boid1.pos.y < c.marginY) {
+        newVelocity.y += rotation;
+        boid1.velocity = newVelocity;
+        if (boid1.pos.y - boid1.radius < 0) {
+            boid1.pos.y = boid1.radius;
+        }
+    }
+    if (boid1.pos.y > height - c.marginY) {
+        newVelocity.y -= rotation;
+        boid1.velocity = newVelocity;
+        if (boid1.pos.y - boid1.radius > height) {
+            boid1.pos.y = boid1.radius;
+        }
+    }
+
+    boid1.pos = position;
+    boid1.velocity = newVelocity;
+}
+
+void Flock::avoidObstacles(Boid &boid1) const {
+    if (obstacles.empty()) {
+        return;
+    }
+    // Boids start turning this many pixels away from an obstacle
+    const float margin = 30;
+    // Velocity added per frame right at the surface
+    const float push = 20;
+
+    ObstacleField::Sample sample = obstacles.sample(boid1.pos);
+    if (sample.distance < margin) {
+        boid1.velocity += sample.normal * push * (margin - sample.distance) / margin;
+
+        // Never let a boid sink into an obstacle
+        if (sample.distance < boid1.radius) {
+            boid1.pos += sample.normal * (boid1.radius - sample.distance);
+        }
+    }
+}
+
+void Flock::bakeObstacles() {
+    obstacles.bake(width, height, OBSTACLE_CELL_SIZE);
+}
+
+void Flock::update(float deltaTime) {
+    this->deltaTime = deltaTime;
+    contacts = 0;
+
+    if (sortInterval > 0 && ++stepsSinceSort >= sortInterval) {
+        mortonOrder.sort(boids, (float) width, (float) height, threads);
+        stepsSinceSort = 0;
+    }
+
+    if (updateMode == UpdateMode::SYNCHRONOUS || deterministic) {
+        snapshot.assign(boids.begin(), boids.end());
+        snapshotIds.resize(boids.size());
+        for (size_t i = 0; i < boids.size(); ++i) {
+            snapshotIds[i] = boids.handleAt(i).id;
+        }
+        VerletList *lists = neighborSkin > 0 ? &verletLists : nullptr;
+        contacts = withConfig([&](auto rules) {
+            return stepSynchronous(snapshot.data(), snapshotIds.data(), snapshot.size(), snapshot.size(),
+                                   boids.begin(), rules, lists);
+        });
+        ++steeringStep;
+        countTeams();
+        return;
+    }
+
+    withConfig([this](auto rules) { updateSequential(rules); });
+    ++steeringStep;
+
+    // Count teams last: leaders convert boids during the loop
+    countTeams();
+}
+
+template <typename Config>
+void Flock::updateSequential(Config rules) {
+    const bool staggered = steeringInterval > 1;
+    // COLORED: the loop only moves and steers the boids, the collision stage after it bounces them
+    const bool inlineCollisions = collisionMode == CollisionMode::INLINE;
+    if (scratch.empty()) {
+        scratch.resize(1);
+    }
+    vector<int> &contactList = scratch[0].contacts;
+    // With staggered steering the grid also finds the collisions of the boids that skip their turn
+    if (neighborMode == NeighborMode::TOPOLOGICAL || staggered) {
+        grid.build(boids, gridCellSize);
+    }
+    if (neighborMode == NeighborMode::METRIC && cohesionMode == CohesionMode::QUADTREE) {
+        quadTree.build(boids);
+    }
+
+    for (Boid &boid1: boids) {
+
+        boid1.pos += boid1.velocity * deltaTime;
+
+        const uint32_t id = staggered ? boids.handleAt(&boid1 - boids.begin()).id : 0;
+        const vec2 before = boid1.velocity;
+        if (!steersNow(id, boid1.pos)) {
+            // Not this boid's turn: repeat its last steering and only look for collisions
+            boid1.velocity += steeringCache[id];
+            if (inlineCollisions) {
+                grid.forEachNear(boid1.pos, 2 * LEADER_RADIUS, [&](int slot) {
+                    collide(boid1, boids[slot]);
+                });
+            }
+        } else if (neighborMode == NeighborMode::TOPOLOGICAL) {
+            steerTopological(boid1, rules);
+            if (staggered) {
+                steeringCache[id] = boid1.velocity - before;
+            }
+
+            // Check for collisions with the boids in the surrounding cells
+            if (inlineCollisions) {
+                grid.forEachNear(boid1.pos, 2 * LEADER_RADIUS, [&](int slot) {
+                    collide(boid1, boids[slot]);
+                });
+            }
+        } else {
+            // One pass over the other boids gathers spacing, cohesion, alignment and contacts
+            const bool direct = cohesionMode == CohesionMode::DIRECT;
+            Interactions near;
+            contactList.clear();
+            for (size_t slot = 0; slot < boids.size(); ++slot) {
+                if (&boids[slot] != &boid1) {
+                    interact(boid1, boids[slot], (int) slot, direct, near, contactList, rules);
+                }
+            }
+            if (!direct) {
+                quadTree.gather(boid1.pos, rules.get().minDistance, rules.get().cohesionDistance, openingAngle,
+                                near.cohesion);
+            }
+            steer(boid1, near, rules);
+            if (staggered) {
+                steeringCache[id] = boid1.velocity - before;
+            }
+
+            // Resolve the collisions found in the pass. A bounce moves boid1, so from the first one on every
+            // later boid is tested again, as a separate collision loop would
+            if (!inlineCollisions) {
+                contactList.clear();
+            }
+            for (int slot: contactList) {
+                int before = contacts;
+                collide(boid1, boids[slot]);
+                if (contacts != before) {
+                    for (size_t rest = slot + 1; rest < boids.size(); ++rest) {
+                        collide(boid1, boids[rest]);
+                    }
+                    break;
+                }
+            }
+        }
+
+        finishStep(boid1, rules);
+    }
+
+    if (!inlineCollisions) {
+        grid.build(boids, gridCellSize);
+        contacts = contactSolver.resolve(boids.begin(), boids.size(), grid, 2 * LEADER_RADIUS, threads);
+    }
+}
+
+void Flock::countTeams() {
+    std::fill(teamCounts, teamCounts + MAX_TEAMS, 0);
+    for (const Boid &boid : boids) {
+        ++teamCounts[boid.team];
+    }
+}
+
+int Flock::stepSynchronous(float deltaTime, const Boid *current, const uint32_t *ids, size_t count, size_t owned,
+                           Boid *next) {
+    this->deltaTime = deltaTime;
+    // The halo changes every step, so lists would not outlive one step
+    int stepContacts = withConfig([&](auto rules) {
+        return stepSynchronous(current, ids, count, owned, next, rules, nullptr);
+    });
+    ++steeringStep;
+    return stepContacts;
+}
+
+template <typename Config>
+int Flock::stepSynchronous(const Boid *current, const uint32_t *ids, size_t count, size_t owned, Boid *next,
+                           Config rules, VerletList *lists) {
+    if (lists) {
+        lists->update(current, ids, count, INTERACTION_RADIUS, neighborSkin, gridCellSize);
+    } else {
+        grid.build(current, count, gridCellSize);
+    }
+
+    // Each boid only reads current and writes next[i], so blocks run on any thread in any order.
+    // The blocks themselves are fixed, so the same scratch lists serve the same boids whatever the thread count
+    const size_t blocks = (owned + stepBlock - 1) / stepBlock;
+    if (scratch.size() < blocks) {
+        scratch.resize(blocks);
+    }
+    auto stepBlocks = [&](size_t begin, size_t end) {
+        for (size_t block = begin; block < end; ++block) {
+            Scratch &local = scratch[block];
+            vector<int> &neighborList = local.neighbors;
+            local.contactCount = 0;
+            for (size_t i = block * stepBlock; i < std::min(owned, (block + 1) * stepBlock); ++i) {
+                neighborList.clear();
+                if (lists) {
+                    // The lists reach further than INTERACTION_RADIUS: keep the boids the grid would have found
+                    const int *listed = lists->neighborsOf(i);
+                    MemoryTracker::expectGrowth(neighborList, lists->countOf(i));
+                    for (int n = 0; n < lists->countOf(i); ++n) {
+                        if (distance(current[i], current[listed[n]]) < INTERACTION_RADIUS) {
+                            neighborList.push_back(listed[n]);
+                        }
+                    }
+                } else {
+                    // Boids that skip their steering this step only need the boids they may bounce off
+                    const float reach = steersNow(ids[i], current[i].pos) ? INTERACTION_RADIUS : 4 * LEADER_RADIUS;
+                    grid.forEachNear(current[i].pos, reach, [&](int slot) {
+                        if (distance(current[i], current[slot]) < reach) {
+                            MemoryTracker::expectGrowth(neighborList, neighborList.size() + 1);
+                            neighborList.push_back(slot);
+                        }
+                    });
+                    // The grid visits cells in an order that depends on its bounds: sort so only the ids matter
+                    std::sort(neighborList.begin(), neighborList.end(),
+                              [ids](int a, int b) { return ids[a] < ids[b]; });
+                }
+                next[i] = advance(current, (int) i, ids[i], neighborList.data(), (int) neighborList.size(), local,
+                                  rules);
+            }
+        }
+    };
+    if (threads) {
+        threads->parallelFor(blocks, 1, stepBlocks);
+    } else {
+        stepBlocks(0, blocks);
+    }
+
+    // Reduced in block order, never in the order the threads finish
+    int stepContacts = 0;
+    for (size_t block = 0; block < blocks; ++block) {
+        stepContacts += scratch[block].contactCount;
+    }
+    return stepContacts;
+}
+
+template <typename Config>
+Boid Flock::advance(const Boid *current, int self, uint32_t id, const int *neighbors, int count, Scratch &local,
+                    Config rules) {
+    Boid boid1 = current[self];
+
+    boid1.pos += boid1.velocity * deltaTime;
+
+    int first = 0;
+    if (steersNow(id, current[self].pos)) {
+        // One pass over the neighbors gathers spacing, cohesion, alignment and contacts
+        const vec2 before = boid1.velocity;
+        Interactions near;
+        local.contacts.clear();
+        for (int i = 0; i < count; ++i) {
+            if (neighbors[i] != self) {
+                interact(boid1, current[neighbors[i]], i, true, near, local.contacts, rules);
+            }
+        }
+        steer(boid1, near, rules);
+        if (steeringInterval > 1) {
+            steeringCache[id] = boid1.velocity - before;
+        }
+        first = local.contacts.empty() ? count : local.contacts[0];
+    } else {
+        boid1.velocity += steeringCache[id];
+    }
+
+    // Collisions only move boid1: the other boid handles its side of the contact itself.
+    // Once boid1 bounced, its position changed, so every later neighbor is tested again
+    for (int i = first; i < count; ++i) {
+        if (neighbors[i] == self) {
+            continue;
+        }
+        Boid other = current[neighbors[i]];
+        if (boid1.isOverlapping(other)) {
+            boid1.bounce(other);
+            ++local.contactCount;
+
+            // regular boids hit by a leader of an opposing team join it
+            if (other.leader && !boid1.leader && other.team != boid1.team) {
+                boid1.team = other.team;
+            }
+        }
+    }
+
+    finishStep(boid1, rules);
+    return boid1;
+}
+
+template <typename Config>
+void Flock::interact(const Boid &boid1, const Boid &boid2, int index, bool cohesion, Interactions &near,
+                     vector<int> &contactList, Config rules) {
+    const SimConfig &c = rules.get();
+    const float collideDist = 2 * LEADER_RADIUS;
+    const float reach = std::max({c.minDistance * 4, c.matchDistance, cohesion ? c.cohesionDistance : 0.0f,
+                                  collideDist});
+
+    // The only distance computed for the pair
+    vec2 delta = boid1.pos - boid2.pos;
+    float d2 = glm::dot(delta, delta);
+    if (d2 >= reach * reach) {
+        return;
+    }
+
+    near.spacing += separation(boid1, boid2, delta, d2, rules);
+    if (cohesion && d2 < c.cohesionDistance * c.cohesionDistance && d2 > c.minDistance * c.minDistance) {
+        near.cohesion.add(boid2.team, boid2.pos);
+    }
+    if (d2 < c.matchDistance * c.matchDistance) {
+        near.velocitySum += boid2.velocity;
+        ++near.velocityCount;
+    }
+    // Same test as Boid::isOverlapping()
+    float radiusSum = boid1.radius + boid2.radius;
+    if (d2 < radiusSum * radiusSum) {
+        MemoryTracker::expectGrowth(contactList, contactList.size() + 1);
+        contactList.push_back(index);
+    }
+}
+
+template <typename Config>
+void Flock::steer(Boid &boid1, const Interactions &near, Config rules) {
+    // Same order as calling avoid(), center() and matchVelocity() one after another
+    boid1.velocity += near.spacing;
+    center(boid1, near.cohesion, rules);
+    // boid1 counts towards its own average velocity with its state so far
+    matchVelocity(boid1, (near.velocitySum + boid1.velocity) / (float) (near.velocityCount + 1), rules);
+}
+
+void Flock::collide(Boid &boid1, Boid &other) {
+    if (&boid1 != &other && boid1.isOverlapping(other)) {
+        boid1.bounce(other);
+        ++contacts;
+
+        // change the team of regular boids hit by leader boids of opposing teams
+        if (boid1.leader && !other.leader && boid1.team != other.team) {
+            other.team = boid1.team;
+        }
+    }
+}
+
+template <typename Config>
+void Flock::steerTopological(Boid &boid1, Config rules) {
+    const SimConfig &c = rules.get();
+    const float minDist = c.minDistance;
+    // Cohesion radius; also bounds the neighbor search when a team is small
+    const float dist = c.cohesionDistance;
+    // Radius in which regular boids flee other teams
+    const float fleeDist = minDist * 4;
+
+    // leaders track the nearest boids of the other teams, regular boids their own teammates
+    int neighbors[MAX_NEIGHBORS];
+    int found = grid.nearest(boids, boid1.pos, neighborCount, dist, [&boid1](const Boid &boid2) {
+        return &boid1 != &boid2 && (boid2.team == boid1.team) != boid1.leader;
+    }, neighbors);
+
+    TeamSums near;
+    // boid1 counts towards its own average velocity, like in matchVelocity()
+    vec2 avgVelocity = boid1.velocity;
+    for (int i = 0; i < found; ++i) {
+        const Boid &boid2 = boids[neighbors[i]];
+        avoid(boid1, boid2, rules);
+        if (distance(boid1, boid2) > minDist) {
+            near.add(boid2.team, boid2.pos);
+        }
+        avgVelocity += boid2.velocity;
+    }
+
+    // regular boids still flee any rival that comes close
+    if (!boid1.leader) {
+        grid.forEachNear(boid1.pos, fleeDist, [&](int slot) {
+            if (boids[slot].team != boid1.team) {
+                avoid(boid1, boids[slot], rules);
+            }
+        });
+    }
+
+    center(boid1, near, rules);
+    matchVelocity(boid1, avgVelocity / (float) (found + 1), rules);
+}
+
+void Flock::center(Boid &boid1) {
+    center(boid1, RuntimeConfig{&config});
+}
+
+template <typename Config>
+void Flock::center(Boid &boid1, Config rules) {
+    const float dist = rules.get().cohesionDistance;
+    const float minDist = rules.get().minDistance;
+
+    TeamSums near;
+    if (cohesionMode == CohesionMode::QUADTREE) {
+        quadTree.gather(boid1.pos, minDist, dist, openingAngle, near);
+    } else {
+        for (const Boid &boid2: boids) {
+            float d = distance(boid1, boid2);
+            if (&boid1 != &boid2 && d < dist && d > minDist) {
+                near.add(boid2.team, boid2.pos);
+            }
+        }
+    }
+
+    center(boid1, near, rules);
+}
+
+void Flock::center(Boid &boid1, const TeamSums &near) {
+    center(boid1, near, RuntimeConfig{&config});
+}
+
+template <typename Config>
+void Flock::center(Boid &boid1, const TeamSums &near, Config rules) {
+    const float centerCoefficient = rules.get().centerCoefficient;
+
+    // swarm leaders head for the other teams, regular boids stay with their own
+    int numBoidsNear = 0;
+    vec2 center(0, 0);
+    for (int team = 0; team < MAX_TEAMS; ++team) {
+        if ((team == boid1.team) != boid1.leader) {
+            numBoidsNear += near.count[team];
+            center += near.sum[team];
+        }
+    }
+
+    if (numBoidsNear) {
+        // Same as pulling once per neighbor by (position - velocity) * centerCoefficient
+        boid1.velocity += (center - boid1.velocity * (float) numBoidsNear) * centerCoefficient;
+    }
+}
+
+void Flock::avoid(Boid &boid1, const Boid &boid2) {
+    avoid(boid1, boid2, RuntimeConfig{&config});
+}
+
+template <typename Config>
+void Flock::avoid(Boid &boid1, const Boid &boid2, Config rules) {
+    if (&boid1 != &boid2) {
+        vec2 delta = boid1.pos - boid2.pos;
+        boid1.velocity += separation(boid1, boid2, delta, glm::dot(delta, delta), rules);
+    }
+}
+
+template <typename Config>
+vec2 Flock::separation(const Boid &boid1, const Boid &boid2, vec2 delta, float d2, Config rules) {
+    const float minDist = rules.get().minDistance;
+    const float avoidCoeff = rules.get().avoidCoefficient;
+    // The offsets are truncated to whole pixels, as they always were
+    vec2 move((float) (int) delta.x, (float) (int) delta.y);
+    // if swarm leader
+    if (boid1.leader) {
+        if (d2 < minDist * minDist * 4 && boid1.team != boid2.team) {
+            // chase after boids of other teams
+            return move;
+        } else if (d2 < minDist * minDist && boid1.team == boid2.team) {
+            return move * avoidCoeff;
+        }
+    } else {
+        // case where boids are on the same team
+        if (d2 < minDist * minDist && boid1.team == boid2.team) {
+            return -move * avoidCoeff;
+        } else if (d2 < minDist * minDist * 16 && boid1.team != boid2.team) {
+            return move * 0.5f * avoidCoeff;
+        }
+    }
+    return vec2(0, 0);
+}
+
+void Flock::matchVelocity(Boid &boid1) {
+    matchVelocity(boid1, RuntimeConfig{&config});
+}
+
+template <typename Config>
+void Flock::matchVelocity(Boid &boid1, Config rules) {
+    float avgVelocityX = 0;
+    float avgVelocityY = 0;
+    const float dist = rules.get().matchDistance;
+    int numBoidsNear = 0;
+
+    for (const Boid &boid2: boids) {
+
+        if (distance(boid1, boid2) < dist) {
+            avgVelocityX += boid2.velocity.x;
+            avgVelocityY += boid2.velocity.y;
+            ++numBoidsNear;
+        }
+    }
+    if (numBoidsNear) {
+        avgVelocityX /= (float) numBoidsNear;
+        avgVelocityY /= (float) numBoidsNear;
+
+        matchVelocity(boid1, vec2(avgVelocityX, avgVelocityY), rules);
+    }
+}
+
+void Flock::matchVelocity(Boid &boid1, vec2 avgVelocity) {
+    matchVelocity(boid1, avgVelocity, RuntimeConfig{&config});
+}
+
+template <typename Config>
+void Flock::matchVelocity(Boid &boid1, vec2 avgVelocity, Config rules) {
+    const float matchCoeff = rules.get().matchCoefficient;
+    vec2 newVelocity;
+
+    newVelocity.x = boid1.velocity.x + (avgVelocity.x - boid1.velocity.x) * matchCoeff;
+    newVelocity.y = boid1.velocity.y + (avgVelocity.y - boid1.velocity.y) * matchCoeff;
+    boid1.velocity = newVelocity;
+}
+
+void Flock::finishStep(Boid &boid1) {
+    finishStep(boid1, RuntimeConfig{&config});
+}
+
+template <typename Config>
+void Flock::finishStep(Boid &boid1, Config rules) {
+    // Global guidance (currents, mouse attractors, wind)
+    if (!flowField.empty()) {
+        boid1.velocity += flowField.sample(boid1.pos) * deltaTime;
+    }
+
+    // Prevent boids from moving off screen
+    checkBounds(boid1, rules);
+
+    // Steer around obstacles
+    avoidObstacles(boid1);
+
+    // ensure no boid goes above the speed cap and flies off the screen
+    speedLimit(boid1, rules);
+}
+
+void Flock::speedLimit(Boid &boid1) {
+    speedLimit(boid1, RuntimeConfig{&config});
+}
+
+template <typename Config>
+void Flock::speedLimit(Boid &boid1, Config rules) {
+    const float speedLimit = rules.get().speedLimit;
+    float speed;
+    vec2 newVelocity;
+    speed = sqrt(boid1.velocity.x * boid1.velocity.x +
+            boid1.velocity.y * boid1.velocity.y);
+    if (boid1.leader) {
+        if (speed > speedLimit * 1.1) {
+            newVelocity.x = (boid1.velocity.x / speed) * speedLimit * 1.1;
+            newVelocity.y = (boid1.velocity.y / speed) * speedLimit * 1.1;
+            boid1.velocity = newVelocity;
+        } else if (speed < speedLimit / 2) {
+            if (boid1.velocity.x > 0) {
+                newVelocity.x = (boid1.velocity.x + 5);
+            } else {
+                newVelocity.x = (boid1.velocity.x - 5);
+            }
+            if (boid1.velocity.y > 0) {
+                newVelocity.y = (boid1.velocity.y + 5);
+            } else {
+                newVelocity.y = (boid1.velocity.y - 5);
+            }
+            boid1.velocity = newVelocity;
+        }
+    } else {
+        if (speed > speedLimit) {
+            newVelocity.x = (boid1.velocity.x / speed) * speedLimit;
+            newVelocity.y = (boid1.velocity.y / speed) * speedLimit;
+            boid1.velocity = newVelocity;
+        } else if (speed < speedLimit / 2) {
+            if (boid1.velocity.x > 0) {
+                newVelocity.x = (boid1.velocity.x + 3);
+            } else {
+                newVelocity.x = (boid1.velocity.x - 3);
+            }
+            if (boid1.velocity.y > 0) {
+                newVelocity.y = (boid1.velocity.y + 3);
+            } else {
+                newVelocity.y = (boid1.velocity.y - 3);
+            }
+            boid1.velocity = newVelocity;
+        }
+    }
+}
+
+void Flock::setPreset(Preset preset) {
+    if (preset == Preset::CUSTOM) {
+        setConfig(config);
+        return;
+    }
+    this->preset = preset;
+    config = presetConfig(preset);
+}
+
+void Flock::setConfig(const SimConfig &config) {
+    this->config = config;
+    // Nothing may reach past INTERACTION_RADIUS: SYNCHRONOUS updates and the halos of a DomainDecomposition
+    // only see boids that close
+    this->config.cohesionDistance = std::clamp(config.cohesionDistance, 0.0f, INTERACTION_RADIUS);
+    this->config.matchDistance = std::clamp(config.matchDistance, 0.0f, INTERACTION_RADIUS);
+    this->config.minDistance = std::clamp(config.minDistance, 0.0f, INTERACTION_RADIUS / 4);
+    preset = Preset::CUSTOM;
+}
+
+const SimConfig &Flock::getConfig() const { return config; }
+Preset Flock::getPreset() const           { return preset; }
+
+Flock::MemoryUsage Flock::memoryUsage() const {
+    return {boids.memoryUsage(), quadTree.memoryUsage(), grid.memoryUsage(),
+            obstacles.memoryUsage(), flowField.memoryUsage(), mortonOrder.memoryUsage(), verletLists.memoryUsage(),
+            contactSolver.memoryUsage()};
+}
+
+BoidPool &Flock::getBoids()             { return boids; }
+const BoidPool &Flock::getBoids() const { return boids; }
+ObstacleField &Flock::getObstacles()    { return obstacles; }
+const ObstacleField &Flock::getObstacles() const { return obstacles; }
+FlowField &Flock::getFlowField()        { return flowField; }
+int Flock::getContactCount() const      { return contacts; }
+int Flock::getTeamCount(int team) const { return teamCounts[team]; }
+const FlowField &Flock::getFlowField() const { return flowField; }
+unsigned int Flock::getWidth() const    { return width; }
+unsigned int Flock::getHeight() const   { return height; }
+
+void Flock::setCohesionMode(CohesionMode mode) { cohesionMode = mode; }
+CohesionMode Flock::getCohesionMode() const     { return cohesionMode; }
+void Flock::setTimeStep(float deltaTime)       { this->deltaTime = deltaTime; }
+void Flock::setSortInterval(int steps) {
+    sortInterval = std::max(steps, 0);
+    // Sort on the next update
+    stepsSinceSort = sortInterval;
+}
+int Flock::getSortInterval() const              { return sortInterval; }
+
+void Flock::setSteeringInterval(int steps) {
+    steeringInterval = std::max(steps, 1);
+    // Until their first turn the boids repeat no steering
+    steeringCache.assign(steeringInterval > 1 ? boids.capacity() : 0, vec2(0, 0));
+}
+
+int Flock::getSteeringInterval() const          { return steeringInterval; }
+
+void Flock::setNeighborSkin(float skin)         { neighborSkin = std::max(skin, 0.0f); }
+float Flock::getNeighborSkin() const            { return neighborSkin; }
+const VerletList::Stats &Flock::getNeighborListStats() const { return verletLists.getStats(); }
+
+void Flock::setSteeringFocus(vec2 min, vec2 max) {
+    focusMin = min;
+    focusMax = max;
+}
+
+bool Flock::steersNow(uint32_t id, vec2 pos) const {
+    if (steeringInterval <= 1 || (id + steeringStep) % steeringInterval == 0) {
+        return true;
+    }
+    // The focus follows the view, which a reproducible run must not depend on
+    if (deterministic) {
+        return false;
+    }
+    return pos.x >= focusMin.x && pos.x <= focusMax.x && pos.y >= focusMin.y && pos.y <= focusMax.y;
+}
+void Flock::setThreadPool(ThreadPool *threads)  { this->threads = threads; }
+void Flock::setUpdateMode(UpdateMode mode)    { updateMode = mode; }
+void Flock::setDeterministic(bool deterministic) { this->deterministic = deterministic; }
+bool Flock::isDeterministic() const             { return deterministic; }
+void Flock::setGridCellSize(float size)         { gridCellSize = std::max(size, 1.0f); }
+float Flock::getGridCellSize() const            { return gridCellSize; }
+void Flock::setStepBlock(size_t boids)          { stepBlock = std::max<size_t>(boids, 1); }
+size_t Flock::getStepBlock() const              { return stepBlock; }
+UpdateMode Flock::getUpdateMode() const         { return updateMode; }
+void Flock::setOpeningAngle(float theta)        { openingAngle = theta; }
+float Flock::getOpeningAngle() const            { return openingAngle; }
+void Flock::setNeighborMode(NeighborMode mode)  { neighborMode = mode; }
+NeighborMode Flock::getNeighborMode() const     { return neighborMode; }
+void Flock::setCollisionMode(CollisionMode mode) { collisionMode = mode; }
+CollisionMode Flock::getCollisionMode() const   { return collisionMode; }
+const ContactSolver::Stats &Flock::getContactStats() const { return contactSolver.getStats(); }
+void Flock::setNeighborCount(int k)             { neighborCount = std::clamp(k, 1, MAX_NEIGHBORS); }
+int Flock::getNeighborCount() const             { return neighborCount; }
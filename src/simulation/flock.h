@@ -0,0 +1,422 @@
+#ifndef GRAPHICS_FLOCK_H
+#define GRAPHICS_FLOCK_H
+
+#include "boidPool.h"
+#include "quadTree.h"
+#include "spatialGrid.h"
+#include "obstacleField.h"
+#include "flowField.h"
+#include "mortonOrder.h"
+#include "verletList.h"
+#include "contactSolver.h"
+#include "simConfig.h"
+
+/// @brief How Flock::center() finds the boids it steers towards
+enum class CohesionMode {
+    /// @brief Test every boid (O(n^2))
+    DIRECT,
+    /// @brief Use team centroids stored in a Barnes-Hut quadtree (O(n log n))
+    /// @details Approximate: the tree holds the positions from the start of the step, while a SEQUENTIAL update
+    /// moves the boids one by one and DIRECT sees the boids already moved.
+    QUADTREE
+};
+
+/// @brief Which neighbors the flocking rules look at
+enum class NeighborMode {
+    /// @brief Every boid within the radius of each rule
+    METRIC,
+    /// @brief Only the k nearest teammates (k nearest rivals for leaders), found with a SpatialGrid
+    TOPOLOGICAL
+};
+
+/// @brief How Flock::update() applies the rules to the boids
+enum class UpdateMode {
+    /// @brief Boids are updated one after another in place, so later boids see the new state of earlier ones
+    SEQUENTIAL,
+    /// @brief Every boid is updated from the state at the start of the step, with METRIC rules and exact cohesion
+    /// @details Neighbors are visited in order of BoidHandle::id, so the result does not depend on where the
+    /// boids are stored and a DomainDecomposition run reproduces it exactly. Blocks of boids are updated in
+    /// parallel when the flock has a ThreadPool.
+    SYNCHRONOUS
+};
+
+/// @brief How a SEQUENTIAL update resolves the collisions between boids
+enum class CollisionMode {
+    /// @brief Each boid bounces off the boids it overlaps during its own update, so later boids see the bounce
+    INLINE,
+    /// @brief Once every boid moved, all the overlapping pairs are resolved at once, in parallel (see ContactSolver)
+    COLORED
+};
+
+/**
+ * @brief The Flock class.
+ * @details Owns every boid and applies the flocking rules (cohesion, separation, alignment,
+ * collisions and screen bounds) each frame. It does not touch OpenGL, so boids can be spawned
+ * and despawned at any time without creating GL objects.
+ */
+class Flock {
+    public:
+        /// @brief Radius of regular boids and of leader boids
+        static constexpr float RADIUS = 5, LEADER_RADIUS = 8;
+
+        /// @brief Maximum spawn speed of regular boids and of leader boids
+        static constexpr float MAX_SPEED = 100, LEADER_MAX_SPEED = MAX_SPEED * 0.60f;
+
+        /// @brief Side of the cells scatter() places one boid in
+        /// @details Each boid stays LEADER_RADIUS away from the edges of its cell, so no two boids overlap.
+        static constexpr float SPAWN_SPACING = 3 * LEADER_RADIUS;
+
+        /// @brief Default cell size of the spatial grids (see setGridCellSize())
+        static constexpr float GRID_CELL_SIZE = 40;
+
+        /// @brief Spacing of the baked obstacle distance grid
+        static constexpr float OBSTACLE_CELL_SIZE = 8;
+
+        /// @brief Cell size of the flow field
+        static constexpr float FLOW_CELL_SIZE = 32;
+
+        /// @brief Largest distance at which one boid affects another (the cohesion radius)
+        static constexpr float INTERACTION_RADIUS = 200;
+
+        /// @brief Construct a new Flock object
+        /// @param width The width of the world (window)
+        /// @param height The height of the world (window)
+        /// @param capacity The maximum number of boids alive at once
+        Flock(unsigned int width, unsigned int height, size_t capacity);
+
+        /// @brief Adds a single boid to the flock
+        /// @return A handle to the boid, or an invalid handle if the flock is full
+        BoidHandle spawn(vec2 pos, vec2 velocity, int team, bool leader);
+
+        /// @brief Spawns count boids of one team scattered around center
+        /// @details One in ten of the spawned boids is a leader, like in Engine::initShapes().
+        /// @return The number of boids actually spawned (less than count if the pool fills up)
+        int spawnFlock(vec2 center, int count, int team);
+
+        /// @brief Spawns count boids spread over the rectangle from min to max, no two of them overlapping
+        /// @details Jittered grid sampling: the rectangle is cut into SPAWN_SPACING cells, count of them are
+        /// picked evenly at random and each gets one boid at a random spot inside it. If there are fewer cells
+        /// than boids, the rectangle grows around its center until they fit. Teams are picked at random and about
+        /// one in ten boids is a leader.
+        /// @details The boids are generated in parallel on the thread pool, each from its own index and seed, so
+        /// the result does not depend on the number of threads. A million boids take tens of milliseconds.
+        /// @return The number of boids actually spawned (less than count if the pool fills up)
+        size_t scatter(vec2 min, vec2 max, size_t count, int teams, uint32_t seed);
+
+        /// @brief Despawns every boid within radius of center
+        /// @return The number of boids despawned
+        int despawnNear(vec2 center, float radius);
+
+        /// @brief Bytes used by each part of the simulation
+        struct MemoryUsage {
+            size_t boids, quadTree, grid, obstacles, flowField, sort, neighborLists, contacts;
+        };
+        MemoryUsage memoryUsage() const;
+
+        /// @brief Advances the simulation by deltaTime seconds
+        void update(float deltaTime);
+
+        /// @brief One SYNCHRONOUS step over boids that are not stored in this flock
+        /// @details Computes next[i] for the first owned boids from the state of all count boids.
+        /// The remaining boids are only read (halo boids owned by another process).
+        /// @param ids The id ordering each boid (BoidHandle::id in the original pool)
+        /// @return The number of collisions resolved
+        int stepSynchronous(float deltaTime, const Boid *current, const uint32_t *ids, size_t count, size_t owned,
+                            Boid *next);
+
+        /// @brief Recounts getTeamCount() after the boids were changed outside update()
+        void countTeams();
+
+        /// @brief Sets the time step used by the rules when they are called outside update()
+        void setTimeStep(float deltaTime);
+
+        /// @brief Precomputes the obstacle distance grid over the world
+        /// @details Call once after adding obstacles; boids ignore obstacles added later until this is called again.
+        void bakeObstacles();
+
+        // -----------------------------------
+        // Getters
+        // -----------------------------------
+        BoidPool &getBoids();
+        const BoidPool &getBoids() const;
+        /// @brief Add obstacles to this, then call bakeObstacles()
+        ObstacleField &getObstacles();
+        const ObstacleField &getObstacles() const;
+        /// @brief Global steering (currents, attractors, wind) sampled by every boid
+        FlowField &getFlowField();
+        const FlowField &getFlowField() const;
+        /// @brief Number of collisions resolved in the last update()
+        int getContactCount() const;
+        /// @brief Number of boids in a team at the end of the last update()
+        int getTeamCount(int team) const;
+        unsigned int getWidth() const;
+        unsigned int getHeight() const;
+
+        // -----------------------------------
+        // Settings
+        // -----------------------------------
+        /// @brief Sets how cohesion finds its boids; DIRECT by default, QUADTREE is opt-in
+        void setCohesionMode(CohesionMode mode);
+        CohesionMode getCohesionMode() const;
+
+        void setUpdateMode(UpdateMode mode);
+        UpdateMode getUpdateMode() const;
+
+        /// @brief Sorts the boids along a Morton curve every steps updates, so neighbors are close in memory
+        /// @details 0 never sorts. In SEQUENTIAL mode this also changes the order the boids are updated in.
+        void setSortInterval(int steps);
+        int getSortInterval() const;
+
+        /// @brief Reuses the SYNCHRONOUS neighbor lists of update() until a boid moved more than skin / 2
+        /// @details Lists hold the boids within INTERACTION_RADIUS plus skin (see VerletList). A larger skin
+        /// rebuilds less often but lists more boids. The result is the same as rebuilding every step.
+        /// 0 finds the neighbors with the spatial grid every step.
+        void setNeighborSkin(float skin);
+        float getNeighborSkin() const;
+        /// @brief Rebuild counts and timings of the neighbor lists, for tuning the skin
+        const VerletList::Stats &getNeighborListStats() const;
+
+        /// @brief Recomputes each boid's neighbor steering (separation, cohesion, alignment) only every steps updates
+        /// @details Boids take turns by id, so 1/steps of them steer in each update; the others add the velocity
+        /// change of their last turn again. Every boid still moves, collides and applies bounds, obstacles, the flow
+        /// field and the speed limit every update. 1 (the default) steers every boid every update.
+        /// @details The last turn is remembered in this process only, so keep 1 for a DomainDecomposition.
+        void setSteeringInterval(int steps);
+        int getSteeringInterval() const;
+
+        /// @brief Boids inside the rectangle from min to max steer every update whatever the steering interval
+        /// @details E.g. the part of the world on screen. An empty rectangle (max < min, the default) turns it off.
+        void setSteeringFocus(vec2 min, vec2 max);
+
+        /// @brief Switches the rules to a preset, whose constants are compiled into its own copy of the update
+        /// @details CUSTOM keeps the current constants but runs them through the runtime path.
+        void setPreset(Preset preset);
+        Preset getPreset() const;
+
+        /// @brief Switches the rules to arbitrary constants (Preset::CUSTOM), read at runtime
+        /// @details Radii are clamped so no rule reaches past INTERACTION_RADIUS.
+        void setConfig(const SimConfig &config);
+        const SimConfig &getConfig() const;
+
+        /// @brief Threads used by the Morton sort, SYNCHRONOUS steps and COLORED collisions, or nullptr to run them on
+        /// the calling thread
+        /// @details Not owned. SYNCHRONOUS steps and COLORED collisions give the same result on any number of threads.
+        void setThreadPool(ThreadPool *threads);
+
+        /// @brief Makes update() bit-for-bit reproducible from the same boids, whatever the number of threads
+        /// @details Every update() is a SYNCHRONOUS step: each boid is computed from the state at the start of the
+        /// step, its neighbors and contacts are visited in id order, and the boids are split into blocks of
+        /// getStepBlock() boids that do not depend on the thread count, whose contact counts are added in block order.
+        /// The steering focus is ignored, since it follows the view. The cost is that of any SYNCHRONOUS step (the
+        /// copy of the boids, neighbors sorted by id), and the SEQUENTIAL-only TOPOLOGICAL and quadtree modes are off.
+        void setDeterministic(bool deterministic);
+        bool isDeterministic() const;
+
+        /// @brief Cell size of the spatial grids that find neighbors (TOPOLOGICAL, staggered, COLORED and SYNCHRONOUS
+        /// updates)
+        /// @details Changes how fast neighbors are found, not which ones (in SEQUENTIAL mode only the order staggered
+        /// boids collide in). Clamped to at least 1.
+        void setGridCellSize(float size);
+        float getGridCellSize() const;
+
+        /// @brief Boids per block of a SYNCHRONOUS step, the unit handed to the threads
+        /// @details Smaller blocks balance the threads better, larger ones are cheaper to hand out. The result
+        /// does not change. Clamped to at least 1.
+        void setStepBlock(size_t boids);
+        size_t getStepBlock() const;
+
+        /// @brief Sets the Barnes-Hut opening angle used in QUADTREE mode
+        /// @details 0 is exact; around 0.5 is a good tradeoff; above 1 is fast but coarse.
+        void setOpeningAngle(float theta);
+        float getOpeningAngle() const;
+
+        void setNeighborMode(NeighborMode mode);
+        NeighborMode getNeighborMode() const;
+
+        /// @brief Sets how SEQUENTIAL updates resolve collisions
+        /// @details COLORED runs on the thread pool and does not depend on the number of threads. SYNCHRONOUS
+        /// updates already resolve each boid's side of its contacts in parallel, and ignore it.
+        void setCollisionMode(CollisionMode mode);
+        CollisionMode getCollisionMode() const;
+        /// @brief Pairs and colors of the last COLORED collision stage
+        const ContactSolver::Stats &getContactStats() const;
+
+        /// @brief Sets how many neighbors each boid looks at in TOPOLOGICAL mode
+        /// @details Clamped to [1, MAX_NEIGHBORS].
+        void setNeighborCount(int k);
+        int getNeighborCount() const;
+
+        /// @brief Upper bound for setNeighborCount()
+        static const int MAX_NEIGHBORS = 32;
+
+        /// @brief Default number of boids per block of a SYNCHRONOUS step (see setStepBlock())
+        static const size_t STEP_BLOCK = 256;
+
+        // -----------------------------------
+        // Flocking rules
+        // -----------------------------------
+
+        /// @brief Prevents boids from going off screen
+        void checkBounds(Boid &boid1) const;
+
+        /// @brief Steers boid1 away from static obstacles and pushes it out of them
+        void avoidObstacles(Boid &boid1) const;
+
+        /// @brief Steers boid1 towards the centroid of nearby boids
+        /// @details Regular boids head for their own team, leaders head for the other teams.
+        void center(Boid &boid1);
+        /// @brief Steers boid1 towards the centroid of the boids already gathered in near
+        void center(Boid &boid1, const TeamSums &near);
+        void avoid(Boid &boid1, const Boid &boid2);
+        void matchVelocity(Boid &boid1);
+        /// @brief Steers boid1 towards avgVelocity
+        void matchVelocity(Boid &boid1, vec2 avgVelocity);
+        void speedLimit(Boid &boid1);
+
+        /// @brief Ends the step of a steered boid: flow field, bounds, obstacles, then the speed limit
+        /// @details Every update path calls it last, so they all apply these in the same order.
+        void finishStep(Boid &boid1);
+
+    private:
+        /// @brief Calls fn with FixedConfig<P> for the current preset, or a RuntimeConfig for CUSTOM
+        template <typename F>
+        auto withConfig(F fn);
+
+        /// @brief The rules above, reading their constants from a FixedConfig or RuntimeConfig
+        template <typename Config> void checkBounds(Boid &boid1, Config rules) const;
+        template <typename Config> void center(Boid &boid1, Config rules);
+        template <typename Config> void center(Boid &boid1, const TeamSums &near, Config rules);
+        template <typename Config> void avoid(Boid &boid1, const Boid &boid2, Config rules);
+        template <typename Config> void matchVelocity(Boid &boid1, Config rules);
+        template <typename Config> void matchVelocity(Boid &boid1, vec2 avgVelocity, Config rules);
+        template <typename Config> void speedLimit(Boid &boid1, Config rules);
+        template <typename Config> void finishStep(Boid &boid1, Config rules);
+
+        /// @brief What one boid gathered from its neighbors in a single pass
+        struct Interactions {
+            /// @brief Sum of the separation pushes
+            vec2 spacing = vec2(0, 0);
+            /// @brief Boids in the cohesion ring
+            TeamSums cohesion;
+            /// @brief Sum and number of the velocities within the alignment radius (boid1 not counted)
+            vec2 velocitySum = vec2(0, 0);
+            int velocityCount = 0;
+        };
+
+        /// @brief Velocity change avoid() applies to boid1 for boid2, given delta = boid1.pos - boid2.pos
+        template <typename Config>
+        static vec2 separation(const Boid &boid1, const Boid &boid2, vec2 delta, float d2, Config rules);
+
+        /// @brief Scratch lists of one block of a SYNCHRONOUS step (the first one also serves the SEQUENTIAL loop)
+        struct Scratch {
+            /// @brief Neighbor indices for advance()
+            vector<int> neighbors;
+            /// @brief The boids overlapping the one being updated, filled by interact()
+            vector<int> contacts;
+            /// @brief Collisions resolved in the block
+            int contactCount = 0;
+        };
+
+        /// @brief Adds boid2 (the index-th boid visited) to every rule of boid1 from one squared distance
+        /// @details index is appended to contactList if the boids overlap. Cohesion is only gathered if cohesion is set.
+        template <typename Config>
+        void interact(const Boid &boid1, const Boid &boid2, int index, bool cohesion, Interactions &near,
+                      vector<int> &contactList, Config rules);
+
+        /// @brief Applies separation, cohesion and alignment to boid1 in one go
+        template <typename Config>
+        void steer(Boid &boid1, const Interactions &near, Config rules);
+
+        /// @brief The SEQUENTIAL update loop
+        template <typename Config>
+        void updateSequential(Config rules);
+
+        /// @brief Body of the public stepSynchronous()
+        /// @param lists Neighbor lists to reuse, or nullptr to query the spatial grid for every boid
+        template <typename Config>
+        int stepSynchronous(const Boid *current, const uint32_t *ids, size_t count, size_t owned, Boid *next,
+                            Config rules, VerletList *lists);
+
+        /// @brief Applies the flocking rules to boid1 using its k nearest neighbors
+        template <typename Config>
+        void steerTopological(Boid &boid1, Config rules);
+
+        /// @brief Bounces boid1 off other if they overlap
+        void collide(Boid &boid1, Boid &other);
+
+        /// @brief Whether the boid with this id recomputes its steering in this update (see setSteeringInterval())
+        bool steersNow(uint32_t id, vec2 pos) const;
+
+        /// @brief SYNCHRONOUS update of current[self]
+        /// @param neighbors Indices into current of every boid within INTERACTION_RADIUS (self included), by id.
+        /// If the boid does not steer in this update, only the boids it may collide with are needed.
+        /// @param local Lists of the block the boid is in; collisions are counted in local.contactCount
+        template <typename Config>
+        Boid advance(const Boid *current, int self, uint32_t id, const int *neighbors, int count, Scratch &local,
+                     Config rules);
+
+        /// @brief Constants of the flocking rules
+        SimConfig config;
+        Preset preset = Preset::CLASSIC;
+
+        /// @brief Copy of the boids at the start of a SYNCHRONOUS update(), and their ids
+        vector<Boid> snapshot;
+        vector<uint32_t> snapshotIds;
+        /// @brief One Scratch per block of stepBlock boids, so threads never share one
+        vector<Scratch> scratch;
+        size_t stepBlock = STEP_BLOCK;
+        /// @brief Neighbor lists of SYNCHRONOUS update() steps, reused while no boid moved more than skin / 2
+        VerletList verletLists;
+        float neighborSkin = 20;
+        UpdateMode updateMode = UpdateMode::SEQUENTIAL;
+        bool deterministic = false;
+
+        /// @brief Morton sort of the pool, run every sortInterval steps
+        MortonOrder mortonOrder;
+        int sortInterval = 0;
+        int stepsSinceSort = 0;
+        ThreadPool *threads = nullptr;
+
+        /// @brief Staggered steering: velocity change of each boid's last turn, by BoidHandle::id
+        int steeringInterval = 1;
+        unsigned int steeringStep = 0;
+        vector<vec2> steeringCache;
+        vec2 focusMin = vec2(1, 1), focusMax = vec2(0, 0);
+
+        /// @brief The width and height of the world
+        unsigned int width, height;
+
+        /// @brief Time step of the current update()
+        float deltaTime = 0.0f;
+
+        /// @brief Storage for every live boid
+        BoidPool boids;
+
+        /// @brief Collision stage of COLORED SEQUENTIAL updates
+        ContactSolver contactSolver;
+        CollisionMode collisionMode = CollisionMode::INLINE;
+
+        /// @brief Stats of the last update()
+        int contacts = 0;
+        int teamCounts[MAX_TEAMS] = {};
+
+        /// @brief Spatial index for cohesion, rebuilt at the start of each update()
+        QuadTree quadTree;
+        CohesionMode cohesionMode = CohesionMode::DIRECT;
+        float openingAngle = 0.5f;
+
+        /// @brief Static obstacles and their baked distance grid
+        ObstacleField obstacles;
+
+        /// @brief Global steering layer
+        FlowField flowField;
+
+        /// @brief Spatial index for TOPOLOGICAL mode, rebuilt at the start of each update()
+        SpatialGrid grid;
+        float gridCellSize = GRID_CELL_SIZE;
+        NeighborMode neighborMode = NeighborMode::METRIC;
+        /// @brief k, the number of neighbors in TOPOLOGICAL mode (7 as in starling flocks)
+        int neighborCount = 7;
+};
+
+#endif //GRAPHICS_FLOCK_H
@@ -0,0 +1,106 @@
+#include "flowField.h"
+#include <algorithm>
+#include <cmath>
+
+void FlowField::init(float width, float height, float cellSize) {
+    this->cellSize = cellSize;
+    columns = (int) std::ceil(width / cellSize);
+    rows = (int) std::ceil(height / cellSize);
+    cells.assign(columns * rows, vec2(0, 0));
+    influences.clear();
+    used.clear();
+    activeCount = 0;
+}
+
+int FlowField::addInfluence(const Influence &influence) {
+    // Reuse a free entry before growing
+    int id = (int) (std::find(used.begin(), used.end(), false) - used.begin());
+    if (id == (int) influences.size()) {
+        influences.push_back(influence);
+        used.push_back(true);
+    } else {
+        influences[id] = influence;
+        used[id] = true;
+    }
+    ++activeCount;
+
+    stamp(influence, 1);
+    return id;
+}
+
+void FlowField::updateInfluence(int id, const Influence &influence) {
+    stamp(influences[id], -1);
+    influences[id] = influence;
+    stamp(influence, 1);
+}
+
+void FlowField::removeInfluence(int id) {
+    if (!used[id]) {
+        return;
+    }
+    stamp(influences[id], -1);
+    used[id] = false;
+
+    // Clear any rounding error left behind by the add/subtract updates
+    if (--activeCount == 0) {
+        std::fill(cells.begin(), cells.end(), vec2(0, 0));
+    }
+}
+
+void FlowField::setWind(vec2 wind) { this->wind = wind; }
+
+bool FlowField::empty() const { return activeCount == 0 && wind == vec2(0, 0); }
+
+size_t FlowField::memoryUsage() const {
+    return cells.capacity() * sizeof(vec2) + influences.capacity() * sizeof(Influence) + used.capacity() / 8;
+}
+
+void FlowField::stamp(const Influence &influence, float sign) {
+    if (influence.radius <= 0 || influence.strength == 0) {
+        return;
+    }
+
+    vec2 direction(0, 0);
+    if (influence.type == Type::CURRENT && glm::length(influence.direction) > 0) {
+        direction = glm::normalize(influence.direction);
+    }
+
+    // Only the cells whose centers can be within radius
+    int x0 = std::max((int) std::floor((influence.pos.x - influence.radius) / cellSize), 0);
+    int x1 = std::min((int) std::floor((influence.pos.x + influence.radius) / cellSize), columns - 1);
+    int y0 = std::max((int) std::floor((influence.pos.y - influence.radius) / cellSize), 0);
+    int y1 = std::min((int) std::floor((influence.pos.y + influence.radius) / cellSize), rows - 1);
+
+    for (int y = y0; y <= y1; ++y) {
+        for (int x = x0; x <= x1; ++x) {
+            vec2 center = (vec2(x, y) + vec2(0.5f, 0.5f)) * cellSize;
+            vec2 toPos = influence.pos - center;
+            float dist = glm::length(toPos);
+            if (dist >= influence.radius) {
+                continue;
+            }
+
+            // Linear falloff from full strength at pos to 0 at radius
+            float weight = sign * influence.strength * (1 - dist / influence.radius);
+            if (influence.type == Type::CURRENT) {
+                cells[y * columns + x] += direction * weight;
+            } else if (dist > 0) {
+                vec2 towards = toPos / dist;
+                cells[y * columns + x] += (influence.type == Type::ATTRACT ? towards : -towards) * weight;
+            }
+        }
+    }
+}
+
+vec2 FlowField::sample(vec2 pos) const {
+    // Values are stored at cell centers
+    vec2 cell = glm::clamp(pos / cellSize - vec2(0.5f, 0.5f), vec2(0, 0), vec2(columns - 1, rows - 1));
+    int x0 = std::min((int) cell.x, std::max(columns - 2, 0));
+    int y0 = std::min((int) cell.y, std::max(rows - 2, 0));
+    int x1 = std::min(x0 + 1, columns - 1), y1 = std::min(y0 + 1, rows - 1);
+    float fx = cell.x - x0, fy = cell.y - y0;
+
+    vec2 bottom = cells[y0 * columns + x0] + (cells[y0 * columns + x1] - cells[y0 * columns + x0]) * fx;
+    vec2 top = cells[y1 * columns + x0] + (cells[y1 * columns + x1] - cells[y1 * columns + x0]) * fx;
+    return bottom + (top - bottom) * fy + wind;
+}
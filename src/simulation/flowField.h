@@ -0,0 +1,80 @@
+#ifndef GRAPHICS_FLOWFIELD_H
+#define GRAPHICS_FLOWFIELD_H
+
+#include <vector>
+#include "glm/glm.hpp"
+
+using std::vector, glm::vec2;
+
+/**
+ * @brief Coarse vector field of global steering (currents, attractors, repulsors, wind).
+ * @details Every influence adds its contribution to the cells it touches. When an influence moves or changes,
+ * only those cells are updated: its old contribution is subtracted and the new one added.
+ * Boids read the field with one bilinear sample, so the per-boid cost does not depend on how many
+ * influences are active. Wind covers the whole world and is added at sample time instead of per cell.
+ */
+class FlowField {
+public:
+    enum class Type {
+        /// @brief Pulls towards pos
+        ATTRACT,
+        /// @brief Pushes away from pos
+        REPEL,
+        /// @brief Pushes along direction
+        CURRENT
+    };
+
+    struct Influence {
+        Type type = Type::ATTRACT;
+        vec2 pos;
+        /// @brief Cells further than this from pos are not touched
+        float radius = 0;
+        /// @brief Acceleration at pos in pixels per second squared, fading to 0 at radius
+        float strength = 0;
+        /// @brief Direction of CURRENT influences (normalized by the field)
+        vec2 direction;
+    };
+
+    /// @brief Allocates the grid covering [0, width] x [0, height]
+    void init(float width, float height, float cellSize);
+
+    /// @brief Adds an influence and stamps it into the grid
+    /// @return Id used to update or remove the influence
+    int addInfluence(const Influence &influence);
+
+    /// @brief Replaces an influence, touching only the cells covered by its old and new versions
+    void updateInfluence(int id, const Influence &influence);
+
+    /// @brief Removes an influence and its contribution
+    void removeInfluence(int id);
+
+    /// @brief Sets the uniform wind acceleration applied everywhere
+    void setWind(vec2 wind);
+
+    /// @brief Acceleration at pos (bilinear between cell centers, plus wind)
+    vec2 sample(vec2 pos) const;
+
+    /// @brief True if there is no influence and no wind, so sampling can be skipped
+    bool empty() const;
+
+    /// @brief Bytes reserved by the grid and the influence list
+    size_t memoryUsage() const;
+
+private:
+    /// @brief Adds sign times the contribution of influence to the cells it touches
+    void stamp(const Influence &influence, float sign);
+
+    /// @brief Accumulated contributions, one per cell, row major
+    vector<vec2> cells;
+    int columns = 0, rows = 0;
+    float cellSize = 1;
+
+    vector<Influence> influences;
+    /// @brief Which entries of influences are in use
+    vector<bool> used;
+    int activeCount = 0;
+
+    vec2 wind;
+};
+
+#endif //GRAPHICS_FLOWFIELD_H
@@ -0,0 +1,94 @@
+#include "mortonOrder.h"
+
+#include <algorithm>
+
+/// @brief Spreads the low 16 bits of value to the even bits
+static uint32_t spreadBits(uint32_t value) {
+    value &= 0xffff;
+    value = (value | (value << 8)) & 0x00ff00ff;
+    value = (value | (value << 4)) & 0x0f0f0f0f;
+    value = (value | (value << 2)) & 0x33333333;
+    value = (value | (value << 1)) & 0x55555555;
+    return value;
+}
+
+uint32_t MortonOrder::encode(uint32_t x, uint32_t y) {
+    return spreadBits(x) | (spreadBits(y) << 1);
+}
+
+void MortonOrder::sort(BoidPool &boids, float width, float height, ThreadPool *threads) {
+    const size_t count = boids.size();
+    if (count < 2) {
+        return;
+    }
+    keys.resize(count);
+    scratch.resize(count);
+    order.resize(count);
+
+    // Blocks of keys handled by one thread in every pass
+    const size_t blocks = threads ? threads->getThreadCount() : 1;
+    const size_t blockSize = (count + blocks - 1) / blocks;
+    histograms.resize(blocks * 256);
+    auto parallel = [&](auto fn) {
+        if (threads) {
+            threads->parallelFor(blocks, 1, [&](size_t begin, size_t end) {
+                for (size_t block = begin; block < end; ++block) {
+                    fn(block, block * blockSize, std::min(count, (block + 1) * blockSize));
+                }
+            });
+        } else {
+            fn(0, 0, count);
+        }
+    };
+
+    // Same scale on both axes so the curve is not stretched
+    const float scale = 65535.0f / std::max(std::max(width, height), 1.0f);
+    parallel([&](size_t, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            vec2 pos = boids[i].pos;
+            uint32_t x = (uint32_t) std::clamp(pos.x * scale, 0.0f, 65535.0f);
+            uint32_t y = (uint32_t) std::clamp(pos.y * scale, 0.0f, 65535.0f);
+            keys[i] = (uint64_t) encode(x, y) << 32 | i;
+        }
+    });
+
+    for (int shift = 32; shift < 64; shift += 8) {
+        // Count the digits of each block
+        parallel([&](size_t block, size_t begin, size_t end) {
+            uint32_t *counts = &histograms[block * 256];
+            std::fill(counts, counts + 256, 0);
+            for (size_t i = begin; i < end; ++i) {
+                ++counts[(keys[i] >> shift) & 0xff];
+            }
+        });
+
+        // Exclusive prefix sum, digit-major then block: keeps the sort stable
+        uint32_t total = 0;
+        for (int digit = 0; digit < 256; ++digit) {
+            for (size_t block = 0; block < blocks; ++block) {
+                uint32_t n = histograms[block * 256 + digit];
+                histograms[block * 256 + digit] = total;
+                total += n;
+            }
+        }
+
+        // Every block scatters its keys to its own ranges
+        parallel([&](size_t block, size_t begin, size_t end) {
+            uint32_t *offsets = &histograms[block * 256];
+            for (size_t i = begin; i < end; ++i) {
+                scratch[offsets[(keys[i] >> shift) & 0xff]++] = keys[i];
+            }
+        });
+        keys.swap(scratch);
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        order[i] = (uint32_t) keys[i];
+    }
+    boids.reorder(order.data());
+}
+
+size_t MortonOrder::memoryUsage() const {
+    return (keys.capacity() + scratch.capacity()) * sizeof(uint64_t) +
+           (histograms.capacity() + order.capacity()) * sizeof(uint32_t);
+}
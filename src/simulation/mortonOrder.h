@@ -0,0 +1,38 @@
+#ifndef GRAPHICS_MORTONORDER_H
+#define GRAPHICS_MORTONORDER_H
+
+#include <cstdint>
+#include <vector>
+#include "boidPool.h"
+#include "../framework/threadPool.h"
+
+using std::vector;
+
+/**
+ * @brief Sorts the boids of a pool along a Z-order (Morton) curve.
+ * @details Boids close in space end up close in memory, so the neighbor loops touch fewer cache lines.
+ * Each boid gets a 32-bit key by interleaving the bits of its quantized x and y, and the keys are sorted
+ * with an LSD radix sort (four 8-bit passes), split over a ThreadPool when one is given.
+ * @details Handles stay valid: BoidPool::reorder() remaps them.
+ */
+class MortonOrder {
+public:
+    /// @brief Reorders boids by the Morton code of their position in [0, width] x [0, height]
+    void sort(BoidPool &boids, float width, float height, ThreadPool *threads = nullptr);
+
+    /// @brief Morton code of a point quantized to 16 bits per axis
+    static uint32_t encode(uint32_t x, uint32_t y);
+
+    /// @brief Bytes reserved by the sort buffers
+    size_t memoryUsage() const;
+
+private:
+    /// @brief Pairs of (code << 32 | slot), and the buffer each pass scatters into
+    vector<uint64_t> keys, scratch;
+    /// @brief Digit counts of every block of keys, for one pass
+    vector<uint32_t> histograms;
+    /// @brief Slot order handed to BoidPool::reorder()
+    vector<uint32_t> order;
+};
+
+#endif //GRAPHICS_MORTONORDER_H
@@ -0,0 +1,125 @@
+#include "obstacleField.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+void ObstacleField::addCircle(vec2 center, float radius) {
+    obstacles.push_back({Type::CIRCLE, center, vec2(radius, radius)});
+}
+
+void ObstacleField::addRect(vec2 pos, vec2 size) {
+    obstacles.push_back({Type::RECT, pos, size * 0.5f});
+}
+
+void ObstacleField::addTriangle(vec2 pos, vec2 size) {
+    // Same corners as Triangle::initVectors(), scaled and moved like Shape::setUniforms()
+    addPolygon({pos + vec2(-0.5f, -0.5f) * size,
+                pos + vec2(0.5f, -0.5f) * size,
+                pos + vec2(0.0f, 0.5f) * size});
+}
+
+void ObstacleField::addPolygon(const vector<vec2> &corners) {
+    Obstacle obstacle{Type::POLYGON};
+    obstacle.first = (int) points.size();
+    obstacle.count = (int) corners.size();
+    points.insert(points.end(), corners.begin(), corners.end());
+    obstacles.push_back(obstacle);
+}
+
+void ObstacleField::clear() {
+    obstacles.clear();
+    points.clear();
+    distances.clear();
+    normals.clear();
+    columns = rows = 0;
+}
+
+float ObstacleField::distance(vec2 pos) const {
+    float best = std::numeric_limits<float>::max();
+
+    for (const Obstacle &obstacle : obstacles) {
+        float d;
+        if (obstacle.type == Type::CIRCLE) {
+            d = glm::length(pos - obstacle.center) - obstacle.extent.x;
+        } else if (obstacle.type == Type::RECT) {
+            vec2 q = glm::abs(pos - obstacle.center) - obstacle.extent;
+            d = glm::length(glm::max(q, vec2(0, 0))) + std::min(std::max(q.x, q.y), 0.0f);
+        } else {
+            // Distance to the closest edge, negated if pos is inside (even-odd rule)
+            const vec2 *corner = &points[obstacle.first];
+            float closest2 = std::numeric_limits<float>::max();
+            bool inside = false;
+            for (int i = 0, j = obstacle.count - 1; i < obstacle.count; j = i++) {
+                vec2 edge = corner[j] - corner[i];
+                vec2 toPos = pos - corner[i];
+                float t = glm::clamp(glm::dot(toPos, edge) / glm::dot(edge, edge), 0.0f, 1.0f);
+                vec2 offset = toPos - edge * t;
+                closest2 = std::min(closest2, glm::dot(offset, offset));
+
+                if ((corner[i].y > pos.y) != (corner[j].y > pos.y) &&
+                    pos.x < corner[i].x + (pos.y - corner[i].y) * edge.x / edge.y) {
+                    inside = !inside;
+                }
+            }
+            d = inside ? -std::sqrt(closest2) : std::sqrt(closest2);
+        }
+        best = std::min(best, d);
+    }
+    return best;
+}
+
+void ObstacleField::bake(float width, float height, float cellSize) {
+    this->cellSize = cellSize;
+    columns = (int) std::ceil(width / cellSize) + 1;
+    rows = (int) std::ceil(height / cellSize) + 1;
+
+    distances.resize(columns * rows);
+    normals.resize(columns * rows);
+
+    if (obstacles.empty()) {
+        columns = rows = 0;
+        return;
+    }
+
+    for (int y = 0; y < rows; ++y) {
+        for (int x = 0; x < columns; ++x) {
+            distances[y * columns + x] = distance(vec2(x, y) * cellSize);
+        }
+    }
+
+    // Gradient by central differences (one sided at the borders)
+    for (int y = 0; y < rows; ++y) {
+        for (int x = 0; x < columns; ++x) {
+            int left = std::max(x - 1, 0), right = std::min(x + 1, columns - 1);
+            int down = std::max(y - 1, 0), up = std::min(y + 1, rows - 1);
+            vec2 gradient((distances[y * columns + right] - distances[y * columns + left]) / float(right - left),
+                          (distances[up * columns + x] - distances[down * columns + x]) / float(up - down));
+            float length = glm::length(gradient);
+            normals[y * columns + x] = length > 0 ? gradient / length : vec2(0, 0);
+        }
+    }
+}
+
+ObstacleField::Sample ObstacleField::sample(vec2 pos) const {
+    vec2 cell = glm::clamp(pos / cellSize, vec2(0, 0), vec2(columns - 1, rows - 1));
+    int x0 = std::min((int) cell.x, columns - 2);
+    int y0 = std::min((int) cell.y, rows - 2);
+    float fx = cell.x - x0, fy = cell.y - y0;
+
+    int i00 = y0 * columns + x0, i10 = i00 + 1;
+    int i01 = i00 + columns, i11 = i01 + 1;
+
+    float bottom = distances[i00] + (distances[i10] - distances[i00]) * fx;
+    float top = distances[i01] + (distances[i11] - distances[i01]) * fx;
+    vec2 normalBottom = normals[i00] + (normals[i10] - normals[i00]) * fx;
+    vec2 normalTop = normals[i01] + (normals[i11] - normals[i01]) * fx;
+
+    return {bottom + (top - bottom) * fy, normalBottom + (normalTop - normalBottom) * fy};
+}
+
+bool ObstacleField::empty() const { return columns == 0; }
+
+size_t ObstacleField::memoryUsage() const {
+    return obstacles.capacity() * sizeof(Obstacle) + (points.capacity() + normals.capacity()) * sizeof(vec2) +
+           distances.capacity() * sizeof(float);
+}
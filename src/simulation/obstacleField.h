@@ -0,0 +1,78 @@
+#ifndef GRAPHICS_OBSTACLEFIELD_H
+#define GRAPHICS_OBSTACLEFIELD_H
+
+#include <vector>
+#include "glm/glm.hpp"
+
+using std::vector, glm::vec2;
+
+/**
+ * @brief Static obstacles baked into a signed distance grid.
+ * @details Circles, rectangles and polygons are added first, then bake() samples their combined signed distance
+ * (negative inside an obstacle) and its gradient on a regular grid. After that, sample() answers with one bilinear
+ * lookup, no matter how many obstacles there are.
+ */
+class ObstacleField {
+public:
+    /// @brief Signed distance to the closest obstacle and the direction away from it
+    struct Sample {
+        float distance;
+        vec2 normal;
+    };
+
+    /// @brief Adds a circle obstacle
+    void addCircle(vec2 center, float radius);
+
+    /// @brief Adds an axis-aligned rectangle obstacle (centered on pos, like Rect)
+    void addRect(vec2 pos, vec2 size);
+
+    /// @brief Adds a triangle obstacle with the same corners as Triangle(pos, size)
+    void addTriangle(vec2 pos, vec2 size);
+
+    /// @brief Adds a simple polygon obstacle (convex or not) from its corners
+    void addPolygon(const vector<vec2> &points);
+
+    /// @brief Removes every obstacle and the baked grid
+    void clear();
+
+    /// @brief Computes the signed distance and gradient grid covering [0, width] x [0, height]
+    /// @param cellSize Distance between grid samples in pixels
+    void bake(float width, float height, float cellSize);
+
+    /// @brief Bilinearly interpolates the baked grid at pos (clamped to the grid)
+    /// @details Must not be called when empty() is true.
+    Sample sample(vec2 pos) const;
+
+    /// @brief True if there is nothing baked to sample
+    bool empty() const;
+
+    /// @brief Exact signed distance to the closest obstacle (slow: tests every obstacle)
+    float distance(vec2 pos) const;
+
+    /// @brief Bytes reserved by the obstacle list and the baked grid
+    size_t memoryUsage() const;
+
+private:
+    enum class Type { CIRCLE, RECT, POLYGON };
+
+    struct Obstacle {
+        Type type = Type::CIRCLE;
+        /// @brief Center of circles and rects
+        vec2 center = vec2(0, 0);
+        /// @brief Radius of circles; half size of rects
+        vec2 extent = vec2(0, 0);
+        /// @brief Corners of polygons are points[first] to points[first + count - 1]
+        int first = 0, count = 0;
+    };
+
+    vector<Obstacle> obstacles;
+    vector<vec2> points;
+
+    /// @brief Baked grid, row major, (columns x rows) samples
+    vector<float> distances;
+    vector<vec2> normals;
+    int columns = 0, rows = 0;
+    float cellSize = 1;
+};
+
+#endif //GRAPHICS_OBSTACLEFIELD_H
@@ -0,0 +1,167 @@
+#include "quadTree.h"
+#include "../framework/memoryTracker.h"
+#include <algorithm>
+#include <cmath>
+
+void TeamSums::add(int team, vec2 pos) {
+    ++count[team];
+    sum[team] += pos;
+}
+
+void TeamSums::add(const TeamSums &other) {
+    for (int team = 0; team < MAX_TEAMS; ++team) {
+        count[team] += other.count[team];
+        sum[team] += other.sum[team];
+    }
+}
+
+void QuadTree::build(const BoidPool &boids) {
+    nodes.clear();
+    items.clear();
+    if (boids.size() == 0) {
+        return;
+    }
+
+    MemoryTracker::expectGrowth(items, boids.size());
+    Node root;
+    root.min = root.max = boids[0].pos;
+    for (const Boid &boid : boids) {
+        items.push_back({boid.pos, boid.team});
+        root.min = glm::min(root.min, boid.pos);
+        root.max = glm::max(root.max, boid.pos);
+    }
+
+    // Make the root square so every node has the same aspect ratio
+    float size = std::max(root.max.x - root.min.x, root.max.y - root.min.y);
+    root.max = root.min + vec2(size, size);
+    root.count = (int) items.size();
+
+    MemoryTracker::expectGrowth(nodes, 1);
+    nodes.push_back(root);
+    split(0, 0);
+}
+
+void QuadTree::split(int node, int depth) {
+    // Copy out the fields we need, push_back below can reallocate nodes
+    int first = nodes[node].first;
+    int count = nodes[node].count;
+
+    if (count <= LEAF_SIZE || depth >= MAX_DEPTH) {
+        for (int i = first; i < first + count; ++i) {
+            nodes[node].sums.add(items[i].team, items[i].pos);
+        }
+        return;
+    }
+
+    vec2 min = nodes[node].min;
+    vec2 max = nodes[node].max;
+    vec2 mid = (min + max) * 0.5f;
+
+    // Sort the node's items into the order bottom left, bottom right, top left, top right
+    auto begin = items.begin() + first;
+    auto end = begin + count;
+    auto top = std::partition(begin, end, [mid](const Item &item) { return item.pos.y < mid.y; });
+    auto bottomRight = std::partition(begin, top, [mid](const Item &item) { return item.pos.x < mid.x; });
+    auto topRight = std::partition(top, end, [mid](const Item &item) { return item.pos.x < mid.x; });
+    vector<Item>::iterator cut[5] = {begin, bottomRight, top, topRight, end};
+
+    int children = (int) nodes.size();
+    nodes[node].children = children;
+    MemoryTracker::expectGrowth(nodes, nodes.size() + 4);
+    for (int quadrant = 0; quadrant < 4; ++quadrant) {
+        Node child;
+        child.min = vec2(quadrant & 1 ? mid.x : min.x, quadrant & 2 ? mid.y : min.y);
+        child.max = vec2(quadrant & 1 ? max.x : mid.x, quadrant & 2 ? max.y : mid.y);
+        child.first = (int) (cut[quadrant] - items.begin());
+        child.count = (int) (cut[quadrant + 1] - cut[quadrant]);
+        nodes.push_back(child);
+    }
+
+    for (int quadrant = 0; quadrant < 4; ++quadrant) {
+        split(children + quadrant, depth + 1);
+        nodes[node].sums.add(nodes[children + quadrant].sums);
+    }
+}
+
+void QuadTree::gather(vec2 pos, float minDist, float maxDist, float theta, TeamSums &out) const {
+    if (nodes.empty()) {
+        return;
+    }
+
+    const float minDist2 = minDist * minDist;
+    const float maxDist2 = maxDist * maxDist;
+
+    // Each split pushes at most four nodes, so this is enough for MAX_DEPTH levels
+    int stack[4 * MAX_DEPTH + 4];
+    int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0) {
+        const Node &node = nodes[stack[--top]];
+        if (node.count == 0) {
+            continue;
+        }
+
+        // Closest and furthest points of the node's box from pos
+        vec2 nearest = glm::clamp(pos, node.min, node.max) - pos;
+        vec2 furthest = glm::max(glm::abs(node.min - pos), glm::abs(node.max - pos));
+        float near2 = glm::dot(nearest, nearest);
+        float far2 = glm::dot(furthest, furthest);
+
+        if (near2 >= maxDist2 || far2 <= minDist2) {
+            // Entirely outside the ring
+            continue;
+        }
+        if (far2 < maxDist2 && near2 > minDist2) {
+            // Entirely inside the ring: the aggregates are exact
+            out.add(node.sums);
+            continue;
+        }
+
+        if (node.children < 0) {
+            for (int i = node.first; i < node.first + node.count; ++i) {
+                vec2 delta = items[i].pos - pos;
+                float dist2 = glm::dot(delta, delta);
+                if (dist2 > minDist2 && dist2 < maxDist2) {
+                    out.add(items[i].team, items[i].pos);
+                }
+            }
+            continue;
+        }
+
+        // Opening angle criterion, measured from the node's centroid
+        vec2 sum(0, 0);
+        for (int team = 0; team < MAX_TEAMS; ++team) {
+            sum += node.sums.sum[team];
+        }
+        vec2 delta = sum / (float) node.count - pos;
+        float size = node.max.x - node.min.x;
+
+        if (size * size < theta * theta * glm::dot(delta, delta)) {
+            // Far enough away: keep each team whose centroid falls inside the ring
+            for (int team = 0; team < MAX_TEAMS; ++team) {
+                int count = node.sums.count[team];
+                if (count == 0) {
+                    continue;
+                }
+                vec2 toCentroid = node.sums.sum[team] / (float) count - pos;
+                float dist2 = glm::dot(toCentroid, toCentroid);
+                if (dist2 > minDist2 && dist2 < maxDist2) {
+                    out.count[team] += count;
+                    out.sum[team] += node.sums.sum[team];
+                }
+            }
+            continue;
+        }
+
+        for (int quadrant = 0; quadrant < 4; ++quadrant) {
+            stack[top++] = node.children + quadrant;
+        }
+    }
+}
+
+size_t QuadTree::getNodeCount() const { return nodes.size(); }
+
+size_t QuadTree::memoryUsage() const {
+    return nodes.capacity() * sizeof(Node) + items.capacity() * sizeof(Item);
+}
@@ -0,0 +1,78 @@
+#ifndef GRAPHICS_QUADTREE_H
+#define GRAPHICS_QUADTREE_H
+
+#include <vector>
+#include "boidPool.h"
+
+using std::vector;
+
+/// @brief Number of boids and sum of their positions, per team.
+/// @details The centroid of a team is sum[team] / count[team].
+struct TeamSums {
+    int count[MAX_TEAMS] = {};
+    vec2 sum[MAX_TEAMS] = {};
+
+    /// @brief Adds a single boid
+    void add(int team, vec2 pos);
+    /// @brief Adds every boid of other
+    void add(const TeamSums &other);
+};
+
+/**
+ * @brief Barnes-Hut quadtree over the boid positions.
+ * @details Each node stores the number of boids and the sum of their positions for every team,
+ * so a whole group of far-away boids can be treated as one point at its centroid.
+ * @details The tree is rebuilt once per step.
+ */
+class QuadTree {
+public:
+    /// @brief Nodes with this many boids or fewer are not split
+    static const int LEAF_SIZE = 8;
+    /// @brief Nodes at this depth are never split (guards against many boids at one point)
+    static const int MAX_DEPTH = 16;
+
+    /// @brief Rebuilds the tree from the current positions of the boids
+    void build(const BoidPool &boids);
+
+    /// @brief Sums, per team, the boids whose distance to pos is in (minDist, maxDist)
+    /// @details Nodes entirely inside the ring are added exactly without being opened. A node that straddles
+    /// the ring is approximated by its team centroids when size / distance < theta; otherwise it is opened.
+    /// @details theta = 0 gives the exact result. Larger values visit fewer nodes at the cost of accuracy.
+    /// @param pos The position of the boid doing the query
+    /// @param minDist Boids closer than this are ignored (this also skips the boid itself)
+    /// @param maxDist Boids further than this are ignored
+    /// @param theta The opening angle
+    /// @param out Sums are added to this
+    void gather(vec2 pos, float minDist, float maxDist, float theta, TeamSums &out) const;
+
+    /// @brief Number of nodes in the last build
+    size_t getNodeCount() const;
+
+    /// @brief Bytes reserved by the node and item arrays
+    size_t memoryUsage() const;
+
+private:
+    struct Node {
+        /// @brief Bounding box of the node
+        vec2 min, max;
+        /// @brief Index of the first of four consecutive children, or -1 for a leaf
+        int children = -1;
+        /// @brief Range of the node's boids in items
+        int first = 0, count = 0;
+        /// @brief Per team aggregates of every boid under the node
+        TeamSums sums;
+    };
+
+    struct Item {
+        vec2 pos;
+        int team;
+    };
+
+    /// @brief Splits node until its children are leaves
+    void split(int node, int depth);
+
+    vector<Node> nodes;
+    vector<Item> items;
+};
+
+#endif //GRAPHICS_QUADTREE_H
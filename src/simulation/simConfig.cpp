@@ -0,0 +1,90 @@
+#include "simConfig.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+SimConfig presetConfig(Preset preset) {
+    switch (preset) {
+        case Preset::SCHOOL:
+            return PresetConfig<Preset::SCHOOL>::value;
+        case Preset::SWARM:
+            return PresetConfig<Preset::SWARM>::value;
+        default:
+            return PresetConfig<Preset::CLASSIC>::value;
+    }
+}
+
+const char *presetName(Preset preset) {
+    switch (preset) {
+        case Preset::CLASSIC:
+            return "classic";
+        case Preset::SCHOOL:
+            return "school";
+        case Preset::SWARM:
+            return "swarm";
+        default:
+            return "custom";
+    }
+}
+
+SimConfigField simConfigField(const string &name) {
+    struct Field {
+        const char *name;
+        SimConfigField member;
+    };
+    static const Field FIELDS[] = {
+        {"centerCoefficient", &SimConfig::centerCoefficient}, {"avoidCoefficient", &SimConfig::avoidCoefficient},
+        {"matchCoefficient", &SimConfig::matchCoefficient},   {"speedLimit", &SimConfig::speedLimit},
+        {"minDistance", &SimConfig::minDistance},             {"matchDistance", &SimConfig::matchDistance},
+        {"cohesionDistance", &SimConfig::cohesionDistance},   {"marginX", &SimConfig::marginX},
+        {"marginY", &SimConfig::marginY},                     {"turnSpeed", &SimConfig::turnSpeed},
+    };
+    for (const Field &field : FIELDS) {
+        if (name == field.name) {
+            return field.member;
+        }
+    }
+    return nullptr;
+}
+
+bool parsePreset(const string &name, Preset &preset) {
+    for (Preset candidate : {Preset::CLASSIC, Preset::SCHOOL, Preset::SWARM}) {
+        if (name == presetName(candidate)) {
+            preset = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool loadSimConfig(const string &path, SimConfig &config) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cout << "| ERROR::CONFIG: Failed to open " << path << std::endl;
+        return false;
+    }
+
+    string line;
+    int number = 0;
+    while (std::getline(file, line)) {
+        ++number;
+        line = line.substr(0, line.find('#'));
+        size_t equals = line.find('=');
+        std::istringstream name(line.substr(0, equals));
+        string key;
+        if (!(name >> key)) {
+            continue;
+        }
+
+        SimConfigField field = simConfigField(key);
+        float value;
+        std::istringstream rest(equals == string::npos ? "" : line.substr(equals + 1));
+        if (!field || !(rest >> value)) {
+            std::cout << "| ERROR::CONFIG: " << path << ":" << number << ": bad setting '" << key << "'" << std::endl;
+            return false;
+        }
+        config.*field = value;
+    }
+    return true;
+}
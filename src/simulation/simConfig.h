@@ -0,0 +1,96 @@
+#ifndef GRAPHICS_SIMCONFIG_H
+#define GRAPHICS_SIMCONFIG_H
+
+#include <string>
+
+using std::string;
+
+/// @brief Tuning constants of the flocking rules
+/// @details The defaults are the original hand-tuned values (Preset::CLASSIC).
+struct SimConfig {
+    /// @brief Cohesion: pull towards the centroid of the neighbors, per neighbor
+    float centerCoefficient = 0.00001f;
+    /// @brief Separation: fraction of the offset to a close boid added to the velocity
+    float avoidCoefficient = 0.05f;
+    /// @brief Alignment: fraction of the gap to the neighbors' average velocity closed per step
+    float matchCoefficient = 0.05f;
+    /// @brief Regular boids are slowed down to this speed and sped up below half of it (leaders get 10% more)
+    float speedLimit = 80;
+    /// @brief Separation radius; regular boids flee rivals within 4 times it and leaders chase within 2 times it
+    float minDistance = 20;
+    /// @brief Alignment radius
+    float matchDistance = 55;
+    /// @brief Cohesion radius
+    float cohesionDistance = 200;
+    /// @brief Distance from the left/right and bottom/top edges at which boids turn back
+    float marginX = 125, marginY = 75;
+    /// @brief Velocity added per step while turning back
+    float turnSpeed = 5;
+};
+
+/// @brief Named rule configurations
+enum class Preset {
+    /// @brief The original rules
+    CLASSIC,
+    /// @brief Tight schools: stronger cohesion and alignment over a wider radius
+    SCHOOL,
+    /// @brief Loose swarms: more separation, little alignment, faster boids
+    SWARM,
+    /// @brief Any SimConfig given at runtime
+    CUSTOM
+};
+
+/// @brief The constants of each preset, known at compile time
+template <Preset P>
+struct PresetConfig;
+
+template <>
+struct PresetConfig<Preset::CLASSIC> {
+    static constexpr SimConfig value{};
+};
+
+template <>
+struct PresetConfig<Preset::SCHOOL> {
+    static constexpr SimConfig value{0.00003f, 0.05f, 0.1f, 80, 20, 80, 200, 125, 75, 5};
+};
+
+template <>
+struct PresetConfig<Preset::SWARM> {
+    static constexpr SimConfig value{0.000005f, 0.08f, 0.02f, 110, 25, 40, 150, 100, 60, 8};
+};
+
+/// @brief Hands a preset to the rule kernels at compile time, so its constants are folded into the code
+template <Preset P>
+struct FixedConfig {
+    constexpr const SimConfig &get() const { return PresetConfig<P>::value; }
+};
+
+/// @brief Hands a SimConfig that can change while running to the rule kernels
+struct RuntimeConfig {
+    const SimConfig *config;
+    const SimConfig &get() const { return *config; }
+};
+
+/// @brief Returns the constants of a preset (the defaults for CUSTOM)
+SimConfig presetConfig(Preset preset);
+
+/// @brief Name of a preset, e.g. "classic"
+const char *presetName(Preset preset);
+
+/// @brief A setting of SimConfig, e.g. &SimConfig::speedLimit
+using SimConfigField = float SimConfig::*;
+
+/// @brief Finds a setting by its name in SimConfig, e.g. "speedLimit"
+/// @return nullptr if there is no such setting
+SimConfigField simConfigField(const string &name);
+
+/// @brief Finds a preset by presetName()
+/// @return false if no preset has that name
+bool parsePreset(const string &name, Preset &preset);
+
+/// @brief Reads "name = value" lines (names as in SimConfig, # starts a comment) into config
+/// @details Settings missing from the file keep their value in config.
+/// @return false if the file could not be read or has an unknown name or a bad value
+bool loadSimConfig(const string &path, SimConfig &config);
+
+#endif //GRAPHICS_SIMCONFIG_H
@@ -0,0 +1,61 @@
+#include "spatialGrid.h"
+
+void SpatialGrid::build(const BoidPool &boids, float cellSize) {
+    build(boids.begin(), boids.size(), cellSize);
+}
+
+void SpatialGrid::build(const Boid *boids, size_t size, float cellSize) {
+    const int count = (int) size;
+    indices.resize(count);
+    cells.resize(count);
+    if (count == 0) {
+        return;
+    }
+
+    vec2 min = boids[0].pos, max = boids[0].pos;
+    for (int i = 1; i < count; ++i) {
+        min = glm::min(min, boids[i].pos);
+        max = glm::max(max, boids[i].pos);
+    }
+
+    // Grow the cells if the boids are too spread out for the cell size asked for
+    vec2 extent = max - min;
+    float largest = std::max(extent.x, extent.y);
+    this->cellSize = std::max(cellSize, largest / (MAX_CELLS_PER_AXIS - 1));
+    origin = min;
+    columns = (int) (extent.x / this->cellSize) + 1;
+    rows = (int) (extent.y / this->cellSize) + 1;
+
+    // Counting sort of the boid slots by cell
+    cellStart.assign(columns * rows + 1, 0);
+    for (int i = 0; i < count; ++i) {
+        cells[i] = cellY(boids[i].pos.y) * columns + cellX(boids[i].pos.x);
+        ++cellStart[cells[i] + 1];
+    }
+    for (int c = 0; c < columns * rows; ++c) {
+        cellStart[c + 1] += cellStart[c];
+    }
+    for (int i = 0; i < count; ++i) {
+        // cellStart[c] is used as the insertion cursor and ends up at the start of cell c + 1 ...
+        indices[cellStart[cells[i]]++] = i;
+    }
+    // ... so shift it back by one cell
+    for (int c = columns * rows; c > 0; --c) {
+        cellStart[c] = cellStart[c - 1];
+    }
+    cellStart[0] = 0;
+}
+
+int SpatialGrid::cellX(float x) const {
+    return std::clamp((int) std::floor((x - origin.x) / cellSize), 0, columns - 1);
+}
+
+int SpatialGrid::cellY(float y) const {
+    return std::clamp((int) std::floor((y - origin.y) / cellSize), 0, rows - 1);
+}
+
+float SpatialGrid::getCellSize() const { return cellSize; }
+
+size_t SpatialGrid::memoryUsage() const {
+    return (cellStart.capacity() + indices.capacity() + cells.capacity()) * sizeof(int);
+}
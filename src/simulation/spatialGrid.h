@@ -0,0 +1,135 @@
+#ifndef GRAPHICS_SPATIALGRID_H
+#define GRAPHICS_SPATIALGRID_H
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include "boidPool.h"
+
+using std::vector;
+
+/**
+ * @brief Uniform grid over the boid positions.
+ * @details Boid slots are counting-sorted by cell, so the boids of one cell are contiguous in indices.
+ * @details The grid covers the bounding box of the boids at build() time and is rebuilt once per step.
+ */
+class SpatialGrid {
+public:
+    /// @brief Upper bound on the number of cells along each axis
+    static const int MAX_CELLS_PER_AXIS = 1024;
+
+    /// @brief Rebuilds the grid from the current positions of the boids
+    /// @param cellSize Requested cell size; grown if the boids are spread out enough to hit MAX_CELLS_PER_AXIS
+    void build(const BoidPool &boids, float cellSize);
+
+    /// @brief Rebuilds the grid over count boids stored contiguously; slots are indices into boids
+    void build(const Boid *boids, size_t count, float cellSize);
+
+    /// @brief Calls fn(slot) for every boid in the cells overlapping the square around pos
+    /// @details The caller still has to check the actual distance.
+    template <typename F>
+    void forEachNear(vec2 pos, float radius, F fn) const;
+
+    /// @brief Finds the k boids closest to pos (within maxDist) for which accept(boid) is true
+    /// @details Searches rings of cells outwards and stops once no unvisited cell can hold a closer boid.
+    /// @param out Receives up to k slots, closest first
+    /// @return The number of slots written to out
+    template <typename F>
+    int nearest(const BoidPool &boids, vec2 pos, int k, float maxDist, F accept, int *out) const;
+
+    float getCellSize() const;
+
+    /// @brief Bytes reserved by the grid arrays
+    size_t memoryUsage() const;
+
+private:
+    /// @brief Cell coordinate of pos along one axis, clamped to the grid
+    int cellX(float x) const;
+    int cellY(float y) const;
+
+    vec2 origin;
+    float cellSize = 1;
+    int columns = 0, rows = 0;
+
+    /// @brief Boids of cell c are indices[cellStart[c]] to indices[cellStart[c + 1] - 1]
+    vector<int> cellStart;
+    vector<int> indices;
+    /// @brief Cell of every boid slot
+    vector<int> cells;
+};
+
+template <typename F>
+void SpatialGrid::forEachNear(vec2 pos, float radius, F fn) const {
+    if (indices.empty()) {
+        return;
+    }
+    int x0 = cellX(pos.x - radius), x1 = cellX(pos.x + radius);
+    int y0 = cellY(pos.y - radius), y1 = cellY(pos.y + radius);
+    for (int y = y0; y <= y1; ++y) {
+        for (int x = x0; x <= x1; ++x) {
+            int cell = y * columns + x;
+            for (int i = cellStart[cell]; i < cellStart[cell + 1]; ++i) {
+                fn(indices[i]);
+            }
+        }
+    }
+}
+
+template <typename F>
+int SpatialGrid::nearest(const BoidPool &boids, vec2 pos, int k, float maxDist, F accept, int *out) const {
+    if (indices.empty() || k <= 0) {
+        return 0;
+    }
+
+    // out is kept sorted by distance, with the squared distances alongside
+    float dist2[64];
+    k = std::min(k, 64);
+    int found = 0;
+    const float maxDist2 = maxDist * maxDist;
+
+    int cx = cellX(pos.x), cy = cellY(pos.y);
+    int maxRing = std::max(std::max(cx, columns - 1 - cx), std::max(cy, rows - 1 - cy));
+
+    for (int ring = 0; ring <= maxRing; ++ring) {
+        // Every cell in this ring is at least (ring - 1) cells away from pos
+        float ringDist = (ring - 1) * cellSize;
+        if (ring > 1 && ringDist * ringDist >= (found == k ? dist2[k - 1] : maxDist2)) {
+            break;
+        }
+
+        for (int y = cy - ring; y <= cy + ring; ++y) {
+            if (y < 0 || y >= rows) {
+                continue;
+            }
+            // Only the border of the ring: inner cells were visited by earlier rings
+            bool edge = y == cy - ring || y == cy + ring;
+            int step = edge ? 1 : 2 * ring;
+            for (int x = cx - ring; x <= cx + ring; x += std::max(step, 1)) {
+                if (x < 0 || x >= columns) {
+                    continue;
+                }
+                int cell = y * columns + x;
+                for (int i = cellStart[cell]; i < cellStart[cell + 1]; ++i) {
+                    int slot = indices[i];
+                    vec2 delta = boids[slot].pos - pos;
+                    float d2 = glm::dot(delta, delta);
+                    if (d2 >= maxDist2 || (found == k && d2 >= dist2[k - 1]) || !accept(boids[slot])) {
+                        continue;
+                    }
+                    // Insertion into the sorted list
+                    int j = found < k ? found++ : k - 1;
+                    while (j > 0 && dist2[j - 1] > d2) {
+                        dist2[j] = dist2[j - 1];
+                        out[j] = out[j - 1];
+                        --j;
+                    }
+                    dist2[j] = d2;
+                    out[j] = slot;
+                }
+            }
+        }
+    }
+    return found;
+}
+
+#endif //GRAPHICS_SPATIALGRID_H
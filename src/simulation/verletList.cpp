@@ -0,0 +1,74 @@
+#include "verletList.h"
+#include "../framework/memoryTracker.h"
+
+#include <algorithm>
+#include <chrono>
+
+bool VerletList::stale(const Boid *boids, const uint32_t *ids, size_t count, float radius, float skin) const {
+    if (count != anchors.size() || radius != builtRadius || skin != builtSkin) {
+        return true;
+    }
+    const float limit2 = skin * skin * 0.25f;
+    for (size_t i = 0; i < count; ++i) {
+        vec2 moved = boids[i].pos - anchors[i];
+        if (ids[i] != anchorIds[i] || glm::dot(moved, moved) > limit2) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool VerletList::update(const Boid *boids, const uint32_t *ids, size_t count, float radius, float skin,
+                        float cellSize) {
+    ++stats.steps;
+    if (!stale(boids, ids, count, radius, skin)) {
+        stats.queriesSaved += count;
+        return false;
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    grid.build(boids, count, cellSize);
+    const float reach = radius + skin;
+    offsets.resize(count + 1);
+    neighbors.clear();
+    for (size_t i = 0; i < count; ++i) {
+        offsets[i] = (int) neighbors.size();
+        grid.forEachNear(boids[i].pos, reach, [&](int slot) {
+            if (glm::distance(boids[i].pos, boids[slot].pos) < reach) {
+                MemoryTracker::expectGrowth(neighbors, neighbors.size() + 1);
+                neighbors.push_back(slot);
+            }
+        });
+        std::sort(neighbors.begin() + offsets[i], neighbors.end(), [ids](int a, int b) { return ids[a] < ids[b]; });
+    }
+    offsets[count] = (int) neighbors.size();
+
+    anchors.resize(count);
+    anchorIds.assign(ids, ids + count);
+    for (size_t i = 0; i < count; ++i) {
+        anchors[i] = boids[i].pos;
+    }
+    builtRadius = radius;
+    builtSkin = skin;
+
+    ++stats.rebuilds;
+    stats.pairs = neighbors.size();
+    stats.lastBuildMilliseconds =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    stats.buildMilliseconds += stats.lastBuildMilliseconds;
+    return true;
+}
+
+void VerletList::clear() {
+    anchors.clear();
+    anchorIds.clear();
+}
+
+const int *VerletList::neighborsOf(size_t i) const        { return neighbors.data() + offsets[i]; }
+int VerletList::countOf(size_t i) const                   { return offsets[i + 1] - offsets[i]; }
+const VerletList::Stats &VerletList::getStats() const     { return stats; }
+
+size_t VerletList::memoryUsage() const {
+    return (offsets.capacity() + neighbors.capacity()) * sizeof(int) + anchors.capacity() * sizeof(vec2) +
+           anchorIds.capacity() * sizeof(uint32_t) + grid.memoryUsage();
+}
@@ -0,0 +1,66 @@
+#ifndef GRAPHICS_VERLETLIST_H
+#define GRAPHICS_VERLETLIST_H
+
+#include <cstdint>
+#include <vector>
+#include "spatialGrid.h"
+
+using std::vector;
+
+/**
+ * @brief Neighbor lists reused over several steps (Verlet lists).
+ * @details Every boid lists the boids within radius + skin of it, found with a SpatialGrid. As long as no boid has
+ * moved more than skin / 2 since, every pair that is now within radius is still listed, so the lists are reused
+ * and the grid is not rebuilt. Lists are sorted by id, like the neighbors of a SYNCHRONOUS step; boids listed
+ * beyond radius are the caller's to skip.
+ * @details The lists index the boids by slot, so they are rebuilt when the boids are reordered, added or removed
+ * (detected by comparing the ids).
+ */
+class VerletList {
+public:
+    /// @brief Counters for tuning the skin
+    struct Stats {
+        /// @brief Calls to update(), and how many of them rebuilt the lists
+        unsigned long steps = 0, rebuilds = 0;
+        /// @brief Grid queries avoided by reusing the lists (one per boid per reused step)
+        unsigned long queriesSaved = 0;
+        /// @brief Entries in the current lists, self included
+        size_t pairs = 0;
+        /// @brief Time spent rebuilding, and the last rebuild alone
+        /// @details Every reused step saves about one rebuild.
+        double buildMilliseconds = 0, lastBuildMilliseconds = 0;
+    };
+
+    /// @brief Makes sure every pair of the count boids within radius is listed
+    /// @details Rebuilds if a boid moved more than skin / 2 since the last build, the ids changed, or radius
+    /// or skin differ from that build.
+    /// @param ids The id of each boid, which orders the lists
+    /// @return true if the lists were rebuilt
+    bool update(const Boid *boids, const uint32_t *ids, size_t count, float radius, float skin, float cellSize);
+
+    /// @brief Drops the lists, so the next update() rebuilds them
+    void clear();
+
+    /// @brief The listed neighbors of boid i (self included), by id
+    const int *neighborsOf(size_t i) const;
+    int countOf(size_t i) const;
+
+    const Stats &getStats() const;
+    /// @brief Bytes reserved by the lists and the grid
+    size_t memoryUsage() const;
+
+private:
+    /// @brief Whether some boid moved too far from where the lists were built
+    bool stale(const Boid *boids, const uint32_t *ids, size_t count, float radius, float skin) const;
+
+    SpatialGrid grid;
+    /// @brief Lists of boid i are neighbors[offsets[i]] to neighbors[offsets[i + 1] - 1]
+    vector<int> offsets, neighbors;
+    /// @brief Position and id of every boid at the last build
+    vector<vec2> anchors;
+    vector<uint32_t> anchorIds;
+    float builtRadius = 0, builtSkin = 0;
+    Stats stats;
+};
+
+#endif //GRAPHICS_VERLETLIST_H
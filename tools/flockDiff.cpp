@@ -0,0 +1,742 @@
+// Runs the optimized simulation backends side by side with plain reference steps and reports where they diverge.
+//
+// There are two references:
+// - The synchronous one is the SYNCHRONOUS rule set written out directly: every boid reads the state at the start
+//   of the step, looks at every other boid in id order and applies each rule in its own loop, through the public
+//   rule methods of Flock. It checks the parallel and sorted paths against those methods.
+// - The baseline one is the update loop of the original engine, ported with its own scalar rules and no Flock code,
+//   so it also catches bugs in the rule methods themselves. Boids are updated in place one after another, like a
+//   SEQUENTIAL update with DIRECT cohesion, which is compared with it boid by boid. It runs without obstacles or
+//   wind, which the original engine did not have. The only change from the original is that leaders steer towards
+//   the other teams, as Flock::center() does (their original test could never pass).
+//
+// Backends with the same semantics as their reference are compared boid by boid every step; backends that resolve
+// their collisions in another order or quantize the boids (and so follow different trajectories by design) are
+// compared by flock-level statistics only. Staggered steering is an approximation by design: its error per boid is
+// reported, but only its statistics have to stay within the tolerances.
+//
+// The deterministic backend steps on a pool of --threads threads and must match the single threaded synchronous
+// backend bit for bit, not just within the tolerances. So must the sequential update with colored contacts on
+// --threads threads match it on one thread.
+//
+// Usage: flock_diff [--boids N] [--steps N] [--seed N] [--processes N] [--threads N] [--stagger K] [--free]
+//                   [--pos-tol px] [--vel-tol px/s] [--centroid-tol px] [--speed-tol px/s] [--team-tol n]
+//
+// After every step the state of its reference is copied back into every backend, so each step is checked from
+// identical inputs. --free lets them run on their own instead; rounding differences then grow until a boid takes a
+// different branch (a bounce, a wrap around the screen edge) and the trajectories split within a few dozen steps.
+// Exits with 1 if any backend diverged.
+
+#include "../src/simulation/flock.h"
+#include "../src/simulation/compactFlock.h"
+#include "../src/simulation/domainDecomposition.h"
+#include "../src/framework/threadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+
+using std::cout, std::endl, std::string, std::unique_ptr, std::make_unique;
+
+static const unsigned int WIDTH = 1600, HEIGHT = 800;
+static const float DELTA_TIME = 1.0f / 60.0f;
+
+struct Options {
+    int boids = 2000;
+    int steps = 300;
+    unsigned int seed = 1;
+    int processes = 4;
+    int threads = 8;
+    int steeringInterval = 4;
+    bool resync = true;
+    float posTolerance = 0.01f, velTolerance = 0.05f;
+    float centroidTolerance = 10.0f, speedTolerance = 2.0f;
+    int teamTolerance = 25;
+};
+
+/// @brief Flock-level statistics compared for every backend
+struct Stats {
+    vec2 centroid[MAX_TEAMS] = {};
+    int teams[MAX_TEAMS] = {};
+    float meanSpeed = 0;
+};
+
+static Stats statsOf(const vector<Boid> &boids) {
+    Stats stats;
+    for (const Boid &boid : boids) {
+        stats.centroid[boid.team] += boid.pos;
+        ++stats.teams[boid.team];
+        stats.meanSpeed += glm::length(boid.velocity);
+    }
+    for (int team = 0; team < MAX_TEAMS; ++team) {
+        if (stats.teams[team]) {
+            stats.centroid[team] /= (float) stats.teams[team];
+        }
+    }
+    stats.meanSpeed /= (float) std::max<size_t>(boids.size(), 1);
+    return stats;
+}
+
+/// @brief A flock with the same world as every other one: obstacles, wind and bounds
+/// @param bare Only the bounds, like the world of the baseline reference
+static unique_ptr<Flock> makeFlock(size_t capacity, bool bare = false) {
+    auto flock = make_unique<Flock>(WIDTH, HEIGHT, capacity);
+    if (!bare) {
+        flock->getObstacles().addCircle(vec2(WIDTH * 0.25f, HEIGHT * 0.5f), 60);
+        flock->getObstacles().addRect(vec2(WIDTH * 0.5f, HEIGHT * 0.5f), vec2(40, 320));
+        flock->bakeObstacles();
+        flock->getFlowField().setWind(vec2(5, 0));
+    }
+    return flock;
+}
+
+/// @brief One step of the reference rules
+/// @param current The boids in id order
+static void referenceStep(Flock &rules, const vector<Boid> &current, vector<Boid> &next) {
+    const SimConfig &config = rules.getConfig();
+    const size_t count = current.size();
+    rules.setTimeStep(DELTA_TIME);
+
+    for (size_t i = 0; i < count; ++i) {
+        // Neighbors are the boids within reach at the start of the step, self included
+        vector<size_t> neighbors;
+        for (size_t j = 0; j < count; ++j) {
+            if (glm::distance(current[i].pos, current[j].pos) < Flock::INTERACTION_RADIUS) {
+                neighbors.push_back(j);
+            }
+        }
+
+        Boid boid1 = current[i];
+        boid1.pos += boid1.velocity * DELTA_TIME;
+
+        for (size_t j : neighbors) {
+            if (j != i) {
+                rules.avoid(boid1, current[j]);
+            }
+        }
+
+        TeamSums near;
+        for (size_t j : neighbors) {
+            float d = glm::distance(boid1.pos, current[j].pos);
+            if (j != i && d < config.cohesionDistance && d > config.minDistance) {
+                near.add(current[j].team, current[j].pos);
+            }
+        }
+        rules.center(boid1, near);
+
+        vec2 avgVelocity(0, 0);
+        int numBoidsNear = 0;
+        for (size_t j : neighbors) {
+            const Boid &boid2 = j == i ? boid1 : current[j];
+            if (glm::distance(boid1.pos, boid2.pos) < config.matchDistance) {
+                avgVelocity += boid2.velocity;
+                ++numBoidsNear;
+            }
+        }
+        rules.matchVelocity(boid1, avgVelocity / (float) numBoidsNear);
+
+        for (size_t j : neighbors) {
+            Boid other = current[j];
+            if (j != i && boid1.isOverlapping(other)) {
+                boid1.bounce(other);
+                if (other.leader && !boid1.leader && other.team != boid1.team) {
+                    boid1.team = other.team;
+                }
+            }
+        }
+
+        if (!rules.getFlowField().empty()) {
+            boid1.velocity += rules.getFlowField().sample(boid1.pos) * DELTA_TIME;
+        }
+        rules.checkBounds(boid1);
+        rules.avoidObstacles(boid1);
+        rules.speedLimit(boid1);
+        next[i] = boid1;
+    }
+}
+
+// -----------------------------------
+// Baseline reference: the original Engine::update() and its rules, one boid at a time
+// -----------------------------------
+
+/// @brief Circle::isOverlapping() of the original engine
+static bool baselineOverlapping(const Boid &boid1, const Boid &boid2) {
+    return glm::distance(boid1.pos, boid2.pos) < boid1.radius + boid2.radius;
+}
+
+/// @brief Circle::bounce() of the original engine: pushes both boids apart and exchanges momentum
+static void baselineBounce(Boid &boid1, Boid &boid2) {
+    vec2 delta = boid2.pos - boid1.pos;
+    float distance = glm::length(delta);
+    float overlap = boid1.radius + boid2.radius - distance;
+    if (overlap <= 0 || distance <= 0) {
+        return;
+    }
+    float mass1 = boid1.radius * boid1.radius * M_PI;
+    float mass2 = boid2.radius * boid2.radius * M_PI;
+    float totalMass = mass1 + mass2;
+    boid1.pos -= overlap * (mass1 / totalMass) * delta / distance;
+    boid2.pos += overlap * (mass2 / totalMass) * delta / distance;
+
+    vec2 velocity1 = boid1.velocity, velocity2 = boid2.velocity;
+    vec2 normal = glm::dot(velocity1 - velocity2, delta) / (distance * distance) * delta;
+    boid1.velocity = velocity1 - (2 * mass2 / totalMass) * normal;
+    boid2.velocity = velocity2 + (2 * mass1 / totalMass) * normal;
+}
+
+/// @brief Engine::center() of the original engine, summed over every boid
+/// @details The original pulled once per pair, between the separation pushes. Flock applies the sum of those pulls
+/// in one go after separation, which is the same to first order in centerCoefficient, but not within the tolerances
+/// in a dense flock; this does the same.
+static void baselineCenter(Boid &boid1, const vector<Boid> &boids, const SimConfig &config) {
+    vec2 sum(0, 0);
+    int numBoidsNear = 0;
+    for (const Boid &boid2 : boids) {
+        // Leaders head for the other teams, regular boids for their own
+        bool follows = boid1.leader ? boid1.team != boid2.team : boid1.team == boid2.team;
+        float distance = glm::distance(boid1.pos, boid2.pos);
+        if (&boid1 != &boid2 && follows && distance < config.cohesionDistance && distance > config.minDistance) {
+            sum += boid2.pos;
+            ++numBoidsNear;
+        }
+    }
+    boid1.velocity += (sum - boid1.velocity * (float) numBoidsNear) * config.centerCoefficient;
+}
+
+/// @brief Engine::avoid() of the original engine, for one pair
+static void baselineAvoid(Boid &boid1, const Boid &boid2, const SimConfig &config) {
+    if (&boid1 == &boid2) {
+        return;
+    }
+    const float minDist = config.minDistance, avoidCoeff = config.avoidCoefficient;
+    float distance = glm::distance(boid1.pos, boid2.pos);
+    bool sameTeam = boid1.team == boid2.team;
+    // The offsets were summed into ints, which truncates them to whole pixels
+    int moveX = (int) (boid1.pos.x - boid2.pos.x), moveY = (int) (boid1.pos.y - boid2.pos.y);
+    if (boid1.leader) {
+        if (distance < minDist * 2 && !sameTeam) {
+            // chase after boids of other teams
+            boid1.velocity.x += moveX;
+            boid1.velocity.y += moveY;
+        } else if (distance < minDist && sameTeam) {
+            boid1.velocity.x += moveX * avoidCoeff;
+            boid1.velocity.y += moveY * avoidCoeff;
+        }
+    } else if (distance < minDist && sameTeam) {
+        boid1.velocity.x += (float) -moveX * avoidCoeff;
+        boid1.velocity.y += (float) -moveY * avoidCoeff;
+    } else if (distance < minDist * 4 && !sameTeam) {
+        boid1.velocity.x += moveX * 0.5f * avoidCoeff;
+        boid1.velocity.y += moveY * 0.5f * avoidCoeff;
+    }
+}
+
+/// @brief Engine::matchVelocity() of the original engine; boid1 counts itself
+static void baselineMatchVelocity(Boid &boid1, const vector<Boid> &boids, const SimConfig &config) {
+    vec2 sum(0, 0);
+    int numBoidsNear = 0;
+    for (const Boid &boid2 : boids) {
+        if (glm::distance(boid1.pos, boid2.pos) < config.matchDistance) {
+            sum += boid2.velocity;
+            ++numBoidsNear;
+        }
+    }
+    vec2 average = sum / (float) numBoidsNear;
+    boid1.velocity += (average - boid1.velocity) * config.matchCoefficient;
+}
+
+/// @brief Engine::checkBounds() of the original engine
+/// @details Its edge clamps were overwritten by a second step along the velocity, so only that step is kept.
+static void baselineCheckBounds(Boid &boid1, const SimConfig &config) {
+    vec2 position = boid1.pos + boid1.velocity * DELTA_TIME;
+    vec2 velocity = boid1.velocity;
+    if (boid1.pos.x < config.marginX) {
+        velocity.x += config.turnSpeed;
+    }
+    if (boid1.pos.x > WIDTH - config.marginX) {
+        velocity.x -= config.turnSpeed;
+    }
+    if (boid1.pos.y < config.marginY) {
+        velocity.y += config.turnSpeed;
+    }
+    if (boid1.pos.y > HEIGHT - config.marginY) {
+        velocity.y -= config.turnSpeed;
+    }
+    boid1.pos = position;
+    boid1.velocity = velocity;
+}
+
+/// @brief Engine::speedLimit() of the original engine
+static void baselineSpeedLimit(Boid &boid1, const SimConfig &config) {
+    // Leaders may go 10% faster and get larger kicks when too slow
+    const float limit = boid1.leader ? config.speedLimit * 1.1f : config.speedLimit;
+    const float kick = boid1.leader ? 5 : 3;
+    float speed = std::sqrt(boid1.velocity.x * boid1.velocity.x + boid1.velocity.y * boid1.velocity.y);
+    if (speed > limit) {
+        boid1.velocity = boid1.velocity / speed * limit;
+    } else if (speed < config.speedLimit / 2) {
+        boid1.velocity.x += boid1.velocity.x > 0 ? kick : -kick;
+        boid1.velocity.y += boid1.velocity.y > 0 ? kick : -kick;
+    }
+}
+
+/// @brief One step of the original Engine::update(), in place: each boid sees the boids updated before it
+static void baselineStep(vector<Boid> &boids, const SimConfig &config) {
+    for (Boid &boid1 : boids) {
+        boid1.pos += boid1.velocity * DELTA_TIME;
+
+        for (const Boid &boid2 : boids) {
+            baselineAvoid(boid1, boid2, config);
+        }
+        baselineCenter(boid1, boids, config);
+
+        baselineMatchVelocity(boid1, boids, config);
+
+        for (Boid &other : boids) {
+            if (&other != &boid1 && baselineOverlapping(boid1, other)) {
+                baselineBounce(boid1, other);
+                // regular boids hit by a leader of an opposing team join it
+                if (boid1.leader && !other.leader && boid1.team != other.team) {
+                    other.team = boid1.team;
+                }
+            }
+        }
+
+        baselineCheckBounds(boid1, config);
+        baselineSpeedLimit(boid1, config);
+    }
+}
+
+/// @brief An optimized simulation driven next to the reference
+class Backend {
+    public:
+        explicit Backend(string name) : name(std::move(name)) {}
+        virtual ~Backend() = default;
+
+        /// @brief Starts from the reference boids (in id order)
+        virtual bool start(const vector<Boid> &boids) = 0;
+        virtual bool step() = 0;
+        /// @brief The current boids, in the order of the reference if perBoid()
+        virtual void read(vector<Boid> &boids) = 0;
+        /// @brief Whether the backend should match the reference boid by boid
+        virtual bool perBoid() const { return true; }
+        /// @brief Whether per boid errors count as divergence, or are only reported
+        virtual bool exact() const { return true; }
+        /// @brief Whether the backend follows the baseline reference instead of the synchronous one
+        virtual bool baseline() const { return false; }
+        /// @brief Overwrites the boids with the reference state, if the backend allows it
+        virtual void resync(const vector<Boid> &) {}
+
+        const string name;
+        /// @brief Backend this one must match bit for bit, or nullptr
+        const Backend *twin = nullptr;
+        /// @brief The boids of the last step
+        vector<Boid> last;
+        /// @brief Step of the first divergence, -1 while none was seen
+        int divergedAt = -1;
+        float maxPosError = 0, maxVelError = 0;
+        double sumPosError = 0, sumVelError = 0;
+        long errorSamples = 0;
+        float maxCentroidError = 0, maxSpeedError = 0;
+        int maxTeamError = 0;
+};
+
+/// @brief Flock in SYNCHRONOUS mode, optionally with a runtime config, a Morton sort or without neighbor lists
+class SynchronousBackend : public Backend {
+    public:
+        SynchronousBackend(string name, bool runtimeConfig, int sortInterval, bool neighborLists = true)
+            : Backend(std::move(name)), runtimeConfig(runtimeConfig), sortInterval(sortInterval),
+              neighborLists(neighborLists) {}
+
+        bool start(const vector<Boid> &boids) override {
+            flock = makeFlock(boids.size(), baseline());
+            flock->setUpdateMode(UpdateMode::SYNCHRONOUS);
+            flock->setSortInterval(sortInterval);
+            if (!neighborLists) {
+                flock->setNeighborSkin(0);
+            }
+            if (runtimeConfig) {
+                // Same constants, but through RuntimeConfig instead of the compiled-in preset
+                flock->setConfig(flock->getConfig());
+            }
+            for (const Boid &boid : boids) {
+                handles.push_back(flock->spawn(boid.pos, boid.velocity, boid.team, boid.leader));
+            }
+            return true;
+        }
+
+        bool step() override {
+            flock->update(DELTA_TIME);
+            return true;
+        }
+
+        void read(vector<Boid> &boids) override {
+            boids.resize(handles.size());
+            for (size_t i = 0; i < handles.size(); ++i) {
+                boids[i] = *flock->getBoids().get(handles[i]);
+            }
+        }
+
+        void resync(const vector<Boid> &boids) override {
+            for (size_t i = 0; i < handles.size(); ++i) {
+                *flock->getBoids().get(handles[i]) = boids[i];
+            }
+        }
+
+    protected:
+        unique_ptr<Flock> flock;
+        vector<BoidHandle> handles;
+        bool runtimeConfig;
+        int sortInterval;
+        bool neighborLists;
+};
+
+/// @brief The SYNCHRONOUS flock split over worker processes
+class ProcessBackend : public SynchronousBackend {
+    public:
+        ProcessBackend(string name, int processes) : SynchronousBackend(std::move(name), false, 0),
+                                                     processes(processes) {}
+
+        bool start(const vector<Boid> &boids) override {
+            SynchronousBackend::start(boids);
+            domain = make_unique<DomainDecomposition>(*flock);
+            return domain->start(processes) > 0;
+        }
+
+        bool step() override {
+            return domain->step(DELTA_TIME);
+        }
+
+        // The workers own the boids: stop them, overwrite the merged boids and start new ones
+        void resync(const vector<Boid> &boids) override {
+            domain->stop();
+            SynchronousBackend::resync(boids);
+            domain->start(processes);
+        }
+
+    private:
+        unique_ptr<DomainDecomposition> domain;
+        int processes;
+};
+
+/// @brief Deterministic flock stepped on several threads
+class ThreadedBackend : public SynchronousBackend {
+    public:
+        ThreadedBackend(string name, int threads) : SynchronousBackend(std::move(name), false, 0),
+                                                   threads((unsigned int) std::max(threads, 1)) {}
+
+        bool start(const vector<Boid> &boids) override {
+            SynchronousBackend::start(boids);
+            flock->setThreadPool(&threads);
+            flock->setDeterministic(true);
+            return true;
+        }
+
+    private:
+        ThreadPool threads;
+};
+
+/// @brief SYNCHRONOUS flock in which each boid recomputes its steering only every few steps
+class StaggeredBackend : public SynchronousBackend {
+    public:
+        StaggeredBackend(string name, int steeringInterval) : SynchronousBackend(std::move(name), false, 0),
+                                                             steeringInterval(steeringInterval) {}
+
+        bool start(const vector<Boid> &boids) override {
+            SynchronousBackend::start(boids);
+            flock->setSteeringInterval(steeringInterval);
+            return true;
+        }
+
+        bool exact() const override { return false; }
+
+    private:
+        int steeringInterval;
+};
+
+/// @brief Flock in its default SEQUENTIAL mode: boids see the new state of the boids updated before them
+class SequentialBackend : public SynchronousBackend {
+    public:
+        explicit SequentialBackend(string name) : SynchronousBackend(std::move(name), false, 0) {}
+
+        bool start(const vector<Boid> &boids) override {
+            SynchronousBackend::start(boids);
+            flock->setUpdateMode(UpdateMode::SEQUENTIAL);
+            flock->setCohesionMode(CohesionMode::DIRECT);
+            return true;
+        }
+
+        bool baseline() const override { return true; }
+};
+
+/// @brief SEQUENTIAL flock that resolves its collisions in a separate COLORED stage, on a pool of threads
+class ColoredBackend : public SequentialBackend {
+    public:
+        ColoredBackend(string name, int threads) : SequentialBackend(std::move(name)),
+                                                  threads((unsigned int) std::max(threads, 1)) {}
+
+        bool start(const vector<Boid> &boids) override {
+            SequentialBackend::start(boids);
+            flock->setCollisionMode(CollisionMode::COLORED);
+            flock->setThreadPool(&threads);
+            return true;
+        }
+
+        // Every collision waits for the end of the step, instead of moving the boid before the next one
+        bool perBoid() const override { return false; }
+
+    private:
+        ThreadPool threads;
+};
+
+/// @brief Quantized storage, updated in place
+class CompactBackend : public Backend {
+    public:
+        using Backend::Backend;
+
+        bool start(const vector<Boid> &boids) override {
+            rules = makeFlock(boids.size());
+            for (const Boid &boid : boids) {
+                handles.push_back(rules->spawn(boid.pos, boid.velocity, boid.team, boid.leader));
+            }
+            compact = make_unique<CompactFlock>(*rules);
+            compact->load(rules->getBoids());
+            return true;
+        }
+
+        bool step() override {
+            compact->update(DELTA_TIME);
+            return true;
+        }
+
+        void read(vector<Boid> &boids) override {
+            boids.clear();
+            compact->forEach([&boids](const Boid &boid) { boids.push_back(boid); });
+        }
+
+        bool perBoid() const override { return false; }
+
+        void resync(const vector<Boid> &boids) override {
+            for (size_t i = 0; i < handles.size(); ++i) {
+                *rules->getBoids().get(handles[i]) = boids[i];
+            }
+            compact->load(rules->getBoids());
+        }
+
+    private:
+        unique_ptr<Flock> rules;
+        vector<BoidHandle> handles;
+        unique_ptr<CompactFlock> compact;
+};
+
+static void printBoid(const char *label, const Boid &boid) {
+    cout << "    " << label << ": pos (" << boid.pos.x << ", " << boid.pos.y << ") velocity (" << boid.velocity.x
+         << ", " << boid.velocity.y << ") team " << boid.team << endl;
+}
+
+/// @brief Whether two boids hold the same bits
+static bool identical(const Boid &a, const Boid &b) {
+    return std::memcmp(&a.pos, &b.pos, sizeof(vec2)) == 0 && std::memcmp(&a.velocity, &b.velocity, sizeof(vec2)) == 0
+           && a.team == b.team && a.leader == b.leader;
+}
+
+/// @brief Compares a backend with the reference after a step; reports and records the first divergence
+static void compare(Backend &backend, int step, const vector<Boid> &reference, const vector<uint32_t> &ids,
+                    const vector<Boid> &boids, const Options &options) {
+    bool fresh = backend.divergedAt < 0;
+    auto diverge = [&](const string &what) {
+        if (fresh) {
+            cout << backend.name << ": diverged at step " << step << ": " << what << endl;
+            backend.divergedAt = step;
+            fresh = false;
+        }
+    };
+
+    if (backend.perBoid()) {
+        for (size_t i = 0; i < reference.size(); ++i) {
+            float posError = glm::distance(reference[i].pos, boids[i].pos);
+            float velError = glm::distance(reference[i].velocity, boids[i].velocity);
+            backend.maxPosError = std::max(backend.maxPosError, posError);
+            backend.maxVelError = std::max(backend.maxVelError, velError);
+            backend.sumPosError += posError;
+            backend.sumVelError += velError;
+            ++backend.errorSamples;
+            if (backend.exact() && (posError > options.posTolerance || velError > options.velTolerance ||
+                                    reference[i].team != boids[i].team)) {
+                bool first = fresh;
+                diverge("boid " + std::to_string(ids[i]));
+                if (first) {
+                    printBoid("reference", reference[i]);
+                    printBoid(backend.name.c_str(), boids[i]);
+                }
+            }
+        }
+    }
+
+    if (backend.twin && backend.twin->last.size() == boids.size()) {
+        for (size_t i = 0; i < boids.size(); ++i) {
+            if (!identical(backend.twin->last[i], boids[i])) {
+                bool first = fresh;
+                diverge("boid " + std::to_string(ids[i]) + " differs from " + backend.twin->name);
+                if (first) {
+                    printBoid(backend.twin->name.c_str(), backend.twin->last[i]);
+                    printBoid(backend.name.c_str(), boids[i]);
+                }
+                break;
+            }
+        }
+    }
+
+    Stats expected = statsOf(reference), actual = statsOf(boids);
+    for (int team = 0; team < MAX_TEAMS; ++team) {
+        backend.maxTeamError = std::max(backend.maxTeamError, std::abs(expected.teams[team] - actual.teams[team]));
+        if (expected.teams[team] && actual.teams[team]) {
+            backend.maxCentroidError = std::max(backend.maxCentroidError,
+                                                glm::distance(expected.centroid[team], actual.centroid[team]));
+        }
+        if (std::abs(expected.teams[team] - actual.teams[team]) > options.teamTolerance) {
+            diverge("team " + std::to_string(team) + " has " + std::to_string(actual.teams[team]) + " boids, " +
+                    std::to_string(expected.teams[team]) + " expected");
+        }
+        if (expected.teams[team] && actual.teams[team] &&
+            glm::distance(expected.centroid[team], actual.centroid[team]) > options.centroidTolerance) {
+            diverge("centroid of team " + std::to_string(team) + " is " +
+                    std::to_string(glm::distance(expected.centroid[team], actual.centroid[team])) + " px off");
+        }
+    }
+    backend.maxSpeedError = std::max(backend.maxSpeedError, std::abs(expected.meanSpeed - actual.meanSpeed));
+    if (std::abs(expected.meanSpeed - actual.meanSpeed) > options.speedTolerance) {
+        diverge("mean speed " + std::to_string(actual.meanSpeed) + ", " + std::to_string(expected.meanSpeed) +
+                " expected");
+    }
+}
+
+int main(int argc, char *argv[]) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        auto next = [&]() { return i + 1 < argc ? argv[++i] : "0"; };
+        if (std::strcmp(argv[i], "--boids") == 0) {
+            options.boids = std::atoi(next());
+        } else if (std::strcmp(argv[i], "--steps") == 0) {
+            options.steps = std::atoi(next());
+        } else if (std::strcmp(argv[i], "--seed") == 0) {
+            options.seed = (unsigned int) std::strtoul(next(), nullptr, 10);
+        } else if (std::strcmp(argv[i], "--processes") == 0) {
+            options.processes = std::atoi(next());
+        } else if (std::strcmp(argv[i], "--threads") == 0) {
+            options.threads = std::atoi(next());
+        } else if (std::strcmp(argv[i], "--stagger") == 0) {
+            options.steeringInterval = std::atoi(next());
+        } else if (std::strcmp(argv[i], "--free") == 0) {
+            options.resync = false;
+        } else if (std::strcmp(argv[i], "--pos-tol") == 0) {
+            options.posTolerance = std::strtof(next(), nullptr);
+        } else if (std::strcmp(argv[i], "--vel-tol") == 0) {
+            options.velTolerance = std::strtof(next(), nullptr);
+        } else if (std::strcmp(argv[i], "--centroid-tol") == 0) {
+            options.centroidTolerance = std::strtof(next(), nullptr);
+        } else if (std::strcmp(argv[i], "--speed-tol") == 0) {
+            options.speedTolerance = std::strtof(next(), nullptr);
+        } else if (std::strcmp(argv[i], "--team-tol") == 0) {
+            options.teamTolerance = std::atoi(next());
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--boids N] [--steps N] [--seed N] [--processes N] [--threads N] [--stagger K]"
+                      << " [--free] [--pos-tol px] [--vel-tol px/s] [--centroid-tol px] [--speed-tol px/s] [--team-tol n]"
+                      << endl;
+            return 1;
+        }
+    }
+
+    // Seeded start: two teams facing each other, like the engine
+    std::srand(options.seed);
+    unique_ptr<Flock> rules = makeFlock(options.boids);
+    rules->spawnFlock(vec2(WIDTH * 0.3f, HEIGHT * 0.5f), options.boids / 2, 0);
+    rules->spawnFlock(vec2(WIDTH * 0.7f, HEIGHT * 0.5f), options.boids - options.boids / 2, 1);
+
+    // The reference keeps the boids in id order, the order SYNCHRONOUS updates visit neighbors in
+    const BoidPool &pool = rules->getBoids();
+    vector<size_t> order(pool.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&pool](size_t a, size_t b) {
+        return pool.handleAt(a).id < pool.handleAt(b).id;
+    });
+    vector<Boid> reference(order.size()), next(order.size()), boids;
+    vector<uint32_t> ids(order.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        reference[i] = pool[order[i]];
+        ids[i] = pool.handleAt(order[i]).id;
+    }
+    // Updated in id order too, which is the slot order of the backends' freshly spawned pools
+    vector<Boid> baseline = reference;
+
+    vector<unique_ptr<Backend>> backends;
+    backends.push_back(make_unique<SynchronousBackend>("synchronous", false, 0));
+    backends.push_back(make_unique<SynchronousBackend>("runtime-config", true, 0));
+    backends.push_back(make_unique<SynchronousBackend>("morton-sorted", false, 7));
+    backends.push_back(make_unique<SynchronousBackend>("grid-neighbors", false, 0, false));
+    backends.push_back(make_unique<ProcessBackend>("processes", options.processes));
+    backends.push_back(make_unique<ThreadedBackend>("deterministic", options.threads));
+    backends.back()->twin = backends.front().get();
+    backends.push_back(make_unique<StaggeredBackend>("staggered", options.steeringInterval));
+    backends.push_back(make_unique<SequentialBackend>("sequential"));
+    backends.push_back(make_unique<ColoredBackend>("colored-contacts", 1));
+    backends.push_back(make_unique<ColoredBackend>("colored-threaded", options.threads));
+    backends.back()->twin = backends[backends.size() - 2].get();
+    backends.push_back(make_unique<CompactBackend>("compact"));
+
+    for (auto it = backends.begin(); it != backends.end();) {
+        if ((*it)->start(reference)) {
+            ++it;
+        } else {
+            cout << (*it)->name << ": could not start, skipped" << endl;
+            it = backends.erase(it);
+        }
+    }
+
+    for (int step = 1; step <= options.steps; ++step) {
+        referenceStep(*rules, reference, next);
+        reference.swap(next);
+        baselineStep(baseline, rules->getConfig());
+
+        for (auto &backend : backends) {
+            if (!backend->step()) {
+                cout << backend->name << ": step " << step << " failed" << endl;
+                backend->divergedAt = backend->divergedAt < 0 ? step : backend->divergedAt;
+                continue;
+            }
+            const vector<Boid> &expected = backend->baseline() ? baseline : reference;
+            backend->read(boids);
+            backend->last = boids;
+            compare(*backend, step, expected, ids, boids, options);
+            if (options.resync) {
+                backend->resync(expected);
+            }
+        }
+    }
+
+    bool ok = true;
+    for (auto &backend : backends) {
+        const char *kind = !backend->perBoid() ? " (statistics)" : backend->exact() ? " (per boid)" : " (approximate)";
+        cout << backend->name << kind << ": ";
+        if (backend->divergedAt < 0) {
+            cout << "ok";
+        } else {
+            cout << "DIVERGED at step " << backend->divergedAt;
+            ok = false;
+        }
+        if (backend->perBoid()) {
+            const double samples = (double) std::max(backend->errorSamples, 1L);
+            cout << ", max position error " << backend->maxPosError << " px (mean " << backend->sumPosError / samples
+                 << "), max velocity error " << backend->maxVelError << " px/s (mean "
+                 << backend->sumVelError / samples << ")";
+        }
+        cout << ", max centroid error " << backend->maxCentroidError << " px, max mean speed error "
+             << backend->maxSpeedError << " px/s, max team count error " << backend->maxTeamError << endl;
+    }
+    return ok ? 0 : 1;
+}
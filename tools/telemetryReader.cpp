@@ -0,0 +1,67 @@
+// Prints the telemetry published by a running engine, one line per frame.
+//
+// Usage: telemetry_reader [--once] [--interval ms] [segment name]
+
+#include "../src/framework/telemetry.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+using std::cout, std::endl;
+
+static void print(const TelemetryFrame &frame) {
+    cout << "frame=" << frame.frame
+         << " time=" << frame.time
+         << " frame_ms=" << frame.frameTime
+         << " input_ms=" << frame.inputTime
+         << " update_ms=" << frame.updateTime
+         << " render_ms=" << frame.renderTime
+         << " boids=" << frame.boids;
+    for (int team = 0; team < TELEMETRY_TEAMS; ++team) {
+        cout << " team" << team << "=" << frame.teams[team];
+    }
+    cout << " contacts=" << frame.contacts << endl;
+}
+
+int main(int argc, char *argv[]) {
+    bool once = false;
+    int interval = 100;
+    const char *name = TELEMETRY_SEGMENT_NAME;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--once") == 0) {
+            once = true;
+        } else if (std::strcmp(argv[i], "--interval") == 0 && i + 1 < argc) {
+            interval = std::atoi(argv[++i]);
+        } else {
+            name = argv[i];
+        }
+    }
+
+    Telemetry telemetry;
+    if (!telemetry.open(name)) {
+        std::cerr << "Could not open telemetry segment " << name << " (is the engine running?)" << endl;
+        return 1;
+    }
+
+    uint64_t lastFrame = 0;
+    while (true) {
+        TelemetryFrame frame;
+        // The writer only holds the seqlock for a memcpy, so spinning briefly is fine
+        while (!telemetry.getSegment()->read(frame)) {
+            std::this_thread::yield();
+        }
+
+        if (frame.frame != lastFrame) {
+            print(frame);
+            lastFrame = frame.frame;
+        }
+        if (once) {
+            return 0;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(interval));
+    }
+}